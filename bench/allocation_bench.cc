@@ -0,0 +1,199 @@
+// Counts the heap allocations of the render phases of the built-in scenes,
+// with each of the features that keep state across phases, and fails if any
+// phase after the first allocates. The first phase is left out, since OpenMP
+// starts its thread pool then, and the lazily built tables of the samplers
+// are filled.
+//
+// Image textures read tiles on cache misses, and allocate them, so the earth
+// scene is left out.
+//
+// Usage: allocation_bench [image_width] [image_height]
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <stop_token>
+#include <string>
+
+#include "app_settings.h"
+#include "camera.h"
+#include "sampler.h"
+#include "scene.h"
+#include "vec3.h"
+
+namespace {
+
+std::atomic<bool> is_counting = false;
+std::atomic<long> num_allocations = 0;
+
+void* Allocate(size_t size, size_t alignment) {
+  if (is_counting.load(std::memory_order_relaxed)) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  size = size == 0 ? 1 : size;
+  void* pointer = alignment > alignof(std::max_align_t)
+                      ? std::aligned_alloc(
+                            alignment, (size + alignment - 1) / alignment *
+                                           alignment)
+                      : std::malloc(size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc{};
+  }
+  return pointer;
+}
+
+struct Feature {
+  const char* name;
+  void (*apply)(CameraSettings* settings);
+};
+
+const Feature kFeatures[] = {
+    {"plain", [](CameraSettings*) {}},
+    {"preview",
+     [](CameraSettings* settings) { settings->enable_preview = true; }},
+    {"path guiding",
+     [](CameraSettings* settings) { settings->enable_path_guiding = true; }},
+    {"primary hit cache",
+     [](CameraSettings* settings) {
+       settings->enable_primary_hit_cache = true;
+     }},
+    {"denoiser",
+     [](CameraSettings* settings) { settings->enable_denoiser = true; }},
+    {"time budget",
+     [](CameraSettings* settings) {
+       settings->phase_scheduling = PhaseScheduling::kTimeBudget;
+       settings->phase_time_budget_ms = 20;
+     }},
+    {"region",
+     [](CameraSettings* settings) {
+       settings->region = Tile{settings->image_width / 4,
+                               settings->image_height / 4,
+                               settings->image_width / 2,
+                               settings->image_height / 2};
+     }},
+};
+
+struct NamedScene {
+  const char* name;
+  SceneType type;
+};
+
+const NamedScene kScenes[] = {
+    {"random_spheres", SceneType::kRandomSpheres},
+    {"perlin_spheres", SceneType::kPerlinSpheres},
+    {"fog", SceneType::kFog},
+    {"cornell_box", SceneType::kCornellBox},
+    {"many_lights", SceneType::kManyLights},
+};
+
+// Returns the allocations of the phases after the first, or -1 if the render
+// didn't get past the first phase.
+long CountAllocations(const Scene& scene, const CameraSettings& settings) {
+  Camera camera{settings};
+  camera.set_lights(&scene.lights);
+  camera.Initialize(SettingsUpdateType::kUpdateTextureAndSettings);
+  int num_phases = 0;
+  long allocations = 0;
+  while (!camera.done_rendering()) {
+    camera.InitializePhase();
+    num_allocations = 0;
+    is_counting = num_phases > 0;
+    camera.Render(std::stop_token{}, SceneRoot(scene));
+    is_counting = false;
+    allocations += num_allocations;
+    num_phases++;
+  }
+  return num_phases > 1 ? allocations : -1;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  return Allocate(size, alignof(std::max_align_t));
+}
+void* operator new[](size_t size) {
+  return Allocate(size, alignof(std::max_align_t));
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+  return Allocate(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return Allocate(size, static_cast<size_t>(alignment));
+}
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+int main(int argc, char** argv) {
+  const int image_width = argc > 1 ? std::atoi(argv[1]) : 160;
+  const int image_height = argc > 2 ? std::atoi(argv[2]) : 90;
+  if (image_width <= 0 || image_height <= 0) {
+    std::fprintf(stderr, "image_width and image_height must be positive\n");
+    return 1;
+  }
+
+  int num_failures = 0;
+  for (const NamedScene& named_scene : kScenes) {
+    Scene scene;
+    const SceneOptions options{.type = named_scene.type,
+                               .bvh = BvhType::kWide,
+                               .texture_path = "",
+                               .texture_cache_bytes = 0,
+                               .environment_path = ""};
+    if (!BuildScene(options, &scene)) {
+      return 1;
+    }
+
+    for (const Feature& feature : kFeatures) {
+      CameraSettings settings{
+          .image_width = image_width,
+          .image_height = image_height,
+          .samples_per_pixel_log2 = 4,
+          .max_depth = 8,
+          .fov = scene.view.fov,
+          .look_from = Point3{scene.view.look_from},
+          .look_at = Point3{scene.view.look_at},
+          .view_up = Vec3{0, 1, 0},
+          .defocus_angle = 0,
+          .focus_distance = scene.view.focus_distance,
+          .phase_scheduling = PhaseScheduling::kDoubling,
+          .phase_time_budget_ms = 0,
+          .sampler_type = SamplerType::kSobol,
+          .enable_denoiser = false,
+          .enable_sky = scene.view.enable_sky,
+          .enable_path_guiding = false,
+          .enable_primary_hit_cache = false,
+          .enable_preview = false,
+          .region = Tile{0, 0, 0, 0},
+      };
+      feature.apply(&settings);
+      const long allocations = CountAllocations(scene, settings);
+      const bool has_failed = allocations != 0;
+      num_failures += has_failed;
+      std::printf("%-16s %-18s %s", named_scene.name, feature.name,
+                  has_failed ? "FAIL" : "ok");
+      if (allocations > 0) {
+        std::printf(" (%ld allocations)", allocations);
+      } else if (allocations < 0) {
+        std::printf(" (a single phase)");
+      }
+      std::printf("\n");
+    }
+  }
+  return num_failures > 0 ? 1 : 0;
+}
\ No newline at end of file
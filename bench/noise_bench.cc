@@ -0,0 +1,129 @@
+// Compares the cost of shading with the noise textures to that of a constant
+// albedo, per point and in batches, and checks the vectorized noise against
+// the scalar one.
+//
+// Usage: noise_bench [num_points]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "color.h"
+#include "float.h"
+#include "noise_texture.h"
+#include "perlin.h"
+#include "vec3.h"
+
+namespace {
+
+constexpr int kRepetitions = 8;
+
+// Points on the scale of the marble scene.
+std::vector<Point3> MakePoints(int num_points) {
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<float> uniform{-4.0f, 4.0f};
+  std::vector<Point3> points(num_points);
+  for (Point3& point : points) {
+    point = Point3{uniform(rng), uniform(rng), uniform(rng)};
+  }
+  return points;
+}
+
+// Returns the nanoseconds per point of `shade`, which fills `colors`.
+template <typename Shade>
+double NanosecondsPerPoint(int num_points, std::vector<Color>* colors,
+                           Shade shade) {
+  const std::chrono::time_point start = std::chrono::steady_clock::now();
+  for (int repetition = 0; repetition < kRepetitions; repetition++) {
+    shade(colors);
+  }
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / kRepetitions / num_points;
+}
+
+double Checksum(const std::vector<Color>& colors) {
+  double sum = 0.0;
+  for (const Color& color : colors) {
+    sum += color.x() + color.y() + color.z();
+  }
+  return sum;
+}
+
+// The turbulence of the second book, one octave after the other.
+Float ScalarTurbulence(const Perlin& noise, Point3 p, int depth) {
+  Float sum = 0;
+  Float weight = 1;
+  for (int octave = 0; octave < depth; octave++) {
+    sum += weight * noise.Noise(p);
+    weight *= 0.5f;
+    p *= 2;
+  }
+  return std::abs(sum);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int num_points = argc > 1 ? std::atoi(argv[1]) : 1 << 20;
+  if (num_points <= 0) {
+    std::fprintf(stderr, "num_points must be positive\n");
+    return 1;
+  }
+
+  const std::vector<Point3> points = MakePoints(num_points);
+  std::vector<Color> colors(num_points);
+  const uint64_t seed = 42;
+  const Perlin noise{seed};
+  const NoiseTexture marble{NoisePattern::kMarble, 4, seed};
+
+  std::printf("%d points\n", num_points);
+  std::printf("%-24s %10s\n", "shading", "ns/point");
+  auto report = [&](const char* name, auto shade) {
+    const double nanoseconds = NanosecondsPerPoint(num_points, &colors, shade);
+    std::printf("%-24s %10.2f   (checksum %g)\n", name, nanoseconds,
+                Checksum(colors));
+  };
+
+  const Color albedo{0.5, 0.5, 0.5};
+  report("constant albedo", [&](std::vector<Color>* colors) {
+    for (int i = 0; i < num_points; i++) {
+      (*colors)[i] = albedo * (1 + points[i].x() * 0);
+    }
+  });
+  report("marble, scalar octaves", [&](std::vector<Color>* colors) {
+    for (int i = 0; i < num_points; i++) {
+      const Float turbulence = ScalarTurbulence(noise, points[i], 7);
+      (*colors)[i] = albedo * (1 + std::sin(4 * points[i].z() +
+                                            10 * turbulence));
+    }
+  });
+  report("marble, per point", [&](std::vector<Color>* colors) {
+    for (int i = 0; i < num_points; i++) {
+      (*colors)[i] = marble.Value(0, 0, points[i], 0);
+    }
+  });
+  report("marble, batched", [&](std::vector<Color>* colors) {
+    marble.Values(points.data(), num_points, colors->data());
+  });
+
+  // The lanes round differently from the scalar code, but not by much.
+  double max_error = 0.0;
+  std::vector<Float> batched(num_points);
+  noise.Noise(points.data(), num_points, batched.data());
+  for (int i = 0; i < num_points; i++) {
+    max_error = std::max(
+        max_error, static_cast<double>(std::abs(batched[i] -
+                                                noise.Noise(points[i]))));
+    max_error = std::max(
+        max_error,
+        static_cast<double>(std::abs(noise.Turbulence(points[i], 7) -
+                                     ScalarTurbulence(noise, points[i], 7))));
+  }
+  std::printf("max difference from the scalar noise: %g\n", max_error);
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+// Compares the precision profiles selectable with `PEWPEW_PRECISION`: the
+// accuracy of their per-pixel accumulation, and the throughput of a ray-sphere
+// intersection and accumulation loop in their geometry and accumulation types.
+//
+// Usage: precision_bench [samples_per_pixel]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+template <typename T>
+class PlainSum {
+ public:
+  void Add(T value) { sum_ += value; }
+  T sum() const { return sum_; }
+
+ private:
+  T sum_ = 0;
+};
+
+// Same summation as `CompensatedAdd` in src/float.h.
+template <typename T>
+class CompensatedSum {
+ public:
+  void Add(T value) {
+    const T new_sum = sum_ + value;
+    if (std::abs(sum_) >= std::abs(value)) {
+      compensation_ += (sum_ - new_sum) + value;
+    } else {
+      compensation_ += (value - new_sum) + sum_;
+    }
+    sum_ = new_sum;
+  }
+  T sum() const { return sum_ + compensation_; }
+
+ private:
+  T sum_ = 0;
+  T compensation_ = 0;
+};
+
+// Radiance-like samples: mostly below 1, with rare bright fireflies.
+std::vector<float> MakeSamples(int num_pixels, int samples_per_pixel) {
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<float> uniform{0.0f, 1.0f};
+  std::vector<float> samples(static_cast<size_t>(num_pixels) *
+                             samples_per_pixel);
+  for (float& sample : samples) {
+    sample = uniform(rng) < 0.01f ? 50.0f * uniform(rng) : uniform(rng);
+  }
+  return samples;
+}
+
+// Returns the mean relative error of the pixel averages.
+template <typename Sum>
+double AccumulationError(const std::vector<float>& samples, int num_pixels,
+                         int samples_per_pixel) {
+  double total_error = 0.0;
+  for (int pixel = 0; pixel < num_pixels; pixel++) {
+    const float* pixel_samples =
+        &samples[static_cast<size_t>(pixel) * samples_per_pixel];
+    Sum sum;
+    long double reference = 0.0L;
+    for (int sample = 0; sample < samples_per_pixel; sample++) {
+      sum.Add(pixel_samples[sample]);
+      reference += pixel_samples[sample];
+    }
+    total_error += static_cast<double>(
+        std::abs((static_cast<long double>(sum.sum()) - reference) /
+                 reference));
+  }
+  return total_error / num_pixels;
+}
+
+template <typename T>
+struct Sphere {
+  T center[3];
+  T radius;
+};
+
+template <typename T>
+std::vector<Sphere<T>> MakeSpheres(int num_spheres) {
+  std::mt19937 rng{7};
+  std::uniform_real_distribution<float> uniform{-10.0f, 10.0f};
+  std::vector<Sphere<T>> spheres(num_spheres);
+  for (Sphere<T>& sphere : spheres) {
+    sphere = Sphere<T>{{uniform(rng), uniform(rng), uniform(rng) + 30.0f},
+                       static_cast<T>(0.2)};
+  }
+  return spheres;
+}
+
+// Returns the number of samples per second, for a ray per sample tested
+// against every sphere, and its shading accumulated per pixel.
+template <typename T, typename Sum>
+double Throughput(int num_pixels, int samples_per_pixel, double* checksum) {
+  const std::vector<Sphere<T>> spheres = MakeSpheres<T>(64);
+  const std::chrono::time_point start = std::chrono::steady_clock::now();
+
+  double total = 0.0;
+  for (int pixel = 0; pixel < num_pixels; pixel++) {
+    Sum sum;
+    for (int sample = 0; sample < samples_per_pixel; sample++) {
+      // A ray from the origin, slightly different for each sample.
+      const T x = static_cast<T>(pixel % 64 - 32) / 96 + sample * T(1e-5);
+      const T y = static_cast<T>(pixel / 64 - 32) / 96;
+      const T inverse_length = 1 / std::sqrt(x * x + y * y + 1);
+      const T direction[3] = {x * inverse_length, y * inverse_length,
+                              inverse_length};
+
+      T closest = static_cast<T>(1e30);
+      for (const Sphere<T>& sphere : spheres) {
+        const T h = direction[0] * sphere.center[0] +
+                    direction[1] * sphere.center[1] +
+                    direction[2] * sphere.center[2];
+        const T c = sphere.center[0] * sphere.center[0] +
+                    sphere.center[1] * sphere.center[1] +
+                    sphere.center[2] * sphere.center[2] -
+                    sphere.radius * sphere.radius;
+        const T discriminant = h * h - c;
+        if (discriminant >= 0) {
+          const T t = h - std::sqrt(discriminant);
+          closest = t > 0 && t < closest ? t : closest;
+        }
+      }
+      sum.Add(closest < static_cast<T>(1e30) ? 1 / closest : direction[1]);
+    }
+    total += static_cast<double>(sum.sum());
+  }
+
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  *checksum = total;
+  return static_cast<double>(num_pixels) * samples_per_pixel / elapsed.count();
+}
+
+template <typename T, typename Sum>
+void Report(const char* name, const std::vector<float>& samples,
+            int num_pixels, int samples_per_pixel) {
+  const double error =
+      AccumulationError<Sum>(samples, num_pixels, samples_per_pixel);
+  double checksum;
+  const double throughput =
+      Throughput<T, Sum>(num_pixels, samples_per_pixel / 16, &checksum);
+  std::printf("%-20s %14.3e %14.2f   (checksum %g)\n", name, error,
+              throughput * 1e-6, checksum);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int samples_per_pixel = argc > 1 ? std::atoi(argv[1]) : 4096;
+  if (samples_per_pixel < 16) {
+    std::fprintf(stderr, "samples_per_pixel must be at least 16\n");
+    return 1;
+  }
+
+  const int num_pixels = 4096;
+  const std::vector<float> samples =
+      MakeSamples(num_pixels, samples_per_pixel);
+
+  std::printf("%d samples per pixel, %d pixels\n", samples_per_pixel,
+              num_pixels);
+  std::printf("%-20s %14s %14s\n", "profile", "relative error",
+              "Msamples/s");
+  Report<float, PlainSum<float>>("fast", samples, num_pixels,
+                                 samples_per_pixel);
+  Report<float, CompensatedSum<float>>("compensated", samples, num_pixels,
+                                       samples_per_pixel);
+  Report<float, PlainSum<double>>("double_accumulation", samples, num_pixels,
+                                  samples_per_pixel);
+  Report<double, PlainSum<double>>("double", samples, num_pixels,
+                                   samples_per_pixel);
+  return 0;
+}
\ No newline at end of file
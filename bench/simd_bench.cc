@@ -0,0 +1,271 @@
+// Checks the operations of `FloatX4` against their scalar results, lane by
+// lane, and compares the throughput of the approximate rsqrt and reciprocal
+// to that of the exact scalar ones. Fails if any lane is off.
+//
+// Usage: simd_bench [num_values]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "simd.h"
+
+namespace {
+
+constexpr int kRepetitions = 8;
+constexpr int kWidth = FloatX4::kWidth;
+// The refined estimates are accurate to about 22 bits.
+constexpr double kApproxTolerance = 1e-6;
+
+std::vector<float> MakeValues(int num_values, float min, float max) {
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<float> uniform{min, max};
+  std::vector<float> values(num_values);
+  for (float& value : values) {
+    value = uniform(rng);
+  }
+  return values;
+}
+
+// Spread over orders of magnitude, as the lengths `UnitVector` normalizes.
+std::vector<float> MakePositiveValues(int num_values) {
+  std::vector<float> values = MakeValues(num_values, -3.0f, 3.0f);
+  for (float& value : values) {
+    value = std::pow(10.0f, value);
+  }
+  return values;
+}
+
+// Counts the lanes where `simd`, applied to packs of `a` and `b`, differs from
+// `scalar` applied to each lane, and prints the first.
+template <typename Simd, typename Scalar>
+int CountMismatches(const char* name, const std::vector<float>& a,
+                    const std::vector<float>& b, Simd simd, Scalar scalar) {
+  int num_mismatches = 0;
+  for (size_t i = 0; i + kWidth <= a.size(); i += kWidth) {
+    float result[kWidth];
+    simd(FloatX4::Load(&a[i]), FloatX4::Load(&b[i])).Store(result);
+    for (int lane = 0; lane < kWidth; lane++) {
+      const float expected = scalar(a[i + lane], b[i + lane]);
+      if (result[lane] != expected && num_mismatches++ == 0) {
+        std::printf("%s(%g, %g): %g instead of %g\n", name, a[i + lane],
+                    b[i + lane], result[lane], expected);
+      }
+    }
+  }
+  return num_mismatches;
+}
+
+// Returns the largest relative error of `simd` against `exact`.
+template <typename Simd, typename Exact>
+double MaxRelativeError(const std::vector<float>& values, Simd simd,
+                        Exact exact) {
+  double max_error = 0.0;
+  for (size_t i = 0; i + kWidth <= values.size(); i += kWidth) {
+    float result[kWidth];
+    simd(FloatX4::Load(&values[i])).Store(result);
+    for (int lane = 0; lane < kWidth; lane++) {
+      const double expected = exact(static_cast<double>(values[i + lane]));
+      max_error =
+          std::max(max_error, std::abs(result[lane] - expected) / expected);
+    }
+  }
+  return max_error;
+}
+
+// Returns the nanoseconds per value of `run`, which fills `results`.
+template <typename Run>
+double NanosecondsPerValue(const std::vector<float>& values,
+                           std::vector<float>* results, Run run) {
+  const std::chrono::time_point start = std::chrono::steady_clock::now();
+  for (int repetition = 0; repetition < kRepetitions; repetition++) {
+    run(values, results);
+  }
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / kRepetitions / values.size();
+}
+
+double Checksum(const std::vector<float>& values) {
+  double sum = 0.0;
+  for (float value : values) {
+    sum += value;
+  }
+  return sum;
+}
+
+template <typename Operation>
+void MapScalar(const std::vector<float>& values, std::vector<float>* results,
+               Operation operation) {
+  for (size_t i = 0; i < values.size(); i++) {
+    (*results)[i] = operation(values[i]);
+  }
+}
+
+template <typename Operation>
+void MapPacked(const std::vector<float>& values, std::vector<float>* results,
+               Operation operation) {
+  for (size_t i = 0; i + kWidth <= values.size(); i += kWidth) {
+    operation(FloatX4::Load(&values[i])).Store(&(*results)[i]);
+  }
+}
+
+// Counts the mismatches of the operations across lanes.
+int CountLaneMismatches(const std::vector<float>& a,
+                        const std::vector<float>& b) {
+  int num_mismatches = 0;
+  for (size_t i = 0; i + kWidth <= a.size(); i += kWidth) {
+    int expected_mask = 0;
+    for (int lane = 0; lane < kWidth; lane++) {
+      expected_mask |= (a[i + lane] < b[i + lane]) << lane;
+    }
+    if (MoveMask(FloatX4::Load(&a[i]) < FloatX4::Load(&b[i])) !=
+        expected_mask) {
+      num_mismatches++;
+    }
+  }
+
+  for (size_t i = 0; i + kWidth * kWidth <= a.size(); i += kWidth * kWidth) {
+    FloatX4 rows[kWidth];
+    for (int row = 0; row < kWidth; row++) {
+      rows[row] = FloatX4::Load(&a[i + row * kWidth]);
+    }
+    Transpose(&rows[0], &rows[1], &rows[2], &rows[3]);
+    for (int row = 0; row < kWidth; row++) {
+      for (int column = 0; column < kWidth; column++) {
+        num_mismatches += rows[row][column] != a[i + column * kWidth + row];
+      }
+    }
+  }
+
+  for (int value = 0; value < 256; value++) {
+    const uint8_t bytes[kWidth] = {
+        static_cast<uint8_t>(value), static_cast<uint8_t>(255 - value),
+        static_cast<uint8_t>(value / 2), static_cast<uint8_t>(value * 3)};
+    const FloatX4 lanes = FloatX4::LoadBytes(bytes);
+    for (int lane = 0; lane < kWidth; lane++) {
+      num_mismatches += lanes[lane] != bytes[lane];
+    }
+  }
+  if (num_mismatches > 0) {
+    std::printf("MoveMask, Transpose or LoadBytes differ\n");
+  }
+  return num_mismatches;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int num_values = argc > 1 ? std::atoi(argv[1]) : 1 << 20;
+  if (num_values <= 0 || num_values % (kWidth * kWidth) != 0) {
+    std::fprintf(stderr, "num_values must be a positive multiple of %d\n",
+                 kWidth * kWidth);
+    return 1;
+  }
+
+  const std::vector<float> a = MakeValues(num_values, -100.0f, 100.0f);
+  std::vector<float> b = MakeValues(num_values, -100.0f, 100.0f);
+  // So that comparisons also see equal values.
+  std::copy_n(a.begin(), num_values / 2, b.begin());
+  const std::vector<float> positive = MakePositiveValues(num_values);
+
+  // Masks are compared as 1 or 0.
+  auto ones = [](FloatX4 mask) { return mask & FloatX4{1.0f}; };
+  auto one = [](bool value) { return value ? 1.0f : 0.0f; };
+  int num_mismatches = 0;
+  num_mismatches += CountMismatches(
+      "+", a, b, [](FloatX4 x, FloatX4 y) { return x + y; },
+      [](float x, float y) { return x + y; });
+  num_mismatches += CountMismatches(
+      "-", a, b, [](FloatX4 x, FloatX4 y) { return x - y; },
+      [](float x, float y) { return x - y; });
+  num_mismatches += CountMismatches(
+      "*", a, b, [](FloatX4 x, FloatX4 y) { return x * y; },
+      [](float x, float y) { return x * y; });
+  num_mismatches += CountMismatches(
+      "/", a, b, [](FloatX4 x, FloatX4 y) { return x / y; },
+      [](float x, float y) { return x / y; });
+  num_mismatches += CountMismatches(
+      "<", a, b, [&](FloatX4 x, FloatX4 y) { return ones(x < y); },
+      [&](float x, float y) { return one(x < y); });
+  num_mismatches += CountMismatches(
+      "<=", a, b, [&](FloatX4 x, FloatX4 y) { return ones(x <= y); },
+      [&](float x, float y) { return one(x <= y); });
+  num_mismatches += CountMismatches(
+      ">", a, b, [&](FloatX4 x, FloatX4 y) { return ones(x > y); },
+      [&](float x, float y) { return one(x > y); });
+  num_mismatches += CountMismatches(
+      ">=", a, b, [&](FloatX4 x, FloatX4 y) { return ones(x >= y); },
+      [&](float x, float y) { return one(x >= y); });
+  num_mismatches += CountMismatches(
+      "|", a, b, [&](FloatX4 x, FloatX4 y) { return ones((x < y) | (x > y)); },
+      [&](float x, float y) { return one(x != y); });
+  num_mismatches += CountMismatches(
+      "Min", a, b, [](FloatX4 x, FloatX4 y) { return Min(x, y); },
+      [](float x, float y) { return std::min(x, y); });
+  num_mismatches += CountMismatches(
+      "Max", a, b, [](FloatX4 x, FloatX4 y) { return Max(x, y); },
+      [](float x, float y) { return std::max(x, y); });
+  num_mismatches += CountMismatches(
+      "Select", a, b, [](FloatX4 x, FloatX4 y) { return Select(x < y, x, y); },
+      [](float x, float y) { return x < y ? x : y; });
+  num_mismatches += CountMismatches(
+      "Abs", a, a, [](FloatX4 x, FloatX4) { return Abs(x); },
+      [](float x, float) { return std::abs(x); });
+  num_mismatches += CountMismatches(
+      "Sqrt", positive, positive, [](FloatX4 x, FloatX4) { return Sqrt(x); },
+      [](float x, float) { return std::sqrt(x); });
+  num_mismatches += CountMismatches(
+      "Floor", a, a, [](FloatX4 x, FloatX4) { return Floor(x); },
+      [](float x, float) { return std::floor(x); });
+  num_mismatches += CountLaneMismatches(a, b);
+  std::printf("%d lanes differ from the scalar operations\n", num_mismatches);
+
+  const double rsqrt_error = MaxRelativeError(
+      positive, [](FloatX4 x) { return RsqrtApprox(x); },
+      [](double x) { return 1 / std::sqrt(x); });
+  const double reciprocal_error = MaxRelativeError(
+      positive, [](FloatX4 x) { return ReciprocalApprox(x); },
+      [](double x) { return 1 / x; });
+  std::printf("max relative error: rsqrt %g, reciprocal %g\n", rsqrt_error,
+              reciprocal_error);
+
+  std::vector<float> results(num_values);
+  std::printf("%-24s %10s\n", "operation", "ns/value");
+  auto report = [&](const char* name, auto run) {
+    const double nanoseconds = NanosecondsPerValue(positive, &results, run);
+    std::printf("%-24s %10.3f   (checksum %g)\n", name, nanoseconds,
+                Checksum(results));
+  };
+  report("1 / sqrt, scalar",
+         [](const std::vector<float>& values, std::vector<float>* results) {
+           MapScalar(values, results,
+                     [](float x) { return 1 / std::sqrt(x); });
+         });
+  report("RsqrtApprox",
+         [](const std::vector<float>& values, std::vector<float>* results) {
+           MapPacked(values, results,
+                     [](FloatX4 x) { return RsqrtApprox(x); });
+         });
+  report("1 / x, scalar",
+         [](const std::vector<float>& values, std::vector<float>* results) {
+           MapScalar(values, results, [](float x) { return 1 / x; });
+         });
+  report("ReciprocalApprox",
+         [](const std::vector<float>& values, std::vector<float>* results) {
+           MapPacked(values, results,
+                     [](FloatX4 x) { return ReciprocalApprox(x); });
+         });
+
+  if (num_mismatches > 0 || rsqrt_error > kApproxTolerance ||
+      reciprocal_error > kApproxTolerance) {
+    std::printf("FAILED\n");
+    return 1;
+  }
+  return 0;
+}
\ No newline at end of file
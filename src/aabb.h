@@ -0,0 +1,84 @@
+#ifndef PEWPEW_AABB_H_
+#define PEWPEW_AABB_H_
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "float.h"
+#include "vec3.h"
+
+// An axis-aligned bounding box. The default box is empty, and grows to hold
+// what is added to it.
+class Aabb {
+ public:
+  Aabb()
+      : min_{std::numeric_limits<Float>::infinity(),
+             std::numeric_limits<Float>::infinity(),
+             std::numeric_limits<Float>::infinity()},
+        max_{-std::numeric_limits<Float>::infinity(),
+             -std::numeric_limits<Float>::infinity(),
+             -std::numeric_limits<Float>::infinity()} {}
+  // The box of two opposite corners, in any order.
+  Aabb(const Point3& a, const Point3& b)
+      : min_{std::min(a.x(), b.x()), std::min(a.y(), b.y()),
+             std::min(a.z(), b.z())},
+        max_{std::max(a.x(), b.x()), std::max(a.y(), b.y()),
+             std::max(a.z(), b.z())} {}
+  // The union of two boxes.
+  Aabb(const Aabb& a, const Aabb& b)
+      : min_{std::min(a.min_.x(), b.min_.x()),
+             std::min(a.min_.y(), b.min_.y()),
+             std::min(a.min_.z(), b.min_.z())},
+        max_{std::max(a.max_.x(), b.max_.x()),
+             std::max(a.max_.y(), b.max_.y()),
+             std::max(a.max_.z(), b.max_.z())} {}
+
+  const Point3& min() const { return min_; }
+  const Point3& max() const { return max_; }
+
+  bool empty() const { return min_.x() > max_.x(); }
+  Point3 Centroid() const { return 0.5 * (min_ + max_); }
+  int LongestAxis() const {
+    const Vec3 extent = max_ - min_;
+    return extent.x() > extent.y() ? (extent.x() > extent.z() ? 0 : 2)
+                                   : (extent.y() > extent.z() ? 1 : 2);
+  }
+  Float SurfaceArea() const {
+    if (empty()) {
+      return 0;
+    }
+    const Vec3 extent = max_ - min_;
+    return 2 * (extent.x() * extent.y() + extent.y() * extent.z() +
+                extent.z() * extent.x());
+  }
+
+  // Whether the ray goes through the box between `tmin` and `tmax`, with the
+  // slab test, and where it enters the box if it does.
+  bool Hit(const Point3& origin, const Vec3& inverse_direction, Float tmin,
+           Float tmax, Float* entry) const {
+    for (int axis = 0; axis < 3; axis++) {
+      Float t0 = (min_[axis] - origin[axis]) * inverse_direction[axis];
+      Float t1 = (max_[axis] - origin[axis]) * inverse_direction[axis];
+      if (t0 > t1) {
+        std::swap(t0, t1);
+      }
+      // Pushes the exit out by more than the rounding errors of `t0` and
+      // `t1`, so that rays grazing the box aren't missed.
+      t1 *= 1 + 4 * std::numeric_limits<Float>::epsilon();
+      tmin = std::max(tmin, t0);
+      tmax = std::min(tmax, t1);
+      if (tmax < tmin) {
+        return false;
+      }
+    }
+    *entry = tmin;
+    return true;
+  }
+
+ private:
+  Point3 min_;
+  Point3 max_;
+};
+
+#endif  // PEWPEW_AABB_H_
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include "alias_table.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "float.h"
+
+AliasTable::AliasTable(const std::vector<Float>& weights)
+    : bins_(weights.size()) {
+  const int size = weights.size();
+  const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+  // Weights scaled so that the average is 1, split into the bins below and
+  // above average.
+  std::vector<double> scaled(size);
+  std::vector<int> small;
+  std::vector<int> large;
+  for (int i = 0; i < size; i++) {
+    bins_[i].probability = weights[i] / sum;
+    scaled[i] = weights[i] / sum * size;
+    (scaled[i] < 1 ? small : large).push_back(i);
+  }
+
+  // Each small bin is topped up by a large one, which may become small.
+  while (!small.empty() && !large.empty()) {
+    const int below = small.back();
+    small.pop_back();
+    const int above = large.back();
+    bins_[below].threshold = scaled[below];
+    bins_[below].alias = above;
+    scaled[above] -= 1 - scaled[below];
+    if (scaled[above] < 1) {
+      large.pop_back();
+      small.push_back(above);
+    }
+  }
+  // What remains is 1 up to rounding.
+  for (const std::vector<int>* remaining : {&small, &large}) {
+    for (int i : *remaining) {
+      bins_[i].threshold = 1;
+      bins_[i].alias = i;
+    }
+  }
+}
+
+int AliasTable::Sample(Float u) const {
+  const Float scaled = u * bins_.size();
+  const int index = std::min(static_cast<int>(scaled),
+                             static_cast<int>(bins_.size()) - 1);
+  return scaled - index < bins_[index].threshold ? index : bins_[index].alias;
+}
\ No newline at end of file
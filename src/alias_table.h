@@ -0,0 +1,33 @@
+#ifndef PEWPEW_ALIAS_TABLE_H_
+#define PEWPEW_ALIAS_TABLE_H_
+
+#include <vector>
+
+#include "float.h"
+
+// Samples indices in proportion to their weights in constant time, with
+// Vose's alias method: each bin keeps its own index below a threshold, and
+// redirects to an alias above it.
+class AliasTable {
+ public:
+  AliasTable() = default;
+  // Weights must be non-negative, with a positive sum.
+  explicit AliasTable(const std::vector<Float>& weights);
+
+  // Maps `u` in [0, 1) to an index.
+  int Sample(Float u) const;
+  // The normalized weight of `index`.
+  Float probability(int index) const { return bins_[index].probability; }
+  int size() const { return bins_.size(); }
+
+ private:
+  struct Bin {
+    Float threshold;
+    int alias;
+    Float probability;
+  };
+
+  std::vector<Bin> bins_;
+};
+
+#endif  // PEWPEW_ALIAS_TABLE_H_
\ No newline at end of file
@@ -3,25 +3,54 @@
 #include <SDL2/SDL.h>
 
 #include <algorithm>
+#include <cmath>
 #include <format>
 #include <functional>
 #include <iostream>
 #include <limits>
 #include <string>
-#include <thread>
 
 #include "app_settings.h"
 #include "camera.h"
 #include "imgui.h"
 #include "imgui_impl_sdl2.h"
 #include "imgui_impl_sdlrenderer2.h"
+#include "render_service.h"
+#include "replay.h"
 
 CameraSettings ToCameraSettings(const AppSettings& settings) {
+  const int image_width = std::max(
+      static_cast<int>(settings.window_width * settings.image_scale_factor),
+      1);
+  const int image_height = std::max(
+      static_cast<int>(settings.window_height * settings.image_scale_factor),
+      1);
+  // Rounded outwards, to at least a pixel.
+  Tile region{0, 0, 0, 0};
+  if (settings.region[2] > 0 && settings.region[3] > 0) {
+    region.x = std::clamp(
+        static_cast<int>(std::floor(settings.region[0] * image_width)), 0,
+        image_width - 1);
+    region.y = std::clamp(
+        static_cast<int>(std::floor(settings.region[1] * image_height)), 0,
+        image_height - 1);
+    region.width =
+        std::clamp(static_cast<int>(std::ceil(
+                       (settings.region[0] + settings.region[2]) *
+                       image_width)),
+                   region.x + 1, image_width) -
+        region.x;
+    region.height =
+        std::clamp(static_cast<int>(std::ceil(
+                       (settings.region[1] + settings.region[3]) *
+                       image_height)),
+                   region.y + 1, image_height) -
+        region.y;
+  }
+
   return CameraSettings{
-      .image_width =
-          static_cast<int>(settings.window_width * settings.image_scale_factor),
-      .image_height = static_cast<int>(settings.window_height *
-                                       settings.image_scale_factor),
+      .image_width = image_width,
+      .image_height = image_height,
       .samples_per_pixel_log2 = settings.samples_per_pixel_log2,
       .max_depth = 1 << settings.max_depth_log2,
       .fov = settings.fov,
@@ -30,32 +59,26 @@ CameraSettings ToCameraSettings(const AppSettings& settings) {
       .view_up = Vec3{settings.view_up},
       .defocus_angle = settings.defocus_angle,
       .focus_distance = settings.focus_distance,
+      .phase_scheduling = settings.enable_time_budget
+                              ? PhaseScheduling::kTimeBudget
+                              : PhaseScheduling::kDoubling,
+      .phase_time_budget_ms = settings.phase_time_budget_ms,
+      .sampler_type = static_cast<SamplerType>(settings.sampler_type),
+      .enable_denoiser = settings.enable_denoiser,
+      .enable_sky = settings.enable_sky,
+      .enable_path_guiding = settings.enable_path_guiding,
+      .enable_primary_hit_cache = settings.enable_primary_hit_cache,
+      .enable_preview = settings.enable_preview,
+      .region = region,
   };
 }
 
-std::string RenderingStateToString(RenderingState state) {
-  std::string result;
-  switch (state) {
-    case RenderingState::kStartRendering:
-      result = "kStartRendering";
-      break;
-    case RenderingState::kRendering:
-      result = "kRendering";
-      break;
-    case RenderingState::kRequestStop:
-      result = "kRequeststop";
-      break;
-    case RenderingState::kUpdateSettings:
-      result = "kUpdateSettings";
-      break;
-    case RenderingState::kIdle:
-      result = "kIdle";
-      break;
-    default:
-      result = "Unknown";
-  }
-
-  return result;
+TonemapSettings ToTonemapSettings(const AppSettings& settings) {
+  return TonemapSettings{
+      .tonemap_operator =
+          static_cast<TonemapOperator>(settings.tonemap_operator),
+      .exposure = settings.exposure,
+  };
 }
 
 void App::Run() {
@@ -66,12 +89,16 @@ void App::Run() {
 
   bool is_running = true;
   while (is_running) {
+    bool has_region_update = false;
+    bool has_size_update = false;
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
       ImGui_ImplSDL2_ProcessEvent(&event);
       if (event.type == SDL_QUIT) {
         is_running = false;
       }
+      has_region_update |= HandleRegionEvent(event);
+      has_size_update |= HandleResizeEvent(event);
     }
 
     ImGui_ImplSDLRenderer2_NewFrame();
@@ -79,48 +106,42 @@ void App::Run() {
     ImGui::NewFrame();
 
     SettingsUpdateType last_update_type = ShowDebugWindow();
-    if (last_update_type > settings_update_type_) {
-      settings_update_requested_ = true;
-      settings_update_type_ = last_update_type;
+    if (replay_ != nullptr) {
+      last_update_type =
+          std::max(last_update_type, replay_->Advance(&settings_));
     }
-
-    NextState();
-
-    if (rendering_state_ == RenderingState::kStartRendering &&
-        settings_.enable_rendering && !camera_.is_rendering()) {
-      camera_.InitializePhase();
-      rendering_thread_ = std::jthread{
-          std::bind_front(&Camera::Render, &camera_), std::cref(world_)};
-    } else if (rendering_state_ == RenderingState::kRequestStop &&
-               !rendering_thread_.get_stop_source().stop_requested()) {
-      rendering_thread_.get_stop_source().request_stop();
-    } else if (rendering_state_ == RenderingState::kUpdateSettings) {
-      camera_.set_settings(ToCameraSettings(settings_));
-      camera_.Initialize(settings_update_type_);
-
-      if (settings_update_type_ ==
-          SettingsUpdateType::kUpdateTextureAndSettings) {
-        SDL_DestroyTexture(texture_);
-        bool success = CreateTexture();
-        if (!success) {
-          break;
-        }
-      }
-
-      settings_update_requested_ = false;
-      settings_update_type_ = SettingsUpdateType::kNoUpdates;
+    if (has_region_update &&
+        last_update_type < SettingsUpdateType::kUpdateSettings) {
+      last_update_type = SettingsUpdateType::kUpdateSettings;
+    }
+    if (has_size_update) {
+      last_update_type = SettingsUpdateType::kUpdateTextureAndSettings;
+    }
+    if (last_update_type != SettingsUpdateType::kNoUpdates) {
+      UpdateRender(last_update_type);
     }
 
     bool success = Render();
     if (!success) {
       break;
     }
+    if (replay_ != nullptr && replay_->done()) {
+      is_running = false;
+    }
   }
 }
 
 bool App::Initialize() {
-  camera_.Initialize(SettingsUpdateType::kUpdateTextureAndSettings);
-
+  render_service_.WithCamera([this](Camera* camera) {
+    camera->Initialize(SettingsUpdateType::kUpdateTextureAndSettings);
+    camera->set_tonemap_settings(ToTonemapSettings(settings_));
+  });
+
+  // Replays measure the renderer rather than the display. The environment
+  // takes precedence over the hint.
+  if (replay_ != nullptr) {
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+  }
   if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     std::cerr << "Error calling SDL_Init: " << SDL_GetError() << std::endl;
     return false;
@@ -137,29 +158,41 @@ bool App::Initialize() {
 
   renderer_ = SDL_CreateRenderer(
       window_, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+  // E.g. with the dummy video driver.
+  if (renderer_ == nullptr) {
+    renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_SOFTWARE);
+  }
   if (renderer_ == nullptr) {
     std::cerr << "Error calling SDL_CreateRenderer: " << SDL_GetError()
               << std::endl;
     return false;
   }
 
-  bool success = CreateTexture();
-  if (!success) {
-    return false;
-  }
-
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
   ImGui_ImplSDL2_InitForSDLRenderer(window_, renderer_);
   ImGui_ImplSDLRenderer2_Init(renderer_);
 
+  if (settings_.enable_rendering) {
+    render_service_.Submit(RenderJob{
+        .world = &world_,
+        .settings = ToCameraSettings(settings_),
+        .update_type = SettingsUpdateType::kNoUpdates,
+    });
+  }
+
   return true;
 }
 
-bool App::CreateTexture() {
-  texture_ = SDL_CreateTexture(
-      renderer_, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
-      camera_.settings().image_width, camera_.settings().image_height);
+bool App::CreateTexture(const Camera& camera) {
+  if (texture_ != nullptr) {
+    SDL_DestroyTexture(texture_);
+  }
+  texture_width_ = camera.settings().image_width;
+  texture_height_ = camera.settings().image_height;
+  texture_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_ARGB8888,
+                               SDL_TEXTUREACCESS_STREAMING, texture_width_,
+                               texture_height_);
   if (texture_ == nullptr) {
     std::cerr << "Error calling SDL_CreateTexture: " << SDL_GetError()
               << std::endl;
@@ -169,50 +202,23 @@ bool App::CreateTexture() {
   return true;
 }
 
-void App::NextState() {
-  switch (rendering_state_) {
-    case RenderingState::kStartRendering:
-      if (camera_.is_rendering()) {
-        rendering_state_ = RenderingState::kRendering;
-      } else {
-        rendering_state_ = RenderingState::kStartRendering;
-      }
-      break;
-    case RenderingState::kRendering:
-      if (settings_update_requested_) {
-        rendering_state_ = RenderingState::kRequestStop;
-      } else if (camera_.done_rendering()) {
-        rendering_state_ = RenderingState::kIdle;
-      } else if (camera_.is_rendering()) {
-        rendering_state_ = RenderingState::kRendering;
-      } else {
-        rendering_state_ = RenderingState::kStartRendering;
-      }
-      break;
-    case RenderingState::kRequestStop:
-      if (camera_.is_rendering()) {
-        rendering_state_ = RenderingState::kRequestStop;
-      } else {
-        rendering_state_ = RenderingState::kUpdateSettings;
-      }
-      break;
-    case RenderingState::kUpdateSettings:
-      if (settings_update_requested_) {
-        rendering_state_ = RenderingState::kUpdateSettings;
-      } else if (settings_.enable_rendering) {
-        rendering_state_ = RenderingState::kStartRendering;
-      } else {
-        rendering_state_ = RenderingState::kIdle;
-      }
-      break;
-    case RenderingState::kIdle:
-      if (settings_update_requested_) {
-        rendering_state_ = RenderingState::kUpdateSettings;
-      } else {
-        rendering_state_ = RenderingState::kIdle;
-      }
-      break;
+void App::UpdateRender(SettingsUpdateType type) {
+  if (!settings_.enable_rendering) {
+    render_service_.Cancel();
+    disabled_update_type_ = std::max(disabled_update_type_, type);
+    return;
   }
+
+  // Previews are shown right away, and the worker doesn't wait for a frame
+  // to start the next phase.
+  render_service_.Submit(
+      RenderJob{
+          .world = &world_,
+          .settings = ToCameraSettings(settings_),
+          .update_type = std::max(disabled_update_type_, type),
+      },
+      replay_ != nullptr ? replay_->MakePhaseCallback() : nullptr);
+  disabled_update_type_ = SettingsUpdateType::kNoUpdates;
 }
 
 bool App::Render() {
@@ -222,16 +228,36 @@ bool App::Render() {
     return false;
   }
 
-  void* pixels;
-  int pitch;
-  if (SDL_LockTexture(texture_, nullptr, &pixels, &pitch) < 0) {
-    std::cerr << "Error calling SDL_LockTexture: " << SDL_GetError()
-              << std::endl;
-    return false;
+  if (replay_ != nullptr) {
+    replay_->StartFrame();
   }
+  bool success = true;
+  render_service_.WithCamera([this, &success](Camera* camera) {
+    // The texture follows the image once it is resized, which may take a few
+    // frames to stop the render.
+    if (texture_width_ != camera->settings().image_width ||
+        texture_height_ != camera->settings().image_height) {
+      success = CreateTexture(*camera);
+      if (!success) {
+        return;
+      }
+    }
 
-  camera_.CopyTo(static_cast<int*>(pixels));
-  SDL_UnlockTexture(texture_);
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(texture_, nullptr, &pixels, &pitch) < 0) {
+      std::cerr << "Error calling SDL_LockTexture: " << SDL_GetError()
+                << std::endl;
+      success = false;
+      return;
+    }
+
+    camera->CopyTo(pixels, pitch);
+    SDL_UnlockTexture(texture_);
+  });
+  if (!success) {
+    return false;
+  }
 
   if (SDL_RenderCopy(renderer_, texture_, nullptr, nullptr) < 0) {
     std::cerr << "Error calling SDL_RenderCopy: " << SDL_GetError()
@@ -239,14 +265,127 @@ bool App::Render() {
     return false;
   }
 
+  if (!DrawRegion()) {
+    return false;
+  }
+
   ImGui::Render();
   ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData(), renderer_);
 
   SDL_RenderPresent(renderer_);
+  if (replay_ != nullptr) {
+    replay_->FinishFrame();
+  }
 
   return true;
 }
 
+bool App::HandleResizeEvent(const SDL_Event& event) {
+  if (event.type != SDL_WINDOWEVENT ||
+      event.window.event != SDL_WINDOWEVENT_SIZE_CHANGED ||
+      event.window.data1 <= 0 || event.window.data2 <= 0 ||
+      (event.window.data1 == settings_.window_width &&
+       event.window.data2 == settings_.window_height)) {
+    return false;
+  }
+
+  settings_.window_width = event.window.data1;
+  settings_.window_height = event.window.data2;
+  return true;
+}
+
+bool App::HandleRegionEvent(const SDL_Event& event) {
+  int window_width = 0;
+  int window_height = 0;
+  SDL_GetWindowSize(window_, &window_width, &window_height);
+  if (window_width <= 0 || window_height <= 0) {
+    return false;
+  }
+  auto to_window_fraction = [&](int x, int y, float* point) {
+    point[0] = std::clamp(x / static_cast<float>(window_width), 0.0f, 1.0f);
+    point[1] = std::clamp(y / static_cast<float>(window_height), 0.0f, 1.0f);
+  };
+
+  switch (event.type) {
+    case SDL_MOUSEBUTTONDOWN:
+      if (event.button.button == SDL_BUTTON_RIGHT &&
+          !ImGui::GetIO().WantCaptureMouse) {
+        is_dragging_region_ = true;
+        to_window_fraction(event.button.x, event.button.y, drag_start_);
+        to_window_fraction(event.button.x, event.button.y, drag_end_);
+      }
+      return false;
+    case SDL_MOUSEMOTION:
+      if (is_dragging_region_) {
+        to_window_fraction(event.motion.x, event.motion.y, drag_end_);
+      }
+      return false;
+    case SDL_MOUSEBUTTONUP: {
+      if (event.button.button != SDL_BUTTON_RIGHT || !is_dragging_region_) {
+        return false;
+      }
+      is_dragging_region_ = false;
+      to_window_fraction(event.button.x, event.button.y, drag_end_);
+
+      // Regions of a few pixels are clicks, which clear the region.
+      const int min_drag_pixels = 4;
+      const float width = std::abs(drag_end_[0] - drag_start_[0]);
+      const float height = std::abs(drag_end_[1] - drag_start_[1]);
+      if (width * window_width < min_drag_pixels ||
+          height * window_height < min_drag_pixels) {
+        const bool had_region = settings_.region[2] > 0;
+        settings_.region[2] = 0.0f;
+        settings_.region[3] = 0.0f;
+        return had_region;
+      }
+      settings_.region[0] = std::min(drag_start_[0], drag_end_[0]);
+      settings_.region[1] = std::min(drag_start_[1], drag_end_[1]);
+      settings_.region[2] = width;
+      settings_.region[3] = height;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+bool App::DrawRegion() {
+  float start[2];
+  float size[2];
+  if (is_dragging_region_) {
+    for (int k = 0; k < 2; k++) {
+      start[k] = std::min(drag_start_[k], drag_end_[k]);
+      size[k] = std::abs(drag_end_[k] - drag_start_[k]);
+    }
+  } else if (settings_.region[2] > 0) {
+    for (int k = 0; k < 2; k++) {
+      start[k] = settings_.region[k];
+      size[k] = settings_.region[2 + k];
+    }
+  } else {
+    return true;
+  }
+
+  int output_width;
+  int output_height;
+  if (SDL_GetRendererOutputSize(renderer_, &output_width, &output_height) <
+      0) {
+    std::cerr << "Error calling SDL_GetRendererOutputSize: " << SDL_GetError()
+              << std::endl;
+    return false;
+  }
+  const SDL_Rect rect{static_cast<int>(start[0] * output_width),
+                      static_cast<int>(start[1] * output_height),
+                      static_cast<int>(size[0] * output_width),
+                      static_cast<int>(size[1] * output_height)};
+  if (SDL_SetRenderDrawColor(renderer_, 255, 255, 0, 255) < 0 ||
+      SDL_RenderDrawRect(renderer_, &rect) < 0) {
+    std::cerr << "Error drawing the region: " << SDL_GetError() << std::endl;
+    return false;
+  }
+  return true;
+}
+
 SettingsUpdateType App::ShowDebugWindow() {
   bool has_texture_update = false;
   bool has_settings_update = false;
@@ -255,34 +394,68 @@ SettingsUpdateType App::ShowDebugWindow() {
 
   ImGui::SeparatorText("Render status");
 
-  ImGui::Text("State: %s", RenderingStateToString(rendering_state_).c_str());
+  ImGui::Text("State: %s",
+              render_service_.is_busy() ? "Rendering" : "Idle");
 
   has_settings_update |=
       ImGui::Checkbox("Rendering", &settings_.enable_rendering);
 
-  ImGui::Text("Global render time: %.fms", camera_.global_render_time());
-  ImGui::Text("Phase render time: %.fms", camera_.phase_render_time());
-  ImGui::Text("Phase samples per pixel: %d",
-              camera_.current_phase_samples_per_pixel());
+  CameraSettings camera_settings;
+  render_service_.WithCamera([&camera_settings](Camera* camera) {
+    camera_settings = camera->settings();
+
+    ImGui::Text("Global render time: %.fms", camera->global_render_time());
+    ImGui::Text("Phase render time: %.fms", camera->phase_render_time());
+    if (camera->preview_stride() > 1) {
+      ImGui::Text("Next preview: 1/%d resolution", camera->preview_stride());
+    } else {
+      ImGui::Text("Phase %d samples per pixel: %d", camera->current_phase(),
+                  camera->current_phase_samples_per_pixel());
+    }
 
-  int current_phase = camera_.current_phase();
-  int last_phase = camera_.last_phase();
-  float global_progress = current_phase / static_cast<float>(last_phase);
-  std::string overlay = std::format("{}/{}", current_phase, last_phase);
-  ImGui::ProgressBar(global_progress, ImVec2(0.0f, 0.0f), overlay.c_str());
-  ImGui::SameLine(0.0f, ImGui::GetStyle().ItemInnerSpacing.x);
-  ImGui::Text("Global progress");
+    int accumulated_samples = camera->accumulated_samples_per_pixel();
+    int target_samples = camera->target_samples_per_pixel();
+    float global_progress =
+        accumulated_samples / static_cast<float>(target_samples);
+    std::string overlay =
+        std::format("{}/{} spp", accumulated_samples, target_samples);
+    ImGui::ProgressBar(global_progress, ImVec2(0.0f, 0.0f), overlay.c_str());
+    ImGui::SameLine(0.0f, ImGui::GetStyle().ItemInnerSpacing.x);
+    ImGui::Text("Global progress");
+
+    ImGui::ProgressBar(camera->Progress(), ImVec2(0.0f, 0.0f));
+    ImGui::SameLine(0.0f, ImGui::GetStyle().ItemInnerSpacing.x);
+    ImGui::Text("Phase progress");
+  });
 
-  ImGui::ProgressBar(camera_.Progress(), ImVec2(0.0f, 0.0f));
-  ImGui::SameLine(0.0f, ImGui::GetStyle().ItemInnerSpacing.x);
-  ImGui::Text("Phase progress");
+  has_settings_update |=
+      ImGui::Checkbox("Time-budgeted phases", &settings_.enable_time_budget);
+  if (settings_.enable_time_budget) {
+    has_settings_update |= ImGui::DragFloat(
+        "Phase time budget", &settings_.phase_time_budget_ms,
+        /*v_speed=*/1.0f, /*v_min=*/1.0f, /*v_max=*/10000.0f, "%.fms");
+  }
 
   ImGui::SeparatorText("Camera settings");
 
   ImGui::Text("Window size: %dx%d", settings_.window_width,
               settings_.window_height);
-  ImGui::Text("Image size: %dx%d", camera_.settings().image_width,
-              camera_.settings().image_height);
+  ImGui::Text("Image size: %dx%d", camera_settings.image_width,
+              camera_settings.image_height);
+
+  const Tile& region = camera_settings.region;
+  if (region.width > 0) {
+    ImGui::Text("Region: %dx%d at (%d, %d)", region.width, region.height,
+                region.x, region.y);
+    ImGui::SameLine(0.0f, ImGui::GetStyle().ItemInnerSpacing.x);
+    if (ImGui::Button("Clear")) {
+      settings_.region[2] = 0.0f;
+      settings_.region[3] = 0.0f;
+      has_settings_update = true;
+    }
+  } else {
+    ImGui::Text("Region: right-drag over the image");
+  }
 
   const int max_texture_size = 4096;
   const float max_scale_factor =
@@ -299,6 +472,21 @@ SettingsUpdateType App::ShowDebugWindow() {
                      /*v_speed=*/0.1f,
                      /*v_min=*/0, /*v_max=*/12, samples_per_pixel.c_str());
 
+  const char* sampler_types[] = {"Independent", "Stratified", "Sobol",
+                                 "Blue noise"};
+  has_settings_update |=
+      ImGui::Combo("Sampler", &settings_.sampler_type, sampler_types,
+                   IM_ARRAYSIZE(sampler_types));
+
+  has_settings_update |=
+      ImGui::Checkbox("Denoiser", &settings_.enable_denoiser);
+  has_settings_update |=
+      ImGui::Checkbox("Path guiding", &settings_.enable_path_guiding);
+  has_settings_update |= ImGui::Checkbox("Cache primary hits",
+                                         &settings_.enable_primary_hit_cache);
+  has_settings_update |=
+      ImGui::Checkbox("Coarse preview", &settings_.enable_preview);
+
   const int max_int_log2 = 30;
   std::string max_depth = std::to_string(1 << settings_.max_depth_log2);
   has_settings_update |=
@@ -326,6 +514,24 @@ SettingsUpdateType App::ShowDebugWindow() {
       /*v_speed=*/0.1f,
       /*v_min=*/0.1f, std::numeric_limits<float>::max(), "%.1f");
 
+  has_settings_update |= ImGui::Checkbox("Sky", &settings_.enable_sky);
+
+  ImGui::SeparatorText("Display settings");
+
+  bool has_tonemap_update = false;
+  const char* tonemap_operators[] = {"Clamp", "ACES", "Filmic"};
+  has_tonemap_update |=
+      ImGui::Combo("Tonemap", &settings_.tonemap_operator, tonemap_operators,
+                   IM_ARRAYSIZE(tonemap_operators));
+  has_tonemap_update |=
+      ImGui::DragFloat("Exposure", &settings_.exposure, /*v_speed=*/0.1f,
+                       /*v_min=*/-10.0f, /*v_max=*/10.0f, "%.1f EV");
+  if (has_tonemap_update) {
+    render_service_.WithCamera([this](Camera* camera) {
+      camera->set_tonemap_settings(ToTonemapSettings(settings_));
+    });
+  }
+
   ImGui::End();
 
   if (has_texture_update) {
@@ -3,15 +3,15 @@
 
 #include <SDL2/SDL.h>
 
-#include <string>
-#include <thread>
-
 #include "app_settings.h"
 #include "camera.h"
-#include "hittable_list.h"
+#include "hittable.h"
 #include "imgui.h"
 #include "imgui_impl_sdl2.h"
 #include "imgui_impl_sdlrenderer2.h"
+#include "light_list.h"
+#include "render_service.h"
+#include "tonemap.h"
 
 struct AppSettings {
   int window_width;
@@ -29,29 +29,40 @@ struct AppSettings {
   float view_up[3];
   float defocus_angle;
   float focus_distance;
+  bool enable_sky;
+  bool enable_time_budget;
+  float phase_time_budget_ms;
+  // A `SamplerType`, stored as an int for ImGui.
+  int sampler_type;
+  bool enable_denoiser;
+  bool enable_path_guiding;
+  bool enable_primary_hit_cache;
+  bool enable_preview;
+  // The region to render, as fractions of the image: x, y, width and height.
+  // The whole image if the width is 0.
+  float region[4];
+
+  // Display settings, which don't restart the render.
+  // A `TonemapOperator`, stored as an int for ImGui.
+  int tonemap_operator;
+  float exposure;
 };
 
-CameraSettings ToCameraSettings(const AppSettings& settings);
-
-enum class RenderingState {
-  kStartRendering,
-  kRendering,
-  kRequestStop,
-  kUpdateSettings,
-  kIdle,
-};
+class Replay;
 
-std::string RenderingStateToString(RenderingState state);
+CameraSettings ToCameraSettings(const AppSettings& settings);
+TonemapSettings ToTonemapSettings(const AppSettings& settings);
 
 class App {
  public:
-  App(const AppSettings& settings, const HittableList& world)
+  App(const AppSettings& settings, const Hittable& world,
+      const LightList* lights)
       : settings_(settings),
         world_(world),
         camera_(ToCameraSettings(settings)),
-        rendering_state_(RenderingState::kStartRendering),
-        settings_update_requested_(false),
-        settings_update_type_(SettingsUpdateType::kNoUpdates) {}
+        render_service_(&camera_) {
+    camera_.set_lights(lights);
+  }
 
   ~App() {
     ImGui_ImplSDLRenderer2_Shutdown();
@@ -72,23 +83,45 @@ class App {
 
   void Run();
 
+  // Replays scripted edits, offscreen unless `SDL_VIDEODRIVER` says
+  // otherwise, and quits once the last is shown. Owned by the caller.
+  void set_replay(Replay* replay) { replay_ = replay; }
+
  private:
   bool Initialize();
   bool Render();
-  bool CreateTexture();
-  void NextState();
+  // Needs the camera, through `render_service_`.
+  bool CreateTexture(const Camera& camera);
+  // Restarts the render with the settings, or only records the update while
+  // rendering is disabled.
+  void UpdateRender(SettingsUpdateType type);
   SettingsUpdateType ShowDebugWindow();
+  // Right-dragging over the image sets the region, and right-clicking clears
+  // it. Returns whether the region changed.
+  bool HandleRegionEvent(const SDL_Event& event);
+  // Follows the window size. Returns whether it changed.
+  bool HandleResizeEvent(const SDL_Event& event);
+  // Outlines the region, or the one being dragged.
+  bool DrawRegion();
 
   AppSettings settings_;
-  const HittableList& world_;
+  const Hittable& world_;
   Camera camera_;
-  RenderingState rendering_state_;
-  bool settings_update_requested_;
-  SettingsUpdateType settings_update_type_;
+  // Renders with `camera_`, which is only used through it once it renders.
+  RenderService render_service_;
+  // The updates made while rendering was disabled.
+  SettingsUpdateType disabled_update_type_ = SettingsUpdateType::kNoUpdates;
   SDL_Window* window_;
   SDL_Renderer* renderer_;
-  SDL_Texture* texture_;
-  std::jthread rendering_thread_;
+  SDL_Texture* texture_ = nullptr;
+  // Reallocated by `Render` when the image size differs.
+  int texture_width_ = 0;
+  int texture_height_ = 0;
+  Replay* replay_ = nullptr;
+  bool is_dragging_region_ = false;
+  // In fractions of the window.
+  float drag_start_[2];
+  float drag_end_[2];
 };
 
 #endif  // PEWPEW_APP_H_
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "aabb.h"
+#include "float.h"
+#include "hittable.h"
+#include "ray.h"
+#include "vec3.h"
+
+namespace {
+
+constexpr int kNumBins = 12;
+// The cost of visiting a node, relative to intersecting an object.
+constexpr Float kTraversalCost = 0.5;
+// Deeper nodes are split in halves, which bounds the depth of the tree, hence
+// the size of the traversal stack.
+constexpr int kMaxSahDepth = 32;
+constexpr int kStackSize = 64;
+
+struct StackEntry {
+  int node;
+  // Where the ray enters the node's box.
+  Float entry;
+};
+
+Vec3 InverseDirection(const Ray& ray) {
+  return Vec3{1 / ray.direction().x(), 1 / ray.direction().y(),
+              1 / ray.direction().z()};
+}
+
+}  // namespace
+
+Bvh::Bvh(const std::vector<std::shared_ptr<Hittable>>& objects) {
+  if (objects.empty()) {
+    nodes_.push_back(Node{Aabb{}, 0, 0});
+    return;
+  }
+
+  std::vector<BuildObject> build_objects;
+  build_objects.reserve(objects.size());
+  for (size_t i = 0; i < objects.size(); i++) {
+    const Aabb bounds = objects[i]->BoundingBox();
+    build_objects.push_back(
+        BuildObject{bounds, bounds.Centroid(), static_cast<int>(i)});
+  }
+  nodes_.reserve(2 * objects.size());
+  objects_.reserve(objects.size());
+  Build(&build_objects, 0, build_objects.size(), /*depth=*/0, objects);
+}
+
+int Bvh::Build(std::vector<BuildObject>* objects, int begin, int end,
+               int depth,
+               const std::vector<std::shared_ptr<Hittable>>& source) {
+  const int index = nodes_.size();
+  nodes_.emplace_back();
+
+  Aabb bounds;
+  Aabb centroid_bounds;
+  for (int i = begin; i < end; i++) {
+    const BuildObject& object = (*objects)[i];
+    bounds = Aabb{bounds, object.bounds};
+    centroid_bounds =
+        Aabb{centroid_bounds, Aabb{object.centroid, object.centroid}};
+  }
+
+  const int count = end - begin;
+  auto make_leaf = [&] {
+    nodes_[index] = Node{bounds, static_cast<int>(objects_.size()), count};
+    for (int i = begin; i < end; i++) {
+      objects_.push_back(source[(*objects)[i].index]);
+    }
+    return index;
+  };
+  if (count == 1) {
+    return make_leaf();
+  }
+
+  const int axis = centroid_bounds.LongestAxis();
+  const Float axis_min = centroid_bounds.min()[axis];
+  const Float axis_extent = centroid_bounds.max()[axis] - axis_min;
+  auto bin_of = [&](const BuildObject& object) {
+    return std::min(static_cast<int>(kNumBins * (object.centroid[axis] -
+                                                 axis_min) /
+                                     axis_extent),
+                    kNumBins - 1);
+  };
+
+  int middle = begin + count / 2;
+  if (axis_extent <= 0) {
+    // Objects at the same place can't be told apart by a split.
+    if (count <= kMaxLeafSize) {
+      return make_leaf();
+    }
+    std::nth_element(objects->begin() + begin, objects->begin() + middle,
+                     objects->begin() + end,
+                     [](const BuildObject& a, const BuildObject& b) {
+                       return a.index < b.index;
+                     });
+  } else if (depth >= kMaxSahDepth) {
+    std::nth_element(objects->begin() + begin, objects->begin() + middle,
+                     objects->begin() + end,
+                     [axis](const BuildObject& a, const BuildObject& b) {
+                       return a.centroid[axis] < b.centroid[axis];
+                     });
+  } else {
+    Aabb bin_bounds[kNumBins];
+    int bin_counts[kNumBins] = {};
+    for (int i = begin; i < end; i++) {
+      const int bin = bin_of((*objects)[i]);
+      bin_bounds[bin] = Aabb{bin_bounds[bin], (*objects)[i].bounds};
+      bin_counts[bin]++;
+    }
+
+    // The cost of splitting after each bin, sweeping from the right, then
+    // from the left.
+    Float right_costs[kNumBins - 1];
+    Aabb right_bounds;
+    int right_count = 0;
+    for (int split = kNumBins - 2; split >= 0; split--) {
+      right_bounds = Aabb{right_bounds, bin_bounds[split + 1]};
+      right_count += bin_counts[split + 1];
+      right_costs[split] = right_count * right_bounds.SurfaceArea();
+    }
+    Aabb left_bounds;
+    int left_count = 0;
+    int best_split = 0;
+    Float best_cost = std::numeric_limits<Float>::infinity();
+    for (int split = 0; split < kNumBins - 1; split++) {
+      left_bounds = Aabb{left_bounds, bin_bounds[split]};
+      left_count += bin_counts[split];
+      const Float cost =
+          left_count * left_bounds.SurfaceArea() + right_costs[split];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_split = split;
+      }
+    }
+
+    const Float area = std::max<Float>(bounds.SurfaceArea(), 1e-12);
+    best_cost = kTraversalCost + best_cost / area;
+    if (count <= kMaxLeafSize && count <= best_cost) {
+      return make_leaf();
+    }
+    middle = std::partition(objects->begin() + begin, objects->begin() + end,
+                            [&](const BuildObject& object) {
+                              return bin_of(object) <= best_split;
+                            }) -
+             objects->begin();
+  }
+
+  Build(objects, begin, middle, depth + 1, source);
+  const int second_child = Build(objects, middle, end, depth + 1, source);
+  nodes_[index] = Node{bounds, second_child, 0};
+  return index;
+}
+
+std::optional<HitRecord> Bvh::Hit(const Ray& ray, Float tmin,
+                                  Float tmax) const {
+  const Point3& origin = ray.origin();
+  const Vec3 inverse_direction = InverseDirection(ray);
+  Float closest = tmax;
+  std::optional<HitRecord> record;
+
+  StackEntry stack[kStackSize];
+  int stack_size = 0;
+  Float entry;
+  if (nodes_[0].bounds.Hit(origin, inverse_direction, tmin, closest,
+                           &entry)) {
+    stack[stack_size++] = StackEntry{0, entry};
+  }
+  while (stack_size > 0) {
+    const StackEntry top = stack[--stack_size];
+    if (top.entry > closest) {
+      continue;
+    }
+
+    const Node& node = nodes_[top.node];
+    if (node.count > 0) {
+      for (int i = node.offset; i < node.offset + node.count; i++) {
+        std::optional<HitRecord> object_record =
+            objects_[i]->Hit(ray, tmin, closest);
+        if (object_record.has_value()) {
+          closest = object_record->t();
+          record = object_record;
+        }
+      }
+      continue;
+    }
+
+    // The nearer child is visited first, so that it shortens the ray.
+    const int first = top.node + 1;
+    const int second = node.offset;
+    Float first_entry;
+    Float second_entry;
+    const bool hits_first = nodes_[first].bounds.Hit(
+        origin, inverse_direction, tmin, closest, &first_entry);
+    const bool hits_second = nodes_[second].bounds.Hit(
+        origin, inverse_direction, tmin, closest, &second_entry);
+    if (hits_first && hits_second) {
+      if (first_entry <= second_entry) {
+        stack[stack_size++] = StackEntry{second, second_entry};
+        stack[stack_size++] = StackEntry{first, first_entry};
+      } else {
+        stack[stack_size++] = StackEntry{first, first_entry};
+        stack[stack_size++] = StackEntry{second, second_entry};
+      }
+    } else if (hits_first) {
+      stack[stack_size++] = StackEntry{first, first_entry};
+    } else if (hits_second) {
+      stack[stack_size++] = StackEntry{second, second_entry};
+    }
+  }
+  return record;
+}
+
+Float Bvh::Transmittance(const Ray& ray, Float tmin, Float tmax) const {
+  const Point3& origin = ray.origin();
+  const Vec3 inverse_direction = InverseDirection(ray);
+  Float transmittance = 1;
+
+  int stack[kStackSize];
+  int stack_size = 0;
+  stack[stack_size++] = 0;
+  while (stack_size > 0) {
+    const Node& node = nodes_[stack[--stack_size]];
+    Float entry;
+    if (!node.bounds.Hit(origin, inverse_direction, tmin, tmax, &entry)) {
+      continue;
+    }
+
+    if (node.count > 0) {
+      for (int i = node.offset; i < node.offset + node.count; i++) {
+        transmittance *= objects_[i]->Transmittance(ray, tmin, tmax);
+        if (transmittance == 0) {
+          return 0;
+        }
+      }
+      continue;
+    }
+    stack[stack_size++] = node.offset;
+    stack[stack_size++] = &node - nodes_.data() + 1;
+  }
+  return transmittance;
+}
\ No newline at end of file
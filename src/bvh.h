@@ -0,0 +1,59 @@
+#ifndef PEWPEW_BVH_H_
+#define PEWPEW_BVH_H_
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "aabb.h"
+#include "float.h"
+#include "hittable.h"
+#include "ray.h"
+
+// A binary bounding volume hierarchy over the objects of a scene, split with
+// the surface area heuristic over binned centroids.
+class Bvh : public Hittable {
+ public:
+  // Nodes are stored depth first: the first child of an interior node is the
+  // next node.
+  struct Node {
+    Aabb bounds;
+    // The second child of interior nodes, or the first object of leaves.
+    int offset;
+    // The number of objects of leaves, 0 for interior nodes.
+    int count;
+  };
+
+  static constexpr int kMaxLeafSize = 2;
+
+  explicit Bvh(const std::vector<std::shared_ptr<Hittable>>& objects);
+
+  std::optional<HitRecord> Hit(const Ray& ray, Float tmin,
+                               Float tmax) const override;
+  Aabb BoundingBox() const override { return nodes_[0].bounds; }
+  Float Transmittance(const Ray& ray, Float tmin, Float tmax) const override;
+
+  const std::vector<Node>& nodes() const { return nodes_; }
+  // In the order of the leaves.
+  const std::vector<std::shared_ptr<Hittable>>& objects() const {
+    return objects_;
+  }
+  size_t NodeBytes() const { return nodes_.size() * sizeof(Node); }
+
+ private:
+  struct BuildObject {
+    Aabb bounds;
+    Point3 centroid;
+    int index;
+  };
+
+  // Builds the subtree of `objects[begin, end)`, and returns its root.
+  int Build(std::vector<BuildObject>* objects, int begin, int end, int depth,
+            const std::vector<std::shared_ptr<Hittable>>& source);
+
+  std::vector<Node> nodes_;
+  std::vector<std::shared_ptr<Hittable>> objects_;
+};
+
+#endif  // PEWPEW_BVH_H_
\ No newline at end of file
@@ -1,44 +1,349 @@
 #include "camera.h"
 
+#include <omp.h>
+
+#include <algorithm>
+#include <bit>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <stop_token>
+#include <string>
+#include <vector>
 
 #include "app_settings.h"
+#include "checkpoint.h"
 #include "color.h"
+#include "denoiser.h"
 #include "float.h"
 #include "hittable.h"
 #include "material.h"
+#include "numa.h"
+#include "path_guide.h"
 #include "ray.h"
+#include "sampler.h"
+#include "tonemap.h"
 #include "utils.h"
 #include "vec3.h"
 
+namespace {
+
+// The probability of sampling the guide rather than the material, on the
+// bounces where the guide has learned enough.
+constexpr Float kGuideProbability = 0.5;
+constexpr Float kGuideCellPixels = 8;
+// The blocks of the first preview phase, then of the next ones, halved down
+// to the last.
+constexpr int kFirstPreviewStride = 8;
+constexpr int kLastPreviewStride = 4;
+// Where rays start, past their origin, so that they don't hit the surface
+// they leave.
+constexpr Float kMinHitDistance = 0.001;
+
+// Whether images rendered with either settings converge to the same picture,
+// whatever their size.
+bool SameView(const CameraSettings& a, const CameraSettings& b) {
+  return a.max_depth == b.max_depth && a.fov == b.fov &&
+         a.look_from == b.look_from && a.look_at == b.look_at &&
+         a.view_up == b.view_up && a.defocus_angle == b.defocus_angle &&
+         a.focus_distance == b.focus_distance && a.enable_sky == b.enable_sky;
+}
+
+// `settings.region`, or the whole image if it is empty.
+Tile RegionOf(const CameraSettings& settings) {
+  if (settings.region.width <= 0 || settings.region.height <= 0) {
+    return Tile{0, 0, settings.image_width, settings.image_height};
+  }
+  return settings.region;
+}
+
+// Whether either settings render the same picture, whatever their region.
+bool SameSettingsButRegion(CameraSettings a, CameraSettings b) {
+  a.region = {};
+  b.region = {};
+  return a == b;
+}
+
+}  // namespace
+
 void Camera::Initialize(SettingsUpdateType type) {
+  // Region-only changes keep the samples of every pixel, and the region
+  // carries on from those its pixels hold least of.
+  const bool keeps_samples =
+      type == SettingsUpdateType::kUpdateSettings &&
+      warm_start_data_.empty() &&
+      row_samples_per_pixel_.size() ==
+          static_cast<size_t>(settings_.image_height) &&
+      SameSettingsButRegion(initialized_settings_, settings_);
+  const int region_samples_per_pixel = keeps_samples ? KeepSamples() : -1;
+  // Resizing keeps the image, resampled, until phases catch up with it.
+  if (type == SettingsUpdateType::kUpdateTextureAndSettings &&
+      SameView(initialized_settings_, settings_)) {
+    ResampleWarmStart();
+  } else {
+    warm_start_data_ = {};
+    warm_start_weights_ = {};
+    warm_start_samples_per_pixel_ = 0;
+  }
+  if (!keeps_samples) {
+    kept_samples_per_pixel_ = {};
+  }
+  initialized_settings_ = settings_;
+  row_samples_per_pixel_.assign(settings_.image_height, 0);
+  const Tile region = Region();
+  if (region_samples_per_pixel > 0) {
+    std::fill_n(&row_samples_per_pixel_[region.y], region.height,
+                region_samples_per_pixel);
+  }
+  target_samples_per_pixel_ = 1 << settings_.samples_per_pixel_log2;
+  // Buffers keep their capacity, so that going back to a size doesn't
+  // allocate again.
+  thread_scratch_.resize(omp_get_max_threads());
+  for (ThreadScratch& scratch : thread_scratch_) {
+    scratch.sampler.reset();
+  }
+
   const int data_size =
       settings_.image_width * settings_.image_height * num_color_components_;
-  pixel_data_ = std::vector<Float>(data_size, 0.0);
+  const int feature_data_size = settings_.enable_denoiser ? data_size : 0;
+  pixel_data_.resize(data_size);
+  compensation_data_.resize(kCompensatedAccumulation ? data_size : 0);
+  albedo_data_.resize(feature_data_size);
+  normal_data_.resize(feature_data_size);
+  denoised_data_.clear();
+
+  // Pages land on the NUMA node of the thread that first writes them, so rows
+  // are zeroed with the same static schedule as they are rendered.
+  const int row_size = settings_.image_width * num_color_components_;
+  // clang-format off
+  #pragma omp parallel
+  // clang-format on
+  {
+    PlaceOpenMpThread();
+    Scratch();
+
+    // clang-format off
+    #pragma omp for schedule(static)
+    // clang-format on
+    for (int j = 0; j < settings_.image_height; j++) {
+      if (keeps_samples) {
+        continue;
+      }
+      const int begin = j * row_size;
+      std::fill_n(&pixel_data_[begin], row_size, 0);
+      if (kCompensatedAccumulation) {
+        std::fill_n(&compensation_data_[begin], row_size, 0);
+      }
+      if (settings_.enable_denoiser) {
+        std::fill_n(&albedo_data_[begin], row_size, 0);
+        std::fill_n(&normal_data_[begin], row_size, 0);
+      }
+    }
+  }
+
   if (type == SettingsUpdateType::kUpdateTextureAndSettings) {
     const std::lock_guard<std::mutex> guard(image_data_mutex_);
-    image_data_ = std::vector<uint8_t>(data_size, 0);
+    image_data_.assign(settings_.image_width * settings_.image_height,
+                       0xff000000);
   }
 
   is_rendering_ = false;
   done_rendering_ = false;
 
-  current_phase_ = 0;
-  last_phase_ = settings_.samples_per_pixel_log2 + 1;
+  // Phases carry on doubling the samples of the region, as if it had been
+  // rendered alone.
+  accumulated_samples_per_pixel_ = std::max(region_samples_per_pixel, 0);
+  current_phase_ = std::bit_width(
+      static_cast<unsigned>(accumulated_samples_per_pixel_));
   current_phase_samples_per_pixel_ = 0;
-  accumulated_samples_per_pixel_ = 0;
-  pixel_samples_scale_ = 0;
+  if (accumulated_samples_per_pixel_ >= target_samples_per_pixel_) {
+    done_rendering_ = true;
+  }
+  // Previews would hide the samples kept in the region.
+  preview_stride_ = settings_.enable_preview &&
+                            accumulated_samples_per_pixel_ == 0 &&
+                            kept_samples_per_pixel_.empty()
+                        ? kFirstPreviewStride
+                        : 1;
+  if (preview_stride_ > 1) {
+    // For the finest preview, so that the coarser ones don't grow it.
+    preview_data_.reserve(
+        static_cast<size_t>((region.width + kLastPreviewStride - 1) /
+                            kLastPreviewStride) *
+        ((region.height + kLastPreviewStride - 1) / kLastPreviewStride) *
+        num_color_components_);
+  }
+  if (!warm_start_data_.empty()) {
+    preview_stride_ = 1;
+    const std::lock_guard<std::mutex> guard(image_data_mutex_);
+    TonemapWarmStart();
+  }
 
   global_render_time_ = 0.0;
   phase_render_time_ = 0.0;
   scanlines_rendered_ = 0;
 
+  InitializeViewport();
+
+  if (settings_.enable_path_guiding) {
+    if (path_guide_ == nullptr) {
+      path_guide_ = std::make_unique<PathGuide>();
+    }
+    // Cells span a few pixels.
+    path_guide_->Reset(center_, kGuideCellPixels * pixel_delta_u_.length() /
+                                    settings_.focus_distance);
+  } else {
+    path_guide_.reset();
+  }
+
+  // Primary rays all start from the center without defocus, so their hits
+  // only depend on the subpixel offset.
+  num_cached_primary_hits_ = 0;
+  if (settings_.enable_primary_hit_cache && settings_.defocus_angle <= 0) {
+    primary_hits_.resize(static_cast<size_t>(settings_.image_width) *
+                         settings_.image_height * kPrimaryHitPatterns);
+    // Those of the samples the region carries on from, cached with the same
+    // settings.
+    num_cached_primary_hits_ =
+        std::min(accumulated_samples_per_pixel_, kPrimaryHitPatterns);
+  } else {
+    primary_hits_ = {};
+  }
+}
+
+int Camera::KeepSamples() {
+  const int width = settings_.image_width;
+  const int height = settings_.image_height;
+  const Tile previous_region = RegionOf(initialized_settings_);
+  const Tile region = Region();
+  std::vector<int> samples(static_cast<size_t>(width) * height);
+  for (int j = 0; j < height; j++) {
+    for (int i = 0; i < width; i++) {
+      samples[j * width + i] = PixelSamples(previous_region, i, j);
+    }
+  }
+
+  int region_samples = samples[region.y * width + region.x];
+  for (int j = region.y; j < region.y + region.height; j++) {
+    for (int i = region.x; i < region.x + region.width; i++) {
+      region_samples = std::min(region_samples, samples[j * width + i]);
+    }
+  }
+  kept_samples_per_pixel_ = std::move(samples);
+  return region_samples;
+}
+
+int Camera::PixelSamples(const Tile& region, int i, int j) const {
+  const int row_samples = i >= region.x && i < region.x + region.width
+                              ? row_samples_per_pixel_[j]
+                              : 0;
+  if (kept_samples_per_pixel_.empty()) {
+    return row_samples;
+  }
+  // Kept samples are the first of their pixels, which rows only add to once
+  // they catch up.
+  return std::max(
+      kept_samples_per_pixel_[j * initialized_settings_.image_width + i],
+      row_samples);
+}
+
+void Camera::ResampleWarmStart() {
+  const int width = initialized_settings_.image_width;
+  const int height = initialized_settings_.image_height;
+  if (row_samples_per_pixel_.size() != static_cast<size_t>(height)) {
+    return;
+  }
+  const Tile region = RegionOf(initialized_settings_);
+  const bool has_warm_start = !warm_start_data_.empty();
+  // The average of a pixel of the previous image, and the samples it holds.
+  auto weight = [&](int pixel) {
+    return PixelSamples(region, pixel % width, pixel / width) +
+           (has_warm_start ? static_cast<int>(warm_start_weights_[pixel])
+                           : 0);
+  };
+  auto average = [&](int pixel, int k) -> Float {
+    const int index = pixel * num_color_components_ + k;
+    return (AccumulatedValue(index) +
+            (has_warm_start ? warm_start_data_[index] : 0)) /
+           weight(pixel);
+  };
+
+  const int new_width = settings_.image_width;
+  const int new_height = settings_.image_height;
+  std::vector<Float> data(static_cast<size_t>(new_width) * new_height *
+                          num_color_components_);
+  std::vector<Float> weights(static_cast<size_t>(new_width) * new_height);
+  // The vertical field of view is kept, so pixels map to the previous image
+  // by the ratio of the heights, about the center.
+  const Float scale = static_cast<Float>(height) / new_height;
+  const Float half = 0.5;
+  const Float offset_x = (width - new_width * scale) / 2 - half;
+  int max_weight = 0;
+  // clang-format off
+  #pragma omp parallel
+  // clang-format on
+  {
+    PlaceOpenMpThread();
+
+    // clang-format off
+    #pragma omp for schedule(static) reduction(max : max_weight)
+    // clang-format on
+    for (int j = 0; j < new_height; j++) {
+      const Float y =
+          std::clamp<Float>((j + half) * scale - half, 0, height - 1);
+      const int y0 = static_cast<int>(y);
+      const int y1 = std::min(y0 + 1, height - 1);
+      const Float wy = y - y0;
+      for (int i = 0; i < new_width; i++) {
+        const int new_pixel = j * new_width + i;
+        const Float x = (i + half) * scale + offset_x;
+        // Widened images have no samples on their sides.
+        if (x < -half || x > width - half) {
+          continue;
+        }
+        const Float clamped_x = std::clamp<Float>(x, 0, width - 1);
+        const int x0 = static_cast<int>(clamped_x);
+        const int x1 = std::min(x0 + 1, width - 1);
+        const Float wx = clamped_x - x0;
+        const int pixels[4] = {y0 * width + x0, y0 * width + x1,
+                               y1 * width + x0, y1 * width + x1};
+        // The interpolation is only worth as many samples as its poorest
+        // pixel.
+        int pixel_weight = std::numeric_limits<int>::max();
+        for (int pixel : pixels) {
+          pixel_weight = std::min(pixel_weight, weight(pixel));
+        }
+        if (pixel_weight <= 0) {
+          continue;
+        }
+        for (int k = 0; k < num_color_components_; k++) {
+          const Float value =
+              (1 - wy) * ((1 - wx) * average(pixels[0], k) +
+                          wx * average(pixels[1], k)) +
+              wy * ((1 - wx) * average(pixels[2], k) +
+                    wx * average(pixels[3], k));
+          data[new_pixel * num_color_components_ + k] = value * pixel_weight;
+        }
+        weights[new_pixel] = pixel_weight;
+        max_weight = std::max(max_weight, pixel_weight);
+      }
+    }
+  }
+
+  warm_start_data_ = max_weight > 0 ? std::move(data) : std::vector<Float>{};
+  warm_start_weights_ =
+      max_weight > 0 ? std::move(weights) : std::vector<Float>{};
+  warm_start_samples_per_pixel_ = max_weight;
+}
+
+void Camera::InitializeViewport() {
   center_ = settings_.look_from;
 
   const Float theta = DegreesToRadians(settings_.fov);
@@ -72,60 +377,160 @@ void Camera::Initialize(SettingsUpdateType type) {
 
 void Camera::InitializePhase() {
   is_rendering_ = true;
+  if (preview_stride_ > 1) {
+    scanlines_rendered_ = 0;
+    return;
+  }
 
   current_phase_++;
-  // Accumulated samples per pixel should double for each phase:
-  // 1 + 1 + 2 + 4...
-  current_phase_samples_per_pixel_ =
-      current_phase_ == 1 ? 1 : 1 << (current_phase_ - 2);
+  const int remaining_samples_per_pixel =
+      target_samples_per_pixel_ - accumulated_samples_per_pixel_;
+  if (remaining_samples_per_pixel == 0) {
+    // Only catches up with the rows an interrupted last phase skipped.
+    current_phase_samples_per_pixel_ = 0;
+  } else if (settings_.phase_scheduling == PhaseScheduling::kTimeBudget &&
+             current_phase_ > 1) {
+    const Tile region = Region();
+    const double num_pixels = static_cast<double>(region.width) * region.height;
+    const int budgeted_samples_per_pixel = static_cast<int>(
+        settings_.phase_time_budget_ms * samples_per_ms_ / num_pixels);
+    current_phase_samples_per_pixel_ = std::clamp(
+        budgeted_samples_per_pixel, 1, remaining_samples_per_pixel);
+  } else {
+    // Accumulated samples per pixel should double for each phase:
+    // 1 + 1 + 2 + 4...
+    current_phase_samples_per_pixel_ =
+        std::min(current_phase_ == 1 ? 1 : 1 << (current_phase_ - 2),
+                 remaining_samples_per_pixel);
+  }
   accumulated_samples_per_pixel_ += current_phase_samples_per_pixel_;
-  pixel_samples_scale_ = 1.0 / accumulated_samples_per_pixel_;
+  // The phase will hold as many samples as any pixel of the warm start.
+  if (accumulated_samples_per_pixel_ >= warm_start_samples_per_pixel_) {
+    warm_start_data_ = {};
+    warm_start_weights_ = {};
+    warm_start_samples_per_pixel_ = 0;
+  }
 
   scanlines_rendered_ = 0;
 }
 
 void Camera::Render(std::stop_token token, const Hittable& world) {
-  std::chrono::time_point phase_start_time = std::chrono::system_clock::now();
+  std::chrono::time_point phase_start_time = std::chrono::steady_clock::now();
+
+  // Previews are short enough not to be interrupted.
+  if (preview_stride_ > 1) {
+    RenderPreview(world);
+    preview_stride_ =
+        preview_stride_ > kLastPreviewStride ? preview_stride_ / 2 : 1;
+
+    phase_render_time_ = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() -
+                             phase_start_time)
+                             .count();
+    global_render_time_ += phase_render_time_;
+    is_rendering_ = false;
+    return;
+  }
+
+  const Tile region = Region();
 
   // clang-format off
-  #pragma omp parallel for
+  #pragma omp parallel
   // clang-format on
-  for (int j = 0; j < settings_.image_height; j++) {
-    // Prevent render invalidation during the first phase (1 sample per pixel).
-    // This increases the frequency of image updates when changing app settings.
-    if (token.stop_requested() && current_phase_ > 1) {
-      continue;
-    }
+  {
+    PlaceOpenMpThread();
+    Sampler* sampler = Scratch().sampler.get();
 
-    scanlines_rendered_++;
+    // clang-format off
+    #pragma omp for schedule(static)
+    // clang-format on
+    for (int j = region.y; j < region.y + region.height; j++) {
+      // Prevent render invalidation during the first phase (1 sample per
+      // pixel). This increases the frequency of image updates when changing
+      // app settings.
+      if (token.stop_requested() && current_phase_ > 1) {
+        continue;
+      }
+
+      for (int i = region.x; i < region.x + region.width; i++) {
+        AccumulationFloat pixel_color[3];
+        PixelFeatures features;
+        std::optional<HitRecord>* primary_hits =
+            primary_hits_.empty()
+                ? nullptr
+                : &primary_hits_[(static_cast<size_t>(j) *
+                                      settings_.image_width +
+                                  i) *
+                                 kPrimaryHitPatterns];
+        // Rows skipped by an interrupted phase catch up with the others, and
+        // pixels that kept more samples wait for them.
+        const int sample_begin = PixelSamples(region, i, j);
+        if (sample_begin >= accumulated_samples_per_pixel_) {
+          continue;
+        }
+        RenderPixel(i, j, sample_begin,
+                    accumulated_samples_per_pixel_ - sample_begin, world,
+                    sampler, path_guide_.get(), primary_hits, pixel_color,
+                    settings_.enable_denoiser ? &features : nullptr);
+
+        const int index =
+            (j * settings_.image_width + i) * num_color_components_;
+        for (int k = 0; k < num_color_components_; k++) {
+          Accumulate(index + k, pixel_color[k]);
+        }
 
-    for (int i = 0; i < settings_.image_width; i++) {
-      Color pixel_color{};
-      for (int sample = 0; sample < current_phase_samples_per_pixel_;
-           sample++) {
-        const Ray ray = GetRay(i, j);
-        pixel_color += RayColor(ray, settings_.max_depth, world);
+        if (settings_.enable_denoiser) {
+          albedo_data_[index] += features.albedo.x();
+          albedo_data_[index + 1] += features.albedo.y();
+          albedo_data_[index + 2] += features.albedo.z();
+          normal_data_[index] += features.normal.x();
+          normal_data_[index + 1] += features.normal.y();
+          normal_data_[index + 2] += features.normal.z();
+        }
       }
 
-      const int index = (j * settings_.image_width + i) * num_color_components_;
-      pixel_data_[index] += pixel_color.x();
-      pixel_data_[index + 1] += pixel_color.y();
-      pixel_data_[index + 2] += pixel_color.z();
+      // Rows are displayed as soon as they are done rather than at the end of
+      // the phase, so long phases still refresh the image at the UI frame
+      // rate. Denoised images can only be stored once the phase is done.
+      row_samples_per_pixel_[j] = accumulated_samples_per_pixel_;
+      if (!settings_.enable_denoiser) {
+        StoreRow(j);
+      }
+      scanlines_rendered_++;
     }
   }
 
+  std::chrono::time_point phase_end_time = std::chrono::steady_clock::now();
+  const double phase_render_time =
+      std::chrono::duration<double, std::milli>(phase_end_time -
+                                                phase_start_time)
+          .count();
+  phase_render_time_ = phase_render_time;
+  global_render_time_ += phase_render_time;
+
   bool is_render_invalidated = token.stop_requested() && current_phase_ > 1;
-  if (!is_render_invalidated) {
-    StoreImage();
+  if (settings_.enable_denoiser && !is_render_invalidated) {
+    StoreDenoisedImage();
+  }
+
+  if (!is_render_invalidated && phase_render_time > 0) {
+    samples_per_ms_ = current_phase_samples_per_pixel_ *
+                      static_cast<double>(region.width) * region.height /
+                      phase_render_time;
   }
 
-  std::chrono::time_point phase_end_time = std::chrono::system_clock::now();
-  phase_render_time_ = std::chrono::duration_cast<std::chrono::milliseconds>(
-                           phase_end_time - phase_start_time)
-                           .count();
-  global_render_time_ += phase_render_time_;
+  // The next phase samples from what this one learned.
+  if (path_guide_ != nullptr && !is_render_invalidated) {
+    path_guide_->Update();
+  }
+  if (!primary_hits_.empty() && !is_render_invalidated) {
+    num_cached_primary_hits_ =
+        std::min(accumulated_samples_per_pixel_, kPrimaryHitPatterns);
+  }
 
-  if (current_phase_ >= last_phase_) {
+  // Rows skipped by an interrupted phase still lack its samples.
+  if (accumulated_samples_per_pixel_ >= target_samples_per_pixel_ &&
+      !is_render_invalidated) {
     done_rendering_ = true;
   }
 
@@ -134,77 +539,607 @@ void Camera::Render(std::stop_token token, const Hittable& world) {
   is_rendering_ = false;
 }
 
+void Camera::RenderPreview(const Hittable& world) {
+  const int stride = preview_stride_;
+  const Tile region = Region();
+  const int width = region.width;
+  const int height = region.height;
+  const int preview_width = (width + stride - 1) / stride;
+  const int preview_height = (height + stride - 1) / stride;
+  preview_data_.resize(preview_width * preview_height * num_color_components_);
+
+  // clang-format off
+  #pragma omp parallel
+  // clang-format on
+  {
+    PlaceOpenMpThread();
+    ThreadScratch& scratch = Scratch();
+
+    // clang-format off
+    #pragma omp for schedule(static)
+    // clang-format on
+    for (int y = 0; y < preview_height; y++) {
+      const int j = region.y + std::min(y * stride + stride / 2, height - 1);
+      for (int x = 0; x < preview_width; x++) {
+        const int i = region.x + std::min(x * stride + stride / 2, width - 1);
+        AccumulationFloat color[3];
+        RenderPixel(i, j, /*sample_begin=*/0, /*sample_count=*/1, world,
+                    scratch.sampler.get(), /*path_guide=*/nullptr,
+                    /*primary_hits=*/nullptr, color, /*features=*/nullptr);
+        const int index = (y * preview_width + x) * num_color_components_;
+        for (int k = 0; k < num_color_components_; k++) {
+          preview_data_[index + k] = color[k];
+        }
+      }
+      scanlines_rendered_ += stride;
+    }
+
+    // Bilinear interpolation between the centers of the blocks.
+    std::vector<Float>& row = scratch.row;
+    // clang-format off
+    #pragma omp for schedule(static)
+    // clang-format on
+    for (int j = 0; j < height; j++) {
+      const Float preview_y = std::clamp<Float>(
+          (j + static_cast<Float>(0.5)) / stride - static_cast<Float>(0.5), 0,
+          preview_height - 1);
+      const int y0 = static_cast<int>(preview_y);
+      const int y1 = std::min(y0 + 1, preview_height - 1);
+      const Float wy = preview_y - y0;
+      for (int i = 0; i < width; i++) {
+        const Float preview_x = std::clamp<Float>(
+            (i + static_cast<Float>(0.5)) / stride - static_cast<Float>(0.5),
+            0, preview_width - 1);
+        const int x0 = static_cast<int>(preview_x);
+        const int x1 = std::min(x0 + 1, preview_width - 1);
+        const Float wx = preview_x - x0;
+        for (int k = 0; k < num_color_components_; k++) {
+          auto value = [&](int x, int y) {
+            return preview_data_[(y * preview_width + x) *
+                                     num_color_components_ +
+                                 k];
+          };
+          row[i * num_color_components_ + k] =
+              (1 - wy) * ((1 - wx) * value(x0, y0) + wx * value(x1, y0)) +
+              wy * ((1 - wx) * value(x0, y1) + wx * value(x1, y1));
+        }
+      }
+
+      const std::lock_guard<std::mutex> guard(image_data_mutex_);
+      tonemapper_.ToArgb(
+          row.data(), width, /*scale=*/1,
+          &image_data_[(region.y + j) * settings_.image_width + region.x]);
+    }
+  }
+}
+
 void Camera::StoreImage() {
   const std::lock_guard<std::mutex> guard(image_data_mutex_);
+  TonemapImage();
+}
 
-  for (int j = 0; j < settings_.image_height; j++) {
-    for (int i = 0; i < settings_.image_width; i++) {
+void Camera::StoreDenoisedImage() {
+  const Tile region = Region();
+  const size_t size = static_cast<size_t>(region.width) * region.height *
+                      num_color_components_;
+  std::vector<Float>& color = denoiser_color_;
+  std::vector<Float>& albedo = denoiser_albedo_;
+  std::vector<Float>& normal = denoiser_normal_;
+  color.resize(size);
+  albedo.resize(size);
+  normal.resize(size);
+  const int row_size = region.width * num_color_components_;
+  for (int y = 0; y < region.height; y++) {
+    const int begin =
+        ((region.y + y) * settings_.image_width + region.x) *
+        num_color_components_;
+    if (!warm_start_data_.empty()) {
+      BlendWarmStart(region.x, region.y + y, region.width,
+                     &color[y * row_size]);
+    }
+    for (int x = 0; x < region.width; x++) {
+      // Pixels hold different counts once the region kept samples.
+      const int samples = PixelSamples(region, region.x + x, region.y + y);
+      const AccumulationFloat scale = samples > 0 ? 1.0 / samples : 0;
+      for (int k = x * num_color_components_;
+           k < (x + 1) * num_color_components_; k++) {
+        const int index = y * row_size + k;
+        if (warm_start_data_.empty()) {
+          color[index] = AccumulatedValue(begin + k) * scale;
+        }
+        albedo[index] = albedo_data_[begin + k] * scale;
+        normal[index] = normal_data_[begin + k] * scale;
+      }
+    }
+  }
+
+  denoiser_.Denoise(region.width, region.height, color, albedo, normal,
+                    &denoised_data_);
+
+  const std::lock_guard<std::mutex> guard(image_data_mutex_);
+  TonemapDenoisedImage();
+}
+
+void Camera::TonemapDenoisedImage() {
+  const Tile region = Region();
+  for (int y = 0; y < region.height; y++) {
+    tonemapper_.ToArgb(
+        &denoised_data_[y * region.width * num_color_components_],
+        region.width, /*scale=*/1,
+        &image_data_[(region.y + y) * settings_.image_width + region.x]);
+  }
+}
+
+void Camera::StoreRow(int j) {
+  const std::lock_guard<std::mutex> guard(image_data_mutex_);
+  TonemapRow(j);
+}
+
+Camera::ThreadScratch& Camera::Scratch() {
+  ThreadScratch& scratch = thread_scratch_[omp_get_thread_num()];
+  if (scratch.sampler == nullptr) {
+    scratch.sampler =
+        MakeSampler(settings_.sampler_type, target_samples_per_pixel_);
+    scratch.row.resize(settings_.image_width * num_color_components_);
+  }
+  return scratch;
+}
+
+Tile Camera::Region() const { return RegionOf(settings_); }
+
+void Camera::TonemapRow(int j) {
+  const Tile region = Region();
+  const int pixel_index = j * settings_.image_width + region.x;
+  const int index = pixel_index * num_color_components_;
+  // Rows skipped by an interrupted phase hold fewer samples than the others.
+  const AccumulationFloat scale =
+      row_samples_per_pixel_[j] > 0 ? 1.0 / row_samples_per_pixel_[j] : 0;
+  std::vector<Float>& row = Scratch().row;
+  if (!warm_start_data_.empty()) {
+    BlendWarmStart(region.x, j, region.width, row.data());
+    tonemapper_.ToArgb(row.data(), region.width, /*scale=*/1,
+                       &image_data_[pixel_index]);
+  } else if (!kept_samples_per_pixel_.empty()) {
+    for (int x = 0; x < region.width; x++) {
+      const int samples = PixelSamples(region, region.x + x, j);
       for (int k = 0; k < num_color_components_; k++) {
-        const int index =
-            (j * settings_.image_width + i) * num_color_components_ + k;
-        image_data_[index] =
-            TransformColor(pixel_data_[index] * pixel_samples_scale_);
+        const int row_index = x * num_color_components_ + k;
+        row[row_index] =
+            samples > 0 ? AccumulatedValue(index + row_index) / samples : 0;
       }
     }
+    tonemapper_.ToArgb(row.data(), region.width, /*scale=*/1,
+                       &image_data_[pixel_index]);
+  } else if constexpr (kCompensatedAccumulation) {
+    for (int k = 0; k < region.width * num_color_components_; k++) {
+      row[k] = AccumulatedValue(index + k);
+    }
+    tonemapper_.ToArgb(row.data(), region.width, scale,
+                       &image_data_[pixel_index]);
+  } else {
+    tonemapper_.ToArgb(&pixel_data_[index], region.width, scale,
+                       &image_data_[pixel_index]);
+  }
+}
+
+void Camera::TonemapWarmStart() {
+  // clang-format off
+  #pragma omp parallel
+  // clang-format on
+  {
+    PlaceOpenMpThread();
+    std::vector<Float>& row = Scratch().row;
+
+    // clang-format off
+    #pragma omp for schedule(static)
+    // clang-format on
+    for (int j = 0; j < settings_.image_height; j++) {
+      const int pixel_index = j * settings_.image_width;
+      BlendWarmStart(0, j, settings_.image_width, row.data());
+      tonemapper_.ToArgb(row.data(), settings_.image_width, /*scale=*/1,
+                         &image_data_[pixel_index]);
+    }
+  }
+}
+
+void Camera::BlendWarmStart(int i, int j, int num_pixels,
+                            Float* colors) const {
+  const Tile region = Region();
+  for (int x = 0; x < num_pixels; x++) {
+    const int pixel = j * settings_.image_width + i + x;
+    const Float weight =
+        warm_start_weights_[pixel] + PixelSamples(region, i + x, j);
+    for (int k = 0; k < num_color_components_; k++) {
+      const int index = pixel * num_color_components_ + k;
+      colors[x * num_color_components_ + k] =
+          weight > 0 ? (AccumulatedValue(index) + warm_start_data_[index]) /
+                           weight
+                     : 0;
+    }
+  }
+}
+
+void Camera::TonemapImage() {
+  const Tile region = Region();
+  // clang-format off
+  #pragma omp parallel
+  // clang-format on
+  {
+    PlaceOpenMpThread();
+
+    // clang-format off
+    #pragma omp for schedule(static)
+    // clang-format on
+    for (int j = region.y; j < region.y + region.height; j++) {
+      TonemapRow(j);
+    }
+  }
+}
+
+void Camera::set_tonemap_settings(const TonemapSettings& settings) {
+  const std::lock_guard<std::mutex> guard(image_data_mutex_);
+  tonemapper_ = Tonemapper{settings};
+
+  // Rows being rendered are tonemapped again as they are stored, and
+  // previews are replaced by the first phase.
+  if (is_rendering_ || image_data_.empty()) {
+    return;
+  }
+
+  if (settings_.enable_denoiser && !denoised_data_.empty()) {
+    TonemapDenoisedImage();
+  } else if (!warm_start_data_.empty()) {
+    TonemapWarmStart();
+  } else if (accumulated_samples_per_pixel_ > 0 ||
+             !kept_samples_per_pixel_.empty()) {
+    TonemapImage();
+  }
+}
+
+void Camera::Accumulate(int index, AccumulationFloat value) {
+  if constexpr (kCompensatedAccumulation) {
+    CompensatedAdd(value, &pixel_data_[index], &compensation_data_[index]);
+  } else {
+    pixel_data_[index] += value;
+  }
+}
+
+AccumulationFloat Camera::AccumulatedValue(int index) const {
+  if constexpr (kCompensatedAccumulation) {
+    return pixel_data_[index] + compensation_data_[index];
+  } else {
+    return pixel_data_[index];
   }
 }
 
 Float Camera::Progress() const {
-  return scanlines_rendered_ / static_cast<Float>(settings_.image_height - 1);
+  return scanlines_rendered_ / static_cast<Float>(Region().height - 1);
 }
 
-void Camera::CopyTo(int* buffer) {
+void Camera::CopyTo(void* pixels, int pitch) {
   const std::lock_guard<std::mutex> guard(image_data_mutex_);
 
+  const size_t row_size = settings_.image_width * sizeof(uint32_t);
   for (int j = 0; j < settings_.image_height; j++) {
-    for (int i = 0; i < settings_.image_width; i++) {
-      int src_index = (j * settings_.image_width + i) * num_color_components_;
-      uint8_t r = image_data_[src_index];
-      uint8_t g = image_data_[src_index + 1];
-      uint8_t b = image_data_[src_index + 2];
+    std::memcpy(static_cast<char*>(pixels) + j * pitch,
+                &image_data_[j * settings_.image_width], row_size);
+  }
+}
+
+bool Camera::WriteImage(const std::string& path) {
+  std::ofstream file{path, std::ios::binary};
+  if (!file) {
+    std::cerr << "Error opening " << path << " for writing" << std::endl;
+    return false;
+  }
+
+  const std::lock_guard<std::mutex> guard(image_data_mutex_);
+
+  const Tile region = Region();
+  file << "P6\n" << region.width << ' ' << region.height << "\n255\n";
+  std::vector<uint8_t> row(region.width * num_color_components_);
+  for (int j = region.y; j < region.y + region.height; j++) {
+    for (int i = 0; i < region.width; i++) {
+      ArgbToRgb(image_data_[j * settings_.image_width + region.x + i],
+                &row[i * num_color_components_]);
+    }
+    file.write(reinterpret_cast<const char*>(row.data()), row.size());
+  }
+  if (!file) {
+    std::cerr << "Error writing " << path << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+void Camera::RenderTile(const Tile& tile, int sample_begin, int sample_count,
+                        const Hittable& world,
+                        std::vector<AccumulationFloat>* tile_data) const {
+  tile_data->assign(tile.width * tile.height * num_color_components_, 0.0);
+
+  // clang-format off
+  #pragma omp parallel
+  // clang-format on
+  {
+    PlaceOpenMpThread();
+    std::unique_ptr<Sampler> sampler = MakeSampler(
+        settings_.sampler_type, 1 << settings_.samples_per_pixel_log2);
+
+    // clang-format off
+    #pragma omp for
+    // clang-format on
+    for (int y = 0; y < tile.height; y++) {
+      for (int x = 0; x < tile.width; x++) {
+        const int index = (y * tile.width + x) * num_color_components_;
+        // The guide learns in whichever order the threads render, so tiles
+        // aren't guided, to render the same in every process.
+        RenderPixel(tile.x + x, tile.y + y, sample_begin, sample_count, world,
+                    sampler.get(), /*path_guide=*/nullptr,
+                    /*primary_hits=*/nullptr, &(*tile_data)[index],
+                    /*features=*/nullptr);
+      }
+    }
+  }
+}
 
-      int dest_index = j * settings_.image_width + i;
-      buffer[dest_index] = (r << 16) | (g << 8) | b;
+void Camera::AccumulateTile(
+    const Tile& tile, const std::vector<AccumulationFloat>& tile_data) {
+  for (int y = 0; y < tile.height; y++) {
+    for (int x = 0; x < tile.width; x++) {
+      const int src_index = (y * tile.width + x) * num_color_components_;
+      const int dest_index =
+          ((tile.y + y) * settings_.image_width + tile.x + x) *
+          num_color_components_;
+      for (int k = 0; k < num_color_components_; k++) {
+        Accumulate(dest_index + k, tile_data[src_index + k]);
+      }
     }
   }
 }
 
-Ray Camera::GetRay(int i, int j) const {
-  const Vec3 offset{static_cast<Float>(RandomFloat() - 0.5),
-                    static_cast<Float>(RandomFloat() - 0.5), 0};
+void Camera::FinishAccumulation(int samples_per_pixel) {
+  accumulated_samples_per_pixel_ = samples_per_pixel;
+  std::fill(row_samples_per_pixel_.begin(), row_samples_per_pixel_.end(),
+            accumulated_samples_per_pixel_);
+  StoreImage();
+  done_rendering_ = true;
+}
+
+Checkpoint Camera::MakeCheckpoint() const {
+  Checkpoint checkpoint{
+      .settings = settings_,
+      .current_phase = current_phase_,
+      .accumulated_samples_per_pixel = accumulated_samples_per_pixel_,
+      .pixel_data = std::vector<AccumulationFloat>(pixel_data_.begin(),
+                                                   pixel_data_.end()),
+  };
+  // Compensations are folded into the sums, so that checkpoints are the same
+  // whichever profile wrote them.
+  for (size_t index = 0; index < compensation_data_.size(); index++) {
+    checkpoint.pixel_data[index] += compensation_data_[index];
+  }
+  return checkpoint;
+}
+
+bool Camera::RestoreCheckpoint(const Checkpoint& checkpoint) {
+  if (checkpoint.settings != settings_ ||
+      checkpoint.pixel_data.size() != pixel_data_.size()) {
+    std::cerr << "Checkpoint doesn't match the camera settings" << std::endl;
+    return false;
+  }
+
+  pixel_data_.assign(checkpoint.pixel_data.begin(),
+                     checkpoint.pixel_data.end());
+  std::fill(compensation_data_.begin(), compensation_data_.end(), 0);
+  current_phase_ = checkpoint.current_phase;
+  accumulated_samples_per_pixel_ = checkpoint.accumulated_samples_per_pixel;
+  std::fill(row_samples_per_pixel_.begin(), row_samples_per_pixel_.end(),
+            accumulated_samples_per_pixel_);
+  num_cached_primary_hits_ = 0;
+  preview_stride_ = 1;
+  StoreImage();
+
+  if (accumulated_samples_per_pixel_ >= target_samples_per_pixel_) {
+    done_rendering_ = true;
+  }
+
+  return true;
+}
+
+void Camera::RenderPixel(int i, int j, int sample_begin, int sample_count,
+                         const Hittable& world, Sampler* sampler,
+                         PathGuide* path_guide,
+                         std::optional<HitRecord>* primary_hits,
+                         AccumulationFloat* color,
+                         PixelFeatures* features) const {
+  // Phases can be thousands of samples long, so their sums need the same
+  // precision as the accumulation buffer.
+  Accumulator pixel_color[3];
+  PixelFeatures sample_features;
+  if (features != nullptr) {
+    *features = PixelFeatures{};
+  }
+
+  for (int sample = sample_begin; sample < sample_begin + sample_count;
+       sample++) {
+    PixelFeatures* sample_features_pointer =
+        features != nullptr ? &sample_features : nullptr;
+    Color sample_color;
+    const int pattern = sample % kPrimaryHitPatterns;
+    if (primary_hits != nullptr && pattern < num_cached_primary_hits_) {
+      // The ray of the sample that cached the hit, after which the sampler
+      // carries on from the dimensions of this sample.
+      sampler->StartPixelSample(i, j, pattern);
+      const Ray ray = GetRay(i, j, sampler);
+      sampler->StartPixelSample(i, j, sample);
+      sampler->Get2D();
+      sampler->Get2D();
+      sample_color =
+          HitColor(ray, primary_hits[pattern], settings_.max_depth, world,
+                   sampler, path_guide, sample_features_pointer,
+                   /*count_emitted=*/true);
+    } else if (primary_hits != nullptr && sample == pattern &&
+               settings_.max_depth > 0) {
+      sampler->StartPixelSample(i, j, sample);
+      const Ray ray = GetRay(i, j, sampler);
+      primary_hits[pattern] = world.Hit(ray, kMinHitDistance,
+                                        std::numeric_limits<Float>::infinity());
+      sample_color =
+          HitColor(ray, primary_hits[pattern], settings_.max_depth, world,
+                   sampler, path_guide, sample_features_pointer,
+                   /*count_emitted=*/true);
+    } else {
+      sampler->StartPixelSample(i, j, sample);
+      const Ray ray = GetRay(i, j, sampler);
+      sample_color = RayColor(ray, settings_.max_depth, world, sampler,
+                              path_guide, sample_features_pointer);
+    }
+    pixel_color[0].Add(sample_color.x());
+    pixel_color[1].Add(sample_color.y());
+    pixel_color[2].Add(sample_color.z());
+    if (features != nullptr) {
+      features->albedo += sample_features.albedo;
+      features->normal += sample_features.normal;
+    }
+  }
+
+  for (int k = 0; k < num_color_components_; k++) {
+    color[k] = pixel_color[k].sum();
+  }
+}
+
+Ray Camera::GetRay(int i, int j, Sampler* sampler) const {
+  const Sample2D pixel_sample_offset = sampler->Get2D();
+  const Sample2D lens_sample = sampler->Get2D();
+  const Vec3 offset{pixel_sample_offset.u - static_cast<Float>(0.5),
+                    pixel_sample_offset.v - static_cast<Float>(0.5), 0};
   const Vec3 pixel_sample = upper_left_pixel_location_ +
                             ((i + offset.x()) * pixel_delta_u_) +
                             ((j + offset.y()) * pixel_delta_v_);
 
   const Point3 ray_origin =
-      (settings_.defocus_angle <= 0) ? center_ : SampleDefocusDisk();
+      (settings_.defocus_angle <= 0) ? center_ : SampleDefocusDisk(lens_sample);
   const Vec3 ray_direction = pixel_sample - ray_origin;
-  return Ray{ray_origin, ray_direction};
+  // The cone spans a pixel at the focus distance.
+  const Float cone_angle =
+      pixel_delta_u_.length() / settings_.focus_distance;
+  return Ray{ray_origin, ray_direction, /*cone_width=*/0, cone_angle};
+}
+
+Color Camera::RayColor(const Ray& ray, int depth, const Hittable& world,
+                       Sampler* sampler, PathGuide* path_guide,
+                       PixelFeatures* features, bool count_emitted) const {
+  return HitColor(ray,
+                  depth > 0 ? world.Hit(ray, kMinHitDistance,
+                                        std::numeric_limits<Float>::infinity())
+                            : std::nullopt,
+                  depth, world, sampler, path_guide, features, count_emitted);
 }
 
-Color Camera::RayColor(const Ray& ray, int depth, const Hittable& world) const {
+Color Camera::HitColor(const Ray& ray,
+                       const std::optional<HitRecord>& hit_record, int depth,
+                       const Hittable& world, Sampler* sampler,
+                       PathGuide* path_guide, PixelFeatures* features,
+                       bool count_emitted) const {
   const Color black{0.0, 0.0, 0.0};
+  if (features != nullptr) {
+    *features = PixelFeatures{black, Vec3{}};
+  }
+
   if (depth <= 0) {
     return black;
   }
 
-  const Float min = 0.001;
-  const Float max = std::numeric_limits<Float>::infinity();
-  std::optional<HitRecord> hit_record = world.Hit(ray, min, max);
   if (hit_record.has_value()) {
     if (hit_record->material() == nullptr) {
       return black;
     }
 
     Material* material = hit_record->material();
+    Color color = count_emitted
+                      ? material->Emitted(ray, hit_record.value())
+                      : black;
+    const bool samples_lights =
+        lights_ != nullptr &&
+        (!lights_->empty() || Environment() != nullptr) &&
+        material->IsDiffuse();
+    if (samples_lights) {
+      color += SampleLights(ray, hit_record.value(), world, sampler);
+    }
+
     std::optional<ScatterRecord> scatter_record =
-        material->Scatter(ray, hit_record.value());
+        material->Scatter(ray, hit_record.value(), sampler);
+    if (features != nullptr) {
+      features->normal = hit_record->normal();
+    }
     if (!scatter_record.has_value()) {
-      return black;
+      if (features != nullptr) {
+        features->albedo = color;
+      }
+      return color;
+    }
+
+    if (features != nullptr) {
+      features->albedo = scatter_record->attenuation();
     }
+    const Ray& scattered = scatter_record->scattered();
+    Vec3 direction = scattered.direction();
+    Color attenuation = scatter_record->attenuation();
 
-    return scatter_record->attenuation() *
-           RayColor(scatter_record->scattered(), depth - 1, world);
+    // Guided bounces pick the direction of the guide or that of the
+    // material, and weigh it by the density of doing either.
+    int guide_cell = -1;
+    Float direction_pdf = 0;
+    if (path_guide != nullptr && material->IsDiffuse()) {
+      const Float guide_choice = sampler->Get1D();
+      const Sample2D guide_sample = sampler->Get2D();
+      guide_cell =
+          path_guide->FindCell(hit_record->p(), hit_record->normal());
+      const bool is_guided =
+          guide_cell >= 0 && path_guide->CanSample(guide_cell);
+      if (is_guided && guide_choice < kGuideProbability) {
+        direction = path_guide->Sample(guide_cell, guide_sample);
+      }
+      direction_pdf =
+          material->ScatterPdf(ray, hit_record.value(), direction);
+      if (is_guided) {
+        direction_pdf =
+            kGuideProbability * path_guide->Pdf(guide_cell, direction) +
+            (1 - kGuideProbability) * direction_pdf;
+        attenuation =
+            direction_pdf > 0
+                ? material->Evaluate(ray, hit_record.value(), direction) /
+                      direction_pdf
+                : black;
+      }
+      if (attenuation.near_zero()) {
+        return color;
+      }
+    }
+
+    // Scattered rays carry on the cone from the footprint at the hit.
+    const Ray next_ray{scattered.origin(), direction,
+                       ray.ConeWidth(hit_record->t()), ray.cone_angle()};
+    const Color incoming =
+        RayColor(next_ray, depth - 1, world, sampler, path_guide,
+                 /*features=*/nullptr, !samples_lights);
+    // What the lights were sampled for isn't recorded, so that the guide
+    // learns where the rest of the light comes from.
+    if (guide_cell >= 0 && direction_pdf > 0) {
+      path_guide->Record(guide_cell, direction,
+                         Luminance(incoming) / direction_pdf);
+    }
+    return color + attenuation * incoming;
+  }
+
+  if (!settings_.enable_sky) {
+    return black;
+  }
+  const EnvironmentMap* environment = Environment();
+  if (environment != nullptr) {
+    // Already sampled by the last bounce, unless it didn't sample lights.
+    return count_emitted ? environment->Radiance(ray.direction()) : black;
   }
 
   const Color white{1.0, 1.0, 1.0};
@@ -212,26 +1147,92 @@ Color Camera::RayColor(const Ray& ray, int depth, const Hittable& world) const {
 
   const Vec3 unit_direction = UnitVector(ray.direction());
   const Float a = 0.5 * (unit_direction.y() + 1.0);
-  return (1.0 - a) * white + a * blue;
+  const Color background = (1.0 - a) * white + a * blue;
+  if (features != nullptr) {
+    features->albedo = background;
+  }
+  return background;
 }
 
-void Camera::WriteImage() {
-  const std::lock_guard<std::mutex> guard(image_data_mutex_);
+Color Camera::SampleLights(const Ray& ray, const HitRecord& record,
+                           const Hittable& world, Sampler* sampler) const {
+  Color color{0.0, 0.0, 0.0};
+  if (!lights_->empty()) {
+    color += SampleEmitter(ray, record, world, sampler);
+  }
+  if (Environment() != nullptr) {
+    color += SampleEnvironment(ray, record, world, sampler);
+  }
+  return color;
+}
 
-  std::cout << "P3\n"
-            << settings_.image_width << ' ' << settings_.image_height
-            << "\n255\n";
+Color Camera::SampleEmitter(const Ray& ray, const HitRecord& record,
+                            const Hittable& world, Sampler* sampler) const {
+  const Color black{0.0, 0.0, 0.0};
+  const Float light_sample = sampler->Get1D();
+  const Sample2D direction_sample = sampler->Get2D();
 
-  for (int j = 0; j < settings_.image_height; j++) {
-    for (int i = 0; i < settings_.image_width; i++) {
-      const int index = (j * settings_.image_width + i) * num_color_components_;
-      std::cout << image_data_[index] << ' ' << image_data_[index + 1] << ' '
-                << image_data_[index + 2] << '\n';
-    }
+  Float selection_probability;
+  const Hittable& light = lights_->Sample(light_sample, &selection_probability);
+  const Vec3 direction = light.SampleDirection(record.p(), direction_sample);
+  const Color scattering =
+      record.material()->Evaluate(ray, record, direction);
+  if (scattering.near_zero()) {
+    return black;
+  }
+
+  const Float min = 0.001;
+  const Ray shadow_ray{record.p(), direction};
+  const std::optional<HitRecord> light_hit =
+      light.Hit(shadow_ray, min, std::numeric_limits<Float>::infinity());
+  const Float pdf =
+      selection_probability * light.PdfValue(record.p(), direction);
+  if (!light_hit.has_value() || light_hit->material() == nullptr || pdf <= 0) {
+    return black;
   }
+
+  // Stops short of the light, which would otherwise shadow itself.
+  const Float transmittance = world.Transmittance(
+      shadow_ray, min, light_hit->t() * static_cast<Float>(0.999));
+  if (transmittance <= 0) {
+    return black;
+  }
+  return scattering * light_hit->material()->Emitted(shadow_ray, *light_hit) *
+         (transmittance / pdf);
+}
+
+Color Camera::SampleEnvironment(const Ray& ray, const HitRecord& record,
+                                const Hittable& world,
+                                Sampler* sampler) const {
+  const Color black{0.0, 0.0, 0.0};
+  const Sample2D texel_sample = sampler->Get2D();
+  const Sample2D offset_sample = sampler->Get2D();
+
+  const EnvironmentMap& environment = *Environment();
+  Float pdf;
+  const Vec3 direction =
+      environment.Sample(texel_sample, offset_sample, &pdf);
+  const Color scattering =
+      record.material()->Evaluate(ray, record, direction);
+  if (pdf <= 0 || scattering.near_zero()) {
+    return black;
+  }
+
+  const Float transmittance =
+      world.Transmittance(Ray{record.p(), direction}, 0.001,
+                          std::numeric_limits<Float>::infinity());
+  if (transmittance <= 0) {
+    return black;
+  }
+  return scattering * environment.Radiance(direction) * (transmittance / pdf);
+}
+
+const EnvironmentMap* Camera::Environment() const {
+  return lights_ != nullptr && settings_.enable_sky ? lights_->environment()
+                                                    : nullptr;
 }
 
-Point3 Camera::SampleDefocusDisk() const {
-  Point3 p = RandomInUnitDisk();
+Point3 Camera::SampleDefocusDisk(const Sample2D& sample) const {
+  Point3 p = SampleUnitDisk(sample.u, sample.v);
   return center_ + (p.x() * defocus_disk_u_) + (p.y() * defocus_disk_v_);
 }
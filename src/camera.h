@@ -3,18 +3,47 @@
 
 #include <atomic>
 #include <chrono>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <stop_token>
+#include <string>
 #include <vector>
 
 #include "app_settings.h"
 #include "color.h"
+#include "denoiser.h"
+#include "environment_map.h"
 #include "float.h"
 #include "hittable.h"
+#include "light_list.h"
+#include "numa.h"
+#include "path_guide.h"
 #include "ray.h"
+#include "sampler.h"
+#include "tonemap.h"
 #include "vec3.h"
 
 enum class SettingsUpdateType;
+struct Checkpoint;
+
+enum class PhaseScheduling {
+  // Phases double the accumulated samples per pixel: 1, 1, 2, 4...
+  kDoubling,
+  // Phases are sized from the measured throughput to take about
+  // `phase_time_budget_ms` each.
+  kTimeBudget,
+};
+
+// A rectangular region of the image, in pixels.
+struct Tile {
+  int x;
+  int y;
+  int width;
+  int height;
+
+  bool operator==(const Tile& other) const = default;
+};
 
 struct CameraSettings {
   int image_width;
@@ -27,19 +56,83 @@ struct CameraSettings {
   Vec3 view_up;
   Float defocus_angle;
   Float focus_distance;
+  PhaseScheduling phase_scheduling;
+  Float phase_time_budget_ms;
+  SamplerType sampler_type;
+  bool enable_denoiser;
+  // Rays that escape the scene see the environment map of the lights, or a
+  // sky gradient without one, rather than black.
+  bool enable_sky;
+  // Learns where light comes from over the phases, to sample diffuse bounces
+  // towards it. Progressive renders only: tiles aren't guided.
+  bool enable_path_guiding;
+  // Without defocus, caches the first hit of the primary rays of the first
+  // `kPrimaryHitPatterns` samples of each pixel, and starts the paths of the
+  // later samples from them, cycling through their subpixel offsets.
+  // Progressive renders only.
+  bool enable_primary_hit_cache;
+  // Starts with phases that render 1 pixel per block of 8x8, then 4x4, and
+  // interpolate the others, so that an image shows right after a change.
+  // Their samples are only displayed, not accumulated.
+  bool enable_preview;
+  // Phases only render this region, unless it is empty, and leave the rest of
+  // the image as it was last displayed. Written images are cropped to it.
+  // Progressive renders only.
+  Tile region;
+
+  bool operator==(const CameraSettings& other) const = default;
+};
+
+// Auxiliary outputs of the first hit, used to guide the denoiser.
+struct PixelFeatures {
+  Color albedo;
+  Vec3 normal;
 };
 
 class Camera {
  public:
+  // Antialiasing converges to that of this many samples per pixel when
+  // primary hits are cached.
+  static constexpr int kPrimaryHitPatterns = 4;
+
   Camera(CameraSettings settings)
       : settings_{settings}, num_color_components_{3} {}
 
+  // Resizes keep the accumulation, resampled to the new size, as a warm start
+  // that the displayed image blends in until phases catch up with it.
   void Initialize(SettingsUpdateType type);
+  void InitializeViewport();
   void InitializePhase();
   void Render(std::stop_token token, const Hittable& world);
   void StoreImage();
   Float Progress() const;
-  void CopyTo(int* buffer);
+  // Copies the ARGB8888 image to `pixels`, whose rows are `pitch` bytes apart.
+  void CopyTo(void* pixels, int pitch);
+  bool WriteImage(const std::string& path);
+
+  const TonemapSettings& tonemap_settings() const {
+    return tonemapper_.settings();
+  }
+  // Takes effect without restarting the render.
+  void set_tonemap_settings(const TonemapSettings& settings);
+
+  // The lights sampled at each diffuse bounce, owned by the scene. Without
+  // lights, emission is only found by scattering into it.
+  void set_lights(const LightList* lights) { lights_ = lights; }
+
+  // Tile rendering, used by distributed renders. Samples are seeded from
+  // their pixel and sample index, so a tile renders to the same values
+  // whichever process renders it. Only the viewport needs to be initialized.
+  void RenderTile(const Tile& tile, int sample_begin, int sample_count,
+                  const Hittable& world,
+                  std::vector<AccumulationFloat>* tile_data) const;
+  void AccumulateTile(const Tile& tile,
+                      const std::vector<AccumulationFloat>& tile_data);
+  void FinishAccumulation(int samples_per_pixel);
+
+  // Checkpoints are only consistent between phases.
+  Checkpoint MakeCheckpoint() const;
+  bool RestoreCheckpoint(const Checkpoint& checkpoint);
 
   const CameraSettings& settings() const { return settings_; }
   void set_settings(const CameraSettings& settings) { settings_ = settings; }
@@ -48,35 +141,147 @@ class Camera {
   bool done_rendering() const { return done_rendering_; }
 
   int current_phase() const { return current_phase_; }
-  int last_phase() const { return last_phase_; }
   int current_phase_samples_per_pixel() const {
     return current_phase_samples_per_pixel_;
   }
+  int accumulated_samples_per_pixel() const {
+    return accumulated_samples_per_pixel_;
+  }
+  int target_samples_per_pixel() const { return target_samples_per_pixel_; }
+  // The size of the blocks of the next preview phase, 1 once they are done.
+  int preview_stride() const { return preview_stride_; }
 
   double global_render_time() const { return global_render_time_; }
   double phase_render_time() const { return phase_render_time_; }
 
  private:
-  Ray GetRay(int i, int j) const;
-  Color RayColor(const Ray& ray, int depth, const Hittable& world) const;
-  void WriteImage();
-  Point3 SampleDefocusDisk() const;
+  // What each rendering thread keeps across phases, so that they don't
+  // allocate.
+  struct ThreadScratch {
+    std::unique_ptr<Sampler> sampler;
+    // A row of the image, to tonemap.
+    std::vector<Float> row;
+  };
+
+  // That of the calling OpenMP thread, made after each `Initialize`.
+  ThreadScratch& Scratch();
+  // Renders the pixel at the center of each block of `preview_stride_`
+  // pixels, and stores the image interpolated between them.
+  void RenderPreview(const Hittable& world);
+  // `settings_.region`, or the whole image if it is empty.
+  Tile Region() const;
+  // Adds the samples of the previous region to those kept per pixel, and
+  // returns the fewest any pixel of the region holds.
+  int KeepSamples();
+  // The samples accumulated by the pixel (i, j) of the image last
+  // initialized, given the region it was rendered in.
+  int PixelSamples(const Tile& region, int i, int j) const;
+  // Replaces the warm start with the accumulation of the previous size,
+  // blended with its own warm start, if any.
+  void ResampleWarmStart();
+  // Writes the averages of `num_pixels` pixels from (i, j), blending the
+  // accumulation with the warm start, to `colors`.
+  void BlendWarmStart(int i, int j, int num_pixels, Float* colors) const;
+  void StoreRow(int j);
+  // These need `image_data_mutex_` to be locked.
+  void TonemapRow(int j);
+  void TonemapImage();
+  // The whole image, not only the region.
+  void TonemapWarmStart();
+  void TonemapDenoisedImage();
+  void StoreDenoisedImage();
+  void Accumulate(int index, AccumulationFloat value);
+  AccumulationFloat AccumulatedValue(int index) const;
+  // Writes the sum of the pixel's samples to `color[0..2]`. `path_guide` and
+  // `primary_hits`, the `kPrimaryHitPatterns` cached hits of the pixel, are
+  // optional.
+  void RenderPixel(int i, int j, int sample_begin, int sample_count,
+                   const Hittable& world, Sampler* sampler,
+                   PathGuide* path_guide,
+                   std::optional<HitRecord>* primary_hits,
+                   AccumulationFloat* color, PixelFeatures* features) const;
+  Ray GetRay(int i, int j, Sampler* sampler) const;
+  // `count_emitted` is false after diffuse bounces that sampled the lights,
+  // which already account for the emission the ray may hit.
+  Color RayColor(const Ray& ray, int depth, const Hittable& world,
+                 Sampler* sampler, PathGuide* path_guide,
+                 PixelFeatures* features, bool count_emitted = true) const;
+  // The rest of `RayColor`, once `ray` is known to hit `hit_record`, if any.
+  Color HitColor(const Ray& ray, const std::optional<HitRecord>& hit_record,
+                 int depth, const Hittable& world, Sampler* sampler,
+                 PathGuide* path_guide, PixelFeatures* features,
+                 bool count_emitted) const;
+  // Next-event estimation: the light reaching `record` from one of the
+  // lights, plus that from the environment.
+  Color SampleLights(const Ray& ray, const HitRecord& record,
+                     const Hittable& world, Sampler* sampler) const;
+  Color SampleEmitter(const Ray& ray, const HitRecord& record,
+                      const Hittable& world, Sampler* sampler) const;
+  Color SampleEnvironment(const Ray& ray, const HitRecord& record,
+                          const Hittable& world, Sampler* sampler) const;
+  // The environment map, if any, and if the sky is enabled.
+  const EnvironmentMap* Environment() const;
+  Point3 SampleDefocusDisk(const Sample2D& sample) const;
 
   CameraSettings settings_;
   const int num_color_components_;
+  const LightList* lights_ = nullptr;
+  // Only allocated when path guiding is enabled, and learned over the phases
+  // of `Render`.
+  std::unique_ptr<PathGuide> path_guide_;
+  // `kPrimaryHitPatterns` per pixel, only allocated when primary hits are
+  // cached. The first `num_cached_primary_hits_` of each pixel are filled.
+  std::vector<std::optional<HitRecord>> primary_hits_;
+  int num_cached_primary_hits_ = 0;
 
-  std::vector<Float> pixel_data_;
-  std::vector<uint8_t> image_data_;
+  // Zeroed by the threads that render each row, see `Initialize`.
+  UninitializedVector<AccumulationFloat> pixel_data_;
+  // Only filled in the compensated precision profile.
+  UninitializedVector<AccumulationFloat> compensation_data_;
+  // Only filled when the denoiser is enabled.
+  UninitializedVector<Float> albedo_data_;
+  UninitializedVector<Float> normal_data_;
+  // Of the region.
+  std::vector<Float> denoised_data_;
+  // The averages handed to the denoiser, of the region.
+  std::vector<Float> denoiser_color_;
+  std::vector<Float> denoiser_albedo_;
+  std::vector<Float> denoiser_normal_;
+  Denoiser denoiser_;
+  // The samples per pixel accumulated in the region by each row, which lag
+  // behind in the rows interrupted phases skip until the next phase.
+  std::vector<int> row_samples_per_pixel_;
+  // The first samples of each pixel, kept by region-only changes. Pixels of
+  // the region hold more once the rows above catch up. Empty if there are
+  // none.
+  std::vector<int> kept_samples_per_pixel_;
+  // Sums and sample counts per pixel, empty without a warm start. Dropped
+  // once phases accumulate as many samples as its best pixels.
+  std::vector<Float> warm_start_data_;
+  std::vector<Float> warm_start_weights_;
+  int warm_start_samples_per_pixel_ = 0;
+  // Those of the last `Initialize`, to tell resizes from other changes.
+  CameraSettings initialized_settings_ = {};
+  // ARGB8888, as expected by the SDL texture.
+  std::vector<uint32_t> image_data_;
   std::mutex image_data_mutex_;
+  Tonemapper tonemapper_;
+  // Indexed by OpenMP thread.
+  std::vector<ThreadScratch> thread_scratch_;
 
   std::atomic<bool> is_rendering_;
   std::atomic<bool> done_rendering_;
 
   int current_phase_;
-  int last_phase_;
   int current_phase_samples_per_pixel_;
   int accumulated_samples_per_pixel_;
-  Float pixel_samples_scale_;
+  int target_samples_per_pixel_;
+  // Halved by the render thread after each preview, while the app reads it.
+  std::atomic<int> preview_stride_ = 1;
+  // One color per block of the last preview phase.
+  std::vector<Float> preview_data_;
+  // Measured over the last complete phase, and kept across settings changes.
+  double samples_per_ms_ = 0.0;
 
   std::atomic<double> global_render_time_;
   std::atomic<double> phase_render_time_;
@@ -0,0 +1,290 @@
+#include "checkpoint.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef PEWPEW_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#include "camera.h"
+#include "float.h"
+#include "vec3.h"
+
+namespace {
+
+const char kMagic[8] = {'P', 'E', 'W', 'C', 'K', 'P', 'T', '3'};
+const size_t kValueSize = sizeof(AccumulationFloat);
+
+// Written field by field, in this order, so that files hold no padding.
+struct CheckpointHeader {
+  char magic[8];
+  // Both depend on the precision profile of the binary that wrote the file.
+  uint32_t float_size;
+  uint32_t value_size;
+  uint32_t is_compressed;
+  CameraSettings settings;
+  int32_t current_phase;
+  int32_t accumulated_samples_per_pixel;
+  uint64_t num_values;
+  uint64_t payload_size;
+};
+
+// Reads or writes each field with `transfer`, which takes a pointer to it.
+template <typename Transfer>
+void TransferSettings(Transfer transfer, CameraSettings* settings) {
+  auto transfer_vector = [&transfer](Vec3* vector) {
+    Float e[3] = {vector->x(), vector->y(), vector->z()};
+    for (Float& value : e) {
+      transfer(&value);
+    }
+    *vector = Vec3{e[0], e[1], e[2]};
+  };
+  auto transfer_enum = [&transfer](auto* value) {
+    int32_t integer = static_cast<int32_t>(*value);
+    transfer(&integer);
+    *value = static_cast<std::remove_pointer_t<decltype(value)>>(integer);
+  };
+  auto transfer_bool = [&transfer](bool* value) {
+    uint8_t byte = *value;
+    transfer(&byte);
+    *value = byte != 0;
+  };
+
+  transfer(&settings->image_width);
+  transfer(&settings->image_height);
+  transfer(&settings->samples_per_pixel_log2);
+  transfer(&settings->max_depth);
+  transfer(&settings->fov);
+  transfer_vector(&settings->look_from);
+  transfer_vector(&settings->look_at);
+  transfer_vector(&settings->view_up);
+  transfer(&settings->defocus_angle);
+  transfer(&settings->focus_distance);
+  transfer_enum(&settings->phase_scheduling);
+  transfer(&settings->phase_time_budget_ms);
+  transfer_enum(&settings->sampler_type);
+  transfer_bool(&settings->enable_denoiser);
+  transfer_bool(&settings->enable_sky);
+  transfer_bool(&settings->enable_path_guiding);
+  transfer_bool(&settings->enable_primary_hit_cache);
+  transfer_bool(&settings->enable_preview);
+  transfer(&settings->region.x);
+  transfer(&settings->region.y);
+  transfer(&settings->region.width);
+  transfer(&settings->region.height);
+}
+
+template <typename Transfer>
+void TransferHeader(Transfer transfer, CheckpointHeader* header) {
+  for (char& c : header->magic) {
+    transfer(&c);
+  }
+  transfer(&header->float_size);
+  transfer(&header->value_size);
+  transfer(&header->is_compressed);
+  TransferSettings(transfer, &header->settings);
+  transfer(&header->current_phase);
+  transfer(&header->accumulated_samples_per_pixel);
+  transfer(&header->num_values);
+  transfer(&header->payload_size);
+}
+
+#ifdef PEWPEW_HAS_ZLIB
+// Groups the n-th bytes of all values together. Neighboring pixels have close
+// exponents, so this makes the accumulation buffer much more compressible.
+std::vector<uint8_t> ShuffleBytes(
+    const std::vector<AccumulationFloat>& values) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(values.data());
+  std::vector<uint8_t> shuffled(values.size() * kValueSize);
+  for (size_t i = 0; i < values.size(); i++) {
+    for (size_t k = 0; k < kValueSize; k++) {
+      shuffled[k * values.size() + i] = bytes[i * kValueSize + k];
+    }
+  }
+  return shuffled;
+}
+
+void UnshuffleBytes(const std::vector<uint8_t>& shuffled,
+                    std::vector<AccumulationFloat>* values) {
+  uint8_t* bytes = reinterpret_cast<uint8_t*>(values->data());
+  for (size_t i = 0; i < values->size(); i++) {
+    for (size_t k = 0; k < kValueSize; k++) {
+      bytes[i * kValueSize + k] = shuffled[k * values->size() + i];
+    }
+  }
+}
+#endif
+
+}  // namespace
+
+bool WriteCheckpoint(const std::string& path, const Checkpoint& checkpoint,
+                     bool compress) {
+  CheckpointHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.float_size = sizeof(Float);
+  header.value_size = kValueSize;
+  header.settings = checkpoint.settings;
+  header.current_phase = checkpoint.current_phase;
+  header.accumulated_samples_per_pixel =
+      checkpoint.accumulated_samples_per_pixel;
+  header.num_values = checkpoint.pixel_data.size();
+
+  const char* payload =
+      reinterpret_cast<const char*>(checkpoint.pixel_data.data());
+  header.payload_size = checkpoint.pixel_data.size() * kValueSize;
+
+#ifdef PEWPEW_HAS_ZLIB
+  std::vector<uint8_t> compressed;
+  if (compress) {
+    const std::vector<uint8_t> shuffled = ShuffleBytes(checkpoint.pixel_data);
+    uLongf compressed_size = compressBound(shuffled.size());
+    compressed.resize(compressed_size);
+    if (compress2(compressed.data(), &compressed_size, shuffled.data(),
+                  shuffled.size(), Z_BEST_SPEED) != Z_OK) {
+      std::cerr << "Error compressing checkpoint" << std::endl;
+      return false;
+    }
+
+    header.is_compressed = 1;
+    header.payload_size = compressed_size;
+    payload = reinterpret_cast<const char*>(compressed.data());
+  }
+#else
+  if (compress) {
+    std::cerr << "Checkpoint compression needs zlib, writing uncompressed"
+              << std::endl;
+  }
+#endif
+
+  // Write to a temporary file first, so that a crash while writing leaves the
+  // previous checkpoint intact.
+  const std::string temporary_path = path + ".tmp";
+  {
+    std::ofstream file{temporary_path, std::ios::binary};
+    TransferHeader(
+        [&file](auto* value) {
+          file.write(reinterpret_cast<const char*>(value), sizeof(*value));
+        },
+        &header);
+    file.write(payload, header.payload_size);
+    if (!file) {
+      std::cerr << "Error writing " << temporary_path << std::endl;
+      return false;
+    }
+  }
+
+  if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+    std::cerr << "Error renaming " << temporary_path << " to " << path
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool ReadCheckpoint(const std::string& path, Checkpoint* checkpoint) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    std::cerr << "Error opening " << path << std::endl;
+    return false;
+  }
+
+  CheckpointHeader header{};
+  TransferHeader(
+      [&file](auto* value) {
+        file.read(reinterpret_cast<char*>(value), sizeof(*value));
+      },
+      &header);
+  if (!file || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.float_size != sizeof(Float) || header.value_size != kValueSize) {
+    std::cerr << path << " is not a compatible checkpoint" << std::endl;
+    return false;
+  }
+
+  std::vector<char> payload(header.payload_size);
+  file.read(payload.data(), payload.size());
+  if (!file) {
+    std::cerr << "Error reading " << path << std::endl;
+    return false;
+  }
+
+  checkpoint->settings = header.settings;
+  checkpoint->current_phase = header.current_phase;
+  checkpoint->accumulated_samples_per_pixel =
+      header.accumulated_samples_per_pixel;
+  checkpoint->pixel_data.resize(header.num_values);
+
+  const size_t data_size = header.num_values * kValueSize;
+  if (header.is_compressed) {
+#ifdef PEWPEW_HAS_ZLIB
+    std::vector<uint8_t> shuffled(data_size);
+    uLongf shuffled_size = data_size;
+    if (uncompress(shuffled.data(), &shuffled_size,
+                   reinterpret_cast<const Bytef*>(payload.data()),
+                   payload.size()) != Z_OK ||
+        shuffled_size != data_size) {
+      std::cerr << "Error decompressing " << path << std::endl;
+      return false;
+    }
+    UnshuffleBytes(shuffled, &checkpoint->pixel_data);
+#else
+    std::cerr << "Reading compressed checkpoints needs zlib" << std::endl;
+    return false;
+#endif
+  } else {
+    if (payload.size() != data_size) {
+      std::cerr << path << " is truncated" << std::endl;
+      return false;
+    }
+    std::memcpy(checkpoint->pixel_data.data(), payload.data(), data_size);
+  }
+
+  return true;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& path, bool compress)
+    : path_(path),
+      compress_(compress),
+      thread_(std::bind_front(&CheckpointWriter::Run, this)) {}
+
+CheckpointWriter::~CheckpointWriter() {
+  // Pending checkpoints are still written before the thread exits.
+  thread_.request_stop();
+  thread_.join();
+}
+
+void CheckpointWriter::Submit(Checkpoint checkpoint) {
+  {
+    const std::lock_guard<std::mutex> guard(mutex_);
+    pending_ = std::move(checkpoint);
+  }
+  condition_.notify_one();
+}
+
+void CheckpointWriter::Run(std::stop_token token) {
+  while (true) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, token, [this] { return pending_.has_value(); });
+    if (!pending_.has_value()) {
+      return;
+    }
+
+    const Checkpoint checkpoint = std::move(pending_.value());
+    pending_.reset();
+    lock.unlock();
+
+    WriteCheckpoint(path_, checkpoint, compress_);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef PEWPEW_CHECKPOINT_H_
+#define PEWPEW_CHECKPOINT_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera.h"
+#include "float.h"
+
+// The state needed to resume a progressive render after its last completed
+// phase. Samples are seeded from their pixel and sample index, so the sample
+// count doubles as the random generator state.
+struct Checkpoint {
+  CameraSettings settings;
+  int current_phase;
+  int accumulated_samples_per_pixel;
+  std::vector<AccumulationFloat> pixel_data;
+};
+
+bool WriteCheckpoint(const std::string& path, const Checkpoint& checkpoint,
+                     bool compress);
+bool ReadCheckpoint(const std::string& path, Checkpoint* checkpoint);
+
+// Writes checkpoints on a background thread, so that rendering doesn't wait
+// for the disk. If checkpoints come in faster than they can be written, only
+// the latest one is kept.
+class CheckpointWriter {
+ public:
+  CheckpointWriter(const std::string& path, bool compress);
+  ~CheckpointWriter();
+
+  void Submit(Checkpoint checkpoint);
+
+ private:
+  void Run(std::stop_token token);
+
+  std::string path_;
+  bool compress_;
+  std::mutex mutex_;
+  std::condition_variable_any condition_;
+  std::optional<Checkpoint> pending_;
+  std::jthread thread_;
+};
+
+#endif  // PEWPEW_CHECKPOINT_H_
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "constant_medium.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+
+#include "float.h"
+#include "hittable.h"
+#include "medium.h"
+#include "pcg_random.hpp"
+#include "ray.h"
+#include "vec3.h"
+
+std::optional<HitRecord> ConstantMedium::Hit(const Ray& ray, Float tmin,
+                                             Float tmax) const {
+  Float entry_t = tmin;
+  Float exit_t = tmax;
+  if (!Clip(ray, &entry_t, &exit_t)) {
+    return std::nullopt;
+  }
+
+  const Float ray_length = ray.direction().length();
+  const Float distance_inside = (exit_t - entry_t) * ray_length;
+  pcg32 rng = MediumRandomGenerator(ray, entry_t);
+  const Float hit_distance = SampleFreeFlight(&rng, density_);
+  if (hit_distance > distance_inside) {
+    return std::nullopt;
+  }
+
+  const Float t = entry_t + hit_distance / ray_length;
+  // Media have no surface, hence any normal will do.
+  return HitRecord{t, ray.at(t), phase_function_, Vec3{1, 0, 0}, ray};
+}
+
+Float ConstantMedium::Transmittance(const Ray& ray, Float tmin,
+                                    Float tmax) const {
+  if (!Clip(ray, &tmin, &tmax)) {
+    return 1;
+  }
+  return std::exp(-density_ * (tmax - tmin) * ray.direction().length());
+}
+
+bool ConstantMedium::Clip(const Ray& ray, Float* tmin, Float* tmax) const {
+  const Float infinity = std::numeric_limits<Float>::infinity();
+  const std::optional<HitRecord> entry = boundary_->Hit(ray, -infinity,
+                                                        infinity);
+  if (!entry.has_value()) {
+    return false;
+  }
+  const std::optional<HitRecord> exit =
+      boundary_->Hit(ray, entry->t() + static_cast<Float>(0.0001), infinity);
+  if (!exit.has_value()) {
+    return false;
+  }
+
+  // Rays that start inside the medium enter it at their origin.
+  *tmin = std::max({*tmin, entry->t(), Float{0}});
+  *tmax = std::min(*tmax, exit->t());
+  return *tmin < *tmax;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef PEWPEW_CONSTANT_MEDIUM_H_
+#define PEWPEW_CONSTANT_MEDIUM_H_
+
+#include <memory>
+#include <optional>
+
+#include "aabb.h"
+#include "float.h"
+#include "hittable.h"
+#include "material.h"
+#include "ray.h"
+
+// A homogeneous medium filling a closed boundary, as in the second book.
+// Collisions are sampled in closed form from the exponential distribution of
+// free-flight distances, so the medium costs two boundary intersections per
+// ray whatever its density.
+class ConstantMedium : public Hittable {
+ public:
+  // `phase_function` is usually `Isotropic`.
+  ConstantMedium(std::shared_ptr<Hittable> boundary, Float density,
+                 Material* phase_function)
+      : boundary_(boundary),
+        density_(density),
+        phase_function_(phase_function) {}
+
+  std::optional<HitRecord> Hit(const Ray& ray, Float tmin,
+                               Float tmax) const override;
+  Aabb BoundingBox() const override { return boundary_->BoundingBox(); }
+
+  // The fraction of light along `ray` that crosses the medium between `tmin`
+  // and `tmax`, exactly.
+  Float Transmittance(const Ray& ray, Float tmin, Float tmax) const override;
+
+ private:
+  // Clips [tmin, tmax] to the part of the ray inside the boundary.
+  bool Clip(const Ray& ray, Float* tmin, Float* tmax) const;
+
+  std::shared_ptr<Hittable> boundary_;
+  Float density_;
+  Material* phase_function_;
+};
+
+#endif  // PEWPEW_CONSTANT_MEDIUM_H_
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "denoiser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "float.h"
+#include "numa.h"
+
+namespace {
+
+Float SquaredDistance(const std::vector<Float>& buffer, int p, int q) {
+  const Float d0 = buffer[p] - buffer[q];
+  const Float d1 = buffer[p + 1] - buffer[q + 1];
+  const Float d2 = buffer[p + 2] - buffer[q + 2];
+  return d0 * d0 + d1 * d1 + d2 * d2;
+}
+
+}  // namespace
+
+void Denoiser::Denoise(int width, int height, const std::vector<Float>& color,
+                       const std::vector<Float>& albedo,
+                       const std::vector<Float>& normal,
+                       std::vector<Float>* output) {
+  const int num_components = 3;
+  const Float min_albedo = 1e-3;
+
+  // Demodulate the albedo, leaving (mostly) smooth lighting to filter.
+  lighting_.resize(color.size());
+  for (size_t index = 0; index < color.size(); index++) {
+    lighting_[index] = color[index] / std::max(albedo[index], min_albedo);
+  }
+
+  // B3 spline kernel.
+  const Float kernel[5] = {1.0 / 16, 1.0 / 4, 3.0 / 8, 1.0 / 4, 1.0 / 16};
+  const int num_iterations = 5;
+  const Float normal_sigma_squared = 0.1;
+  const Float albedo_sigma_squared = 0.1;
+  Float color_sigma_squared = 1.0;
+
+  filtered_.resize(lighting_.size());
+  for (int iteration = 0; iteration < num_iterations; iteration++) {
+    const int step = 1 << iteration;
+
+    // Rows are split statically on placed threads, like the image loops of
+    // the camera.
+    // clang-format off
+    #pragma omp parallel
+    // clang-format on
+    {
+      PlaceOpenMpThread();
+
+      // clang-format off
+      #pragma omp for schedule(static)
+      // clang-format on
+      for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+          const int p = (y * width + x) * num_components;
+          Float sum[3] = {0, 0, 0};
+          Float weight_sum = 0;
+
+          for (int dy = -2; dy <= 2; dy++) {
+            const int qy = y + dy * step;
+            if (qy < 0 || qy >= height) {
+              continue;
+            }
+
+            for (int dx = -2; dx <= 2; dx++) {
+              const int qx = x + dx * step;
+              if (qx < 0 || qx >= width) {
+                continue;
+              }
+
+              const int q = (qy * width + qx) * num_components;
+              const Float weight =
+                  kernel[dx + 2] * kernel[dy + 2] *
+                  std::exp(
+                      -SquaredDistance(lighting_, p, q) / color_sigma_squared -
+                      SquaredDistance(normal, p, q) / normal_sigma_squared -
+                      SquaredDistance(albedo, p, q) / albedo_sigma_squared);
+              for (int k = 0; k < num_components; k++) {
+                sum[k] += weight * lighting_[q + k];
+              }
+              weight_sum += weight;
+            }
+          }
+
+          // `weight_sum` is never zero, since the center tap always counts.
+          for (int k = 0; k < num_components; k++) {
+            filtered_[p + k] = sum[k] / weight_sum;
+          }
+        }
+      }
+    }
+
+    lighting_.swap(filtered_);
+    // Coarser levels should only smooth out what the previous ones left.
+    color_sigma_squared /= 4;
+  }
+
+  output->resize(color.size());
+  for (size_t index = 0; index < color.size(); index++) {
+    (*output)[index] = albedo[index] >= min_albedo
+                           ? lighting_[index] * albedo[index]
+                           : color[index];
+  }
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef PEWPEW_DENOISER_H_
+#define PEWPEW_DENOISER_H_
+
+#include <vector>
+
+#include "float.h"
+
+// Edge-avoiding A-Trous wavelet filter (Dammertz et al., "Edge-Avoiding
+// A-Trous Wavelet Transform for fast Global Illumination Filtering"), guided
+// by the albedo and normal of the first hits.
+//
+// Buffers are kept between calls, so that denoising images of the same size
+// doesn't allocate.
+class Denoiser {
+ public:
+  // All buffers hold `width * height` RGB values, averaged over the samples
+  // of each pixel. Lighting is filtered separately from the albedo, so that
+  // texture details survive the filter.
+  void Denoise(int width, int height, const std::vector<Float>& color,
+               const std::vector<Float>& albedo,
+               const std::vector<Float>& normal, std::vector<Float>* output);
+
+ private:
+  std::vector<Float> lighting_;
+  std::vector<Float> filtered_;
+};
+
+#endif  // PEWPEW_DENOISER_H_
\ No newline at end of file
@@ -8,11 +8,12 @@
 #include "hittable.h"
 #include "material.h"
 #include "ray.h"
-#include "utils.h"
+#include "sampler.h"
 #include "vec3.h"
 
-std::optional<ScatterRecord> Dielectric::Scatter(
-    const Ray& ray, const HitRecord& record) const {
+std::optional<ScatterRecord> Dielectric::Scatter(const Ray& ray,
+                                                 const HitRecord& record,
+                                                 Sampler* sampler) const {
   const Float refraction_index =
       record.is_front_face() ? (1.0 / refraction_index_) : refraction_index_;
 
@@ -22,7 +23,7 @@ std::optional<ScatterRecord> Dielectric::Scatter(
 
   const bool cannot_refract = refraction_index * sin_theta > 1.0;
   const bool is_reflective =
-      Reflectance(cos_theta, refraction_index) > RandomFloat();
+      Reflectance(cos_theta, refraction_index) > sampler->Get1D();
   const Vec3 direction =
       cannot_refract || is_reflective
           ? Reflect(unit_direction, record.normal())
@@ -8,13 +8,14 @@
 #include "hittable.h"
 #include "material.h"
 #include "ray.h"
+#include "sampler.h"
 
 class Dielectric : public Material {
  public:
   Dielectric(Float refraction_index) : refraction_index_(refraction_index) {}
 
-  std::optional<ScatterRecord> Scatter(const Ray& ray,
-                                       const HitRecord& record) const override;
+  std::optional<ScatterRecord> Scatter(const Ray& ray, const HitRecord& record,
+                                       Sampler* sampler) const override;
 
  private:
   Float refraction_index_;
@@ -0,0 +1,31 @@
+#ifndef PEWPEW_DIFFUSE_LIGHT_H_
+#define PEWPEW_DIFFUSE_LIGHT_H_
+
+#include <optional>
+
+#include "color.h"
+#include "hittable.h"
+#include "material.h"
+#include "ray.h"
+#include "sampler.h"
+
+// Emits the same radiance in all directions, from both sides, and scatters
+// nothing.
+class DiffuseLight : public Material {
+ public:
+  DiffuseLight(const Color& emission) : emission_(emission) {}
+
+  std::optional<ScatterRecord> Scatter(const Ray& ray, const HitRecord& record,
+                                       Sampler* sampler) const override {
+    return std::nullopt;
+  }
+
+  Color Emitted(const Ray& ray, const HitRecord& record) const override {
+    return emission_;
+  }
+
+ private:
+  Color emission_;
+};
+
+#endif  // PEWPEW_DIFFUSE_LIGHT_H_
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "distributed.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "camera.h"
+#include "float.h"
+#include "hittable.h"
+#include "light_list.h"
+#include "socket.h"
+
+extern char** environ;
+
+namespace {
+
+struct WorkItem {
+  Tile tile;
+  int sample_begin;
+  int sample_count;
+};
+
+// Sent as is, since the coordinator and its workers run the same binary.
+struct WorkRequest {
+  CameraSettings settings;
+  WorkItem item;
+};
+
+static_assert(std::is_trivially_copyable_v<WorkRequest>);
+
+class WorkQueue {
+ public:
+  void Push(const WorkItem& item) {
+    const std::lock_guard<std::mutex> guard(mutex_);
+    pending_.push_back(item);
+  }
+
+  // Blocks until an item is available. Returns false once every item has been
+  // completed.
+  bool Pop(WorkItem* item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return !pending_.empty() || Done(); });
+    return PopLocked(item);
+  }
+
+  bool TryPop(WorkItem* item) {
+    const std::lock_guard<std::mutex> guard(mutex_);
+    return PopLocked(item);
+  }
+
+  void Complete() {
+    const std::lock_guard<std::mutex> guard(mutex_);
+    in_flight_--;
+    condition_.notify_all();
+  }
+
+  // Hands an item out again, e.g. after its worker died.
+  void Requeue(const WorkItem& item) {
+    const std::lock_guard<std::mutex> guard(mutex_);
+    in_flight_--;
+    pending_.push_front(item);
+    condition_.notify_all();
+  }
+
+  bool done() {
+    const std::lock_guard<std::mutex> guard(mutex_);
+    return Done();
+  }
+
+ private:
+  bool Done() const { return pending_.empty() && in_flight_ == 0; }
+
+  bool PopLocked(WorkItem* item) {
+    if (pending_.empty()) {
+      return false;
+    }
+
+    *item = pending_.front();
+    pending_.pop_front();
+    in_flight_++;
+    return true;
+  }
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<WorkItem> pending_;
+  int in_flight_ = 0;
+};
+
+}  // namespace
+
+bool Coordinator::Render(Camera* camera, const Hittable& world) {
+  const int listen_fd = OpenSocket(address_, /*is_server=*/true);
+  if (listen_fd < 0) {
+    std::cerr << "Error listening on " << address_ << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  if (!SpawnLocalWorkers()) {
+    close(listen_fd);
+    return false;
+  }
+
+  const CameraSettings& settings = camera->settings();
+  camera->Initialize(SettingsUpdateType::kUpdateTextureAndSettings);
+
+  // Large sample counts are split into several ranges, so that a 4096 spp
+  // render is spread over more workers than there are tiles.
+  const int samples_per_pixel = 1 << settings.samples_per_pixel_log2;
+  const int samples_per_item = std::min(samples_per_pixel, 64);
+
+  WorkQueue queue;
+  for (int y = 0; y < settings.image_height; y += tile_size_) {
+    for (int x = 0; x < settings.image_width; x += tile_size_) {
+      const Tile tile{x, y, std::min(tile_size_, settings.image_width - x),
+                      std::min(tile_size_, settings.image_height - y)};
+      for (int sample = 0; sample < samples_per_pixel;
+           sample += samples_per_item) {
+        queue.Push(WorkItem{tile, sample, samples_per_item});
+      }
+    }
+  }
+
+  std::mutex accumulation_mutex;
+  std::atomic<int> num_live_workers = 0;
+  std::atomic<int> num_failed_items = 0;
+
+  auto serve_worker = [&](int fd) {
+    // A hung worker fails to receive rather than stalling the render.
+    if (worker_timeout_seconds_ > 0) {
+      const timeval timeout{.tv_sec = worker_timeout_seconds_, .tv_usec = 0};
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    std::vector<AccumulationFloat> tile_data;
+    WorkItem item;
+    while (queue.Pop(&item)) {
+      const WorkRequest request{settings, item};
+      tile_data.resize(item.tile.width * item.tile.height * 3);
+      const size_t size = tile_data.size() * sizeof(AccumulationFloat);
+      if (!SendAll(fd, &request, sizeof(request)) ||
+          !ReceiveAll(fd, tile_data.data(), size)) {
+        queue.Requeue(item);
+        num_failed_items++;
+        break;
+      }
+
+      const std::lock_guard<std::mutex> guard(accumulation_mutex);
+      camera->AccumulateTile(item.tile, tile_data);
+      queue.Complete();
+    }
+
+    close(fd);
+    num_live_workers--;
+  };
+
+  std::vector<std::jthread> worker_threads;
+  std::chrono::time_point last_worker_time = std::chrono::steady_clock::now();
+  std::vector<AccumulationFloat> tile_data;
+  while (!queue.done()) {
+    pollfd listen_poll{listen_fd, POLLIN, 0};
+    if (poll(&listen_poll, 1, /*timeout=*/100) > 0) {
+      const int fd = accept(listen_fd, nullptr, nullptr);
+      if (fd >= 0) {
+        num_live_workers++;
+        worker_threads.emplace_back(serve_worker, fd);
+      }
+    }
+
+    if (num_live_workers > 0) {
+      last_worker_time = std::chrono::steady_clock::now();
+      continue;
+    }
+
+    // Without workers, e.g. because they all died, render one item locally
+    // after a grace period and check again for new connections.
+    const std::chrono::seconds grace_period{2};
+    WorkItem item;
+    if (std::chrono::steady_clock::now() - last_worker_time > grace_period &&
+        queue.TryPop(&item)) {
+      camera->RenderTile(item.tile, item.sample_begin, item.sample_count,
+                         world, &tile_data);
+      const std::lock_guard<std::mutex> guard(accumulation_mutex);
+      camera->AccumulateTile(item.tile, tile_data);
+      queue.Complete();
+    }
+  }
+
+  worker_threads.clear();
+  close(listen_fd);
+  std::string host;
+  std::string port;
+  if (!IsTcpAddress(address_, &host, &port)) {
+    unlink(address_.c_str());
+  }
+
+  // Workers exit once their connection closes, unless they hung.
+  for (pid_t pid : local_worker_pids_) {
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+  }
+  local_worker_pids_.clear();
+
+  if (num_failed_items > 0) {
+    std::cerr << num_failed_items << " work items were rescheduled after "
+              << "worker failures or timeouts" << std::endl;
+  }
+
+  camera->FinishAccumulation(samples_per_pixel);
+  return true;
+}
+
+bool Coordinator::SpawnLocalWorkers() {
+  const std::string worker_flag = "--worker=" + address_;
+  std::vector<char*> argv = {const_cast<char*>(executable_.c_str()),
+                             const_cast<char*>(worker_flag.c_str())};
+  for (const std::string& flag : worker_flags_) {
+    argv.push_back(const_cast<char*>(flag.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  for (int i = 0; i < num_local_workers_; i++) {
+    pid_t pid;
+    // `executable_` is `argv[0]`, which is only a name when started through
+    // `PATH`.
+    const int error = posix_spawnp(&pid, executable_.c_str(), nullptr,
+                                   nullptr, argv.data(), environ);
+    if (error != 0) {
+      std::cerr << "Error spawning a local worker: " << std::strerror(error)
+                << std::endl;
+      for (pid_t spawned_pid : local_worker_pids_) {
+        kill(spawned_pid, SIGTERM);
+        waitpid(spawned_pid, nullptr, 0);
+      }
+      local_worker_pids_.clear();
+      return false;
+    }
+    local_worker_pids_.push_back(pid);
+  }
+
+  return true;
+}
+
+bool RunWorker(const std::string& address, const Hittable& world,
+               const LightList* lights) {
+  // The coordinator may not be listening yet when local workers start.
+  int fd = -1;
+  for (int attempt = 0; attempt < 50 && fd < 0; attempt++) {
+    fd = OpenSocket(address, /*is_server=*/false);
+    if (fd < 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+  if (fd < 0) {
+    std::cerr << "Error connecting to " << address << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  Camera camera{CameraSettings{}};
+  camera.set_lights(lights);
+  std::vector<AccumulationFloat> tile_data;
+  WorkRequest request;
+  while (ReceiveAll(fd, &request, sizeof(request))) {
+    camera.set_settings(request.settings);
+    camera.InitializeViewport();
+    camera.RenderTile(request.item.tile, request.item.sample_begin,
+                      request.item.sample_count, world, &tile_data);
+    if (!SendAll(fd, tile_data.data(),
+                 tile_data.size() * sizeof(AccumulationFloat))) {
+      break;
+    }
+  }
+
+  close(fd);
+  return true;
+}
\ No newline at end of file
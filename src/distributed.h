@@ -0,0 +1,55 @@
+#ifndef PEWPEW_DISTRIBUTED_H_
+#define PEWPEW_DISTRIBUTED_H_
+
+#include <sys/types.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "camera.h"
+#include "hittable.h"
+#include "light_list.h"
+
+// Addresses are those of `OpenSocket`.
+
+// Splits the image into tiles and sample ranges, hands them out to the
+// workers connected to `address`, and merges their partial accumulations into
+// the camera. Work items of a worker that dies, or that takes longer than
+// `worker_timeout_seconds` to return one, are handed out again, and rendered
+// locally if no worker is left.
+class Coordinator {
+ public:
+  // Local workers are started with `worker_flags`, e.g. to build the same
+  // scene.
+  Coordinator(const std::string& address, const std::string& executable,
+              std::vector<std::string> worker_flags, int num_local_workers,
+              int tile_size, int worker_timeout_seconds)
+      : address_(address),
+        executable_(executable),
+        worker_flags_(std::move(worker_flags)),
+        num_local_workers_(num_local_workers),
+        tile_size_(tile_size),
+        worker_timeout_seconds_(worker_timeout_seconds) {}
+
+  bool Render(Camera* camera, const Hittable& world);
+
+ private:
+  bool SpawnLocalWorkers();
+
+  std::string address_;
+  std::string executable_;
+  std::vector<std::string> worker_flags_;
+  int num_local_workers_;
+  int tile_size_;
+  // 0 for none.
+  int worker_timeout_seconds_;
+  std::vector<pid_t> local_worker_pids_;
+};
+
+// Connects to a coordinator and renders the work items it receives until the
+// coordinator closes the connection.
+bool RunWorker(const std::string& address, const Hittable& world,
+               const LightList* lights);
+
+#endif  // PEWPEW_DISTRIBUTED_H_
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "environment_map.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numbers>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "alias_table.h"
+#include "color.h"
+#include "float.h"
+#include "sampler.h"
+#include "vec3.h"
+
+namespace {
+
+// Portable float maps: a text header, then rows of floats from the bottom to
+// the top, little-endian if the scale is negative.
+bool ReadPfm(std::istream& file, int* width, int* height,
+             std::vector<float>* texels) {
+  std::string magic;
+  double scale;
+  if (!(file >> magic >> *width >> *height >> scale) ||
+      (magic != "PF" && magic != "Pf") || *width <= 0 || *height <= 0 ||
+      scale == 0) {
+    return false;
+  }
+  // A single whitespace character separates the header from the floats.
+  file.get();
+
+  const int channels = magic == "PF" ? 3 : 1;
+  const bool swap_bytes = (scale < 0) != (std::endian::native ==
+                                          std::endian::little);
+  std::vector<float> row(channels * *width);
+  texels->resize(3 * *width * *height);
+  for (int y = *height - 1; y >= 0; y--) {
+    file.read(reinterpret_cast<char*>(row.data()), row.size() * sizeof(float));
+    if (!file) {
+      return false;
+    }
+    for (float& value : row) {
+      uint32_t bits = std::bit_cast<uint32_t>(value);
+      if (swap_bytes) {
+        bits = (bits >> 24) | ((bits >> 8) & 0xff00) |
+               ((bits << 8) & 0xff0000) | (bits << 24);
+      }
+      value = std::bit_cast<float>(bits);
+    }
+    float* destination = texels->data() + 3 * *width * y;
+    for (int x = 0; x < *width; x++) {
+      for (int k = 0; k < 3; k++) {
+        destination[3 * x + k] = row[channels * x + (channels == 3 ? k : 0)];
+      }
+    }
+  }
+  return true;
+}
+
+// Reads a scanline of RGBE texels, either flat or run-length encoded a
+// channel after the other.
+bool ReadRgbeScanline(std::istream& file, int width,
+                      std::vector<uint8_t>* scanline) {
+  uint8_t* texels = scanline->data();
+  if (!file.read(reinterpret_cast<char*>(texels), 4)) {
+    return false;
+  }
+  if (width < 8 || width > 0x7fff || texels[0] != 2 || texels[1] != 2 ||
+      (texels[2] & 0x80) != 0) {
+    return static_cast<bool>(
+        file.read(reinterpret_cast<char*>(texels + 4), 4 * (width - 1)));
+  }
+  if ((texels[2] << 8 | texels[3]) != width) {
+    return false;
+  }
+
+  for (int channel = 0; channel < 4; channel++) {
+    for (int x = 0; x < width;) {
+      int count = file.get();
+      if (count == std::char_traits<char>::eof()) {
+        return false;
+      }
+      const bool run = count > 128;
+      if (run) {
+        count -= 128;
+      }
+      if (count == 0 || count > width - x) {
+        return false;
+      }
+      if (run) {
+        const int value = file.get();
+        for (int i = 0; i < count; i++) {
+          texels[4 * (x + i) + channel] = value;
+        }
+      } else {
+        for (int i = 0; i < count; i++) {
+          texels[4 * (x + i) + channel] = file.get();
+        }
+      }
+      x += count;
+    }
+  }
+  return static_cast<bool>(file);
+}
+
+// Radiance files: text header lines up to an empty one, the resolution, then
+// a shared exponent for the three channels of each texel.
+bool ReadRgbe(std::istream& file, int* width, int* height,
+              std::vector<float>* texels) {
+  std::string line;
+  if (!std::getline(file, line) || line.rfind("#?", 0) != 0) {
+    return false;
+  }
+  while (std::getline(file, line) && !line.empty()) {
+    if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+      return false;
+    }
+  }
+  std::string y_axis;
+  std::string x_axis;
+  if (!std::getline(file, line) ||
+      !(std::istringstream{line} >> y_axis >> *height >> x_axis >> *width) ||
+      y_axis != "-Y" || x_axis != "+X" || *width <= 0 || *height <= 0) {
+    return false;
+  }
+
+  std::vector<uint8_t> scanline(4 * *width);
+  texels->resize(3 * *width * *height);
+  for (int y = 0; y < *height; y++) {
+    if (!ReadRgbeScanline(file, *width, &scanline)) {
+      return false;
+    }
+    float* destination = texels->data() + 3 * *width * y;
+    for (int x = 0; x < *width; x++) {
+      const uint8_t* texel = &scanline[4 * x];
+      const float scale =
+          texel[3] == 0 ? 0.0f : std::ldexp(1.0f, texel[3] - (128 + 8));
+      for (int k = 0; k < 3; k++) {
+        destination[3 * x + k] = (texel[k] + 0.5f) * scale;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+std::unique_ptr<EnvironmentMap> EnvironmentMap::Load(const std::string& path) {
+  std::ifstream file{path, std::ios::binary};
+  char magic[2] = {};
+  file.read(magic, sizeof(magic));
+  file.seekg(0);
+
+  int width;
+  int height;
+  std::vector<float> texels;
+  bool success = false;
+  if (std::memcmp(magic, "PF", 2) == 0 || std::memcmp(magic, "Pf", 2) == 0) {
+    success = ReadPfm(file, &width, &height, &texels);
+  } else if (std::memcmp(magic, "#?", 2) == 0) {
+    success = ReadRgbe(file, &width, &height, &texels);
+  }
+  if (!success) {
+    std::cerr << path << " is not a PFM or Radiance RGBE image" << std::endl;
+    return nullptr;
+  }
+  return std::unique_ptr<EnvironmentMap>(
+      new EnvironmentMap(width, height, std::move(texels)));
+}
+
+EnvironmentMap::EnvironmentMap(int width, int height,
+                               std::vector<float> texels)
+    : width_(width),
+      height_(height),
+      texels_(std::move(texels)),
+      columns_(height) {
+  // Rows are picked by their luminance, times the solid angle of their
+  // texels, which shrinks towards the poles.
+  const Float pi = std::numbers::pi_v<Float>;
+  std::vector<Float> row_weights(height_);
+  // clang-format off
+  #pragma omp parallel for schedule(static)
+  // clang-format on
+  for (int y = 0; y < height_; y++) {
+    std::vector<Float> weights(width_);
+    Float sum = 0;
+    for (int x = 0; x < width_; x++) {
+      const float* texel = &texels_[3 * (y * width_ + x)];
+      weights[x] =
+          std::max<Float>(0, Luminance(Color{texel[0], texel[1], texel[2]}));
+      sum += weights[x];
+    }
+    if (sum <= 0) {
+      // Never picked, but the table needs a positive sum.
+      std::fill(weights.begin(), weights.end(), 1);
+    }
+    columns_[y] = AliasTable{weights};
+    row_weights[y] = sum * std::sin(pi * (y + static_cast<Float>(0.5)) /
+                                    height_);
+  }
+
+  if (std::all_of(row_weights.begin(), row_weights.end(),
+                  [](Float weight) { return weight <= 0; })) {
+    std::fill(row_weights.begin(), row_weights.end(), 1);
+  }
+  rows_ = AliasTable{row_weights};
+}
+
+Color EnvironmentMap::Radiance(const Vec3& direction) const {
+  const Float pi = std::numbers::pi_v<Float>;
+  const Vec3 unit_direction = UnitVector(direction);
+  const Float theta = std::acos(std::clamp<Float>(unit_direction.y(), -1, 1));
+  const Float phi =
+      std::atan2(-unit_direction.z(), unit_direction.x()) + pi;
+  const int x = std::min(static_cast<int>(phi / (2 * pi) * width_),
+                         width_ - 1);
+  const int y = std::min(static_cast<int>(theta / pi * height_), height_ - 1);
+  const float* texel = &texels_[3 * (y * width_ + x)];
+  return Color{texel[0], texel[1], texel[2]};
+}
+
+Vec3 EnvironmentMap::Sample(const Sample2D& texel, const Sample2D& offset,
+                            Float* pdf) const {
+  const Float pi = std::numbers::pi_v<Float>;
+  const int y = rows_.Sample(texel.u);
+  const int x = columns_[y].Sample(texel.v);
+  const Float theta = pi * (y + offset.v) / height_;
+  const Float phi = 2 * pi * (x + offset.u) / width_;
+
+  // The density is uniform over the texel in image space, which maps to
+  // 2 pi^2 sin(theta) of solid angle.
+  const Float sin_theta = std::sin(theta);
+  *pdf = sin_theta > 0 ? rows_.probability(y) * columns_[y].probability(x) *
+                             width_ * height_ / (2 * pi * pi * sin_theta)
+                       : 0;
+  return Vec3{sin_theta * std::cos(phi - pi), std::cos(theta),
+              -sin_theta * std::sin(phi - pi)};
+}
\ No newline at end of file
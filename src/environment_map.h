@@ -0,0 +1,44 @@
+#ifndef PEWPEW_ENVIRONMENT_MAP_H_
+#define PEWPEW_ENVIRONMENT_MAP_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "alias_table.h"
+#include "color.h"
+#include "float.h"
+#include "sampler.h"
+#include "vec3.h"
+
+// Radiance arriving from infinitely far away, as an HDR image in the
+// equirectangular layout: columns go around the y axis from -x, as the
+// longitudes of a textured sphere, and rows from +y down to -y.
+//
+// Directions are importance sampled in proportion to the luminance of their
+// texel, from an alias table over the rows and one over the texels of each
+// row, in constant time.
+class EnvironmentMap {
+ public:
+  // Loads a PFM, or a Radiance RGBE (.hdr) image. Prints an error and returns
+  // null if it can't be loaded.
+  static std::unique_ptr<EnvironmentMap> Load(const std::string& path);
+
+  Color Radiance(const Vec3& direction) const;
+
+  // Picks a texel from `texel` and a point within it from `offset`, and sets
+  // `*pdf` to the solid angle density of the direction towards it.
+  Vec3 Sample(const Sample2D& texel, const Sample2D& offset, Float* pdf) const;
+
+ private:
+  // `texels` are the RGB values of the rows, from top to bottom.
+  EnvironmentMap(int width, int height, std::vector<float> texels);
+
+  int width_;
+  int height_;
+  std::vector<float> texels_;
+  AliasTable rows_;
+  std::vector<AliasTable> columns_;
+};
+
+#endif  // PEWPEW_ENVIRONMENT_MAP_H_
\ No newline at end of file
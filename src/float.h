@@ -1,6 +1,58 @@
 #ifndef PEWPEW_FLOAT_H_
 #define PEWPEW_FLOAT_H_
 
+#include <cmath>
+
+// Precision profiles, selected with the `PEWPEW_PRECISION` CMake option.
+// Geometry and shading use `Float`, while the per-pixel sums that grow over
+// thousands of samples use `AccumulationFloat`.
+#if defined(PEWPEW_PRECISION_DOUBLE)
+using Float = double;
+using AccumulationFloat = double;
+#elif defined(PEWPEW_PRECISION_DOUBLE_ACCUMULATION)
+using Float = float;
+using AccumulationFloat = double;
+#else
 using Float = float;
+using AccumulationFloat = float;
+#endif
+
+#ifdef PEWPEW_PRECISION_COMPENSATED
+inline constexpr bool kCompensatedAccumulation = true;
+#else
+inline constexpr bool kCompensatedAccumulation = false;
+#endif
+
+// Adds `value` to `*sum`, keeping the rounding error in `*compensation`
+// (Kahan-Babuska summation). `*sum + *compensation` is the compensated sum.
+inline void CompensatedAdd(AccumulationFloat value, AccumulationFloat* sum,
+                           AccumulationFloat* compensation) {
+  const AccumulationFloat new_sum = *sum + value;
+  if (std::abs(*sum) >= std::abs(value)) {
+    *compensation += (*sum - new_sum) + value;
+  } else {
+    *compensation += (value - new_sum) + *sum;
+  }
+  *sum = new_sum;
+}
+
+// A running sum in accumulation precision, compensated in the compensated
+// profile.
+class Accumulator {
+ public:
+  void Add(AccumulationFloat value) {
+    if constexpr (kCompensatedAccumulation) {
+      CompensatedAdd(value, &sum_, &compensation_);
+    } else {
+      sum_ += value;
+    }
+  }
+
+  AccumulationFloat sum() const { return sum_ + compensation_; }
+
+ private:
+  AccumulationFloat sum_ = 0;
+  AccumulationFloat compensation_ = 0;
+};
 
 #endif  // PEWPEW_FLOAT_H_
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "grid_medium.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "float.h"
+#include "hittable.h"
+#include "medium.h"
+#include "pcg_random.hpp"
+#include "ray.h"
+#include "vec3.h"
+
+GridMedium::GridMedium(const Point3& min, const Point3& max, int resolution,
+                       std::vector<float> densities, Material* phase_function)
+    : min_(min),
+      max_(max),
+      resolution_(resolution),
+      densities_(std::move(densities)),
+      num_blocks_((resolution + kMajorantBlockSize - 1) / kMajorantBlockSize),
+      block_size_((max - min) * (static_cast<Float>(kMajorantBlockSize) /
+                                 resolution)),
+      phase_function_(phase_function) {
+  // Trilinear interpolation stays within the vertices around a voxel, so a
+  // block's majorant is the maximum of its vertices, including those it
+  // shares with the next blocks.
+  const int num_vertices = resolution_ + 1;
+  majorants_.assign(num_blocks_ * num_blocks_ * num_blocks_, 0.0f);
+  for (int z = 0; z < num_vertices; z++) {
+    for (int y = 0; y < num_vertices; y++) {
+      for (int x = 0; x < num_vertices; x++) {
+        const float density =
+            densities_[(z * num_vertices + y) * num_vertices + x];
+        // Vertices on a block boundary belong to both blocks.
+        const int block_x = x / kMajorantBlockSize;
+        const int block_y = y / kMajorantBlockSize;
+        const int block_z = z / kMajorantBlockSize;
+        for (int k = std::max(0, (z - 1) / kMajorantBlockSize);
+             k <= std::min(block_z, num_blocks_ - 1); k++) {
+          for (int j = std::max(0, (y - 1) / kMajorantBlockSize);
+               j <= std::min(block_y, num_blocks_ - 1); j++) {
+            for (int i = std::max(0, (x - 1) / kMajorantBlockSize);
+                 i <= std::min(block_x, num_blocks_ - 1); i++) {
+              float& majorant =
+                  majorants_[(k * num_blocks_ + j) * num_blocks_ + i];
+              majorant = std::max(majorant, density);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename Visit>
+void GridMedium::Traverse(const Ray& ray, Float tmin, Float tmax,
+                          Visit visit) const {
+  const Float infinity = std::numeric_limits<Float>::infinity();
+  const Point3 start = ray.at(tmin);
+  int block[3];
+  int step[3];
+  Float next_t[3];
+  Float delta_t[3];
+  for (int axis = 0; axis < 3; axis++) {
+    block[axis] = std::clamp(
+        static_cast<int>((start[axis] - min_[axis]) / block_size_[axis]), 0,
+        num_blocks_ - 1);
+    const Float direction = ray.direction()[axis];
+    if (direction == 0) {
+      step[axis] = 0;
+      next_t[axis] = infinity;
+      delta_t[axis] = infinity;
+      continue;
+    }
+    step[axis] = direction > 0 ? 1 : -1;
+    const Float boundary =
+        min_[axis] + (block[axis] + (direction > 0)) * block_size_[axis];
+    next_t[axis] = (boundary - ray.origin()[axis]) / direction;
+    delta_t[axis] = block_size_[axis] / std::abs(direction);
+  }
+
+  Float t = tmin;
+  while (t < tmax) {
+    const int axis = next_t[0] < next_t[1]
+                         ? (next_t[0] < next_t[2] ? 0 : 2)
+                         : (next_t[1] < next_t[2] ? 1 : 2);
+    const Float block_end = std::min(next_t[axis], tmax);
+    const float majorant =
+        majorants_[(block[2] * num_blocks_ + block[1]) * num_blocks_ +
+                   block[0]];
+    if (!visit(t, block_end, majorant)) {
+      return;
+    }
+
+    t = block_end;
+    block[axis] += step[axis];
+    if (block[axis] < 0 || block[axis] >= num_blocks_) {
+      return;
+    }
+    next_t[axis] += delta_t[axis];
+  }
+}
+
+std::optional<HitRecord> GridMedium::Hit(const Ray& ray, Float tmin,
+                                         Float tmax) const {
+  if (!Clip(ray, &tmin, &tmax)) {
+    return std::nullopt;
+  }
+
+  const Float ray_length = ray.direction().length();
+  pcg32 rng = MediumRandomGenerator(ray, tmin);
+  std::optional<Float> hit_t;
+  Traverse(ray, tmin, tmax, [&](Float t0, Float t1, Float majorant) {
+    if (majorant <= 0) {
+      return true;
+    }
+    for (Float t = t0;;) {
+      t += SampleFreeFlight(&rng, majorant) / ray_length;
+      if (t >= t1) {
+        return true;
+      }
+      if (MediumRandomFloat(&rng) * majorant < Density(ray.at(t))) {
+        hit_t = t;
+        return false;
+      }
+    }
+  });
+
+  if (!hit_t.has_value()) {
+    return std::nullopt;
+  }
+  // Media have no surface, hence any normal will do.
+  return HitRecord{*hit_t, ray.at(*hit_t), phase_function_, Vec3{1, 0, 0},
+                   ray};
+}
+
+Float GridMedium::Transmittance(const Ray& ray, Float tmin,
+                                Float tmax) const {
+  if (!Clip(ray, &tmin, &tmax)) {
+    return 1;
+  }
+
+  const Float ray_length = ray.direction().length();
+  pcg32 rng = MediumRandomGenerator(ray, tmin);
+  Float transmittance = 1;
+  Traverse(ray, tmin, tmax, [&](Float t0, Float t1, Float majorant) {
+    if (majorant <= 0) {
+      return true;
+    }
+    for (Float t = t0;;) {
+      t += SampleFreeFlight(&rng, majorant) / ray_length;
+      if (t >= t1) {
+        return true;
+      }
+      transmittance *= 1 - Density(ray.at(t)) / majorant;
+    }
+  });
+  return transmittance;
+}
+
+Float GridMedium::Density(const Point3& p) const {
+  const int num_vertices = resolution_ + 1;
+  Float coordinates[3];
+  int cells[3];
+  for (int axis = 0; axis < 3; axis++) {
+    const Float x = std::clamp<Float>(
+        (p[axis] - min_[axis]) / (max_[axis] - min_[axis]) * resolution_, 0,
+        resolution_);
+    cells[axis] = std::min(static_cast<int>(x), resolution_ - 1);
+    coordinates[axis] = x - cells[axis];
+  }
+
+  auto vertex = [&](int dx, int dy, int dz) -> Float {
+    return densities_[((cells[2] + dz) * num_vertices + cells[1] + dy) *
+                          num_vertices +
+                      cells[0] + dx];
+  };
+  auto lerp = [](Float a, Float b, Float t) { return a + t * (b - a); };
+  const Float u = coordinates[0];
+  const Float v = coordinates[1];
+  const Float w = coordinates[2];
+  return lerp(lerp(lerp(vertex(0, 0, 0), vertex(1, 0, 0), u),
+                   lerp(vertex(0, 1, 0), vertex(1, 1, 0), u), v),
+              lerp(lerp(vertex(0, 0, 1), vertex(1, 0, 1), u),
+                   lerp(vertex(0, 1, 1), vertex(1, 1, 1), u), v),
+              w);
+}
+
+bool GridMedium::Clip(const Ray& ray, Float* tmin, Float* tmax) const {
+  // Rays that start inside the medium enter it at their origin.
+  *tmin = std::max(*tmin, Float{0});
+  for (int axis = 0; axis < 3; axis++) {
+    const Float inverse_direction = 1 / ray.direction()[axis];
+    Float t0 = (min_[axis] - ray.origin()[axis]) * inverse_direction;
+    Float t1 = (max_[axis] - ray.origin()[axis]) * inverse_direction;
+    if (t0 > t1) {
+      std::swap(t0, t1);
+    }
+    *tmin = std::max(*tmin, t0);
+    *tmax = std::min(*tmax, t1);
+  }
+  return *tmin < *tmax;
+}
\ No newline at end of file
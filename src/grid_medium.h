@@ -0,0 +1,59 @@
+#ifndef PEWPEW_GRID_MEDIUM_H_
+#define PEWPEW_GRID_MEDIUM_H_
+
+#include <optional>
+#include <vector>
+
+#include "aabb.h"
+#include "float.h"
+#include "hittable.h"
+#include "material.h"
+#include "ray.h"
+#include "vec3.h"
+
+// A heterogeneous medium filling the box [min, max], its density given at the
+// (resolution + 1)^3 vertices of a grid of resolution^3 voxels, x first, and
+// interpolated trilinearly.
+//
+// Collisions are sampled by delta tracking: tentative collisions are drawn
+// against the maximum density of coarse blocks of voxels, the majorant grid,
+// and accepted in proportion to the actual density. Walking the blocks along
+// the ray keeps the majorants tight, and skips empty space without a single
+// density lookup.
+class GridMedium : public Hittable {
+ public:
+  // `phase_function` is usually `Isotropic`.
+  GridMedium(const Point3& min, const Point3& max, int resolution,
+             std::vector<float> densities, Material* phase_function);
+
+  std::optional<HitRecord> Hit(const Ray& ray, Float tmin,
+                               Float tmax) const override;
+  Aabb BoundingBox() const override { return Aabb{min_, max_}; }
+
+  // An unbiased estimate, by ratio tracking, of the fraction of light along
+  // `ray` that crosses the medium between `tmin` and `tmax`.
+  Float Transmittance(const Ray& ray, Float tmin, Float tmax) const override;
+
+ private:
+  // Voxels per block of the majorant grid, along each axis.
+  static constexpr int kMajorantBlockSize = 8;
+
+  Float Density(const Point3& p) const;
+  // Clips [tmin, tmax] to the part of the ray inside the box.
+  bool Clip(const Ray& ray, Float* tmin, Float* tmax) const;
+  // Calls `visit(t0, t1, majorant)` for the blocks the ray crosses between
+  // `tmin` and `tmax`, in order, until it returns false.
+  template <typename Visit>
+  void Traverse(const Ray& ray, Float tmin, Float tmax, Visit visit) const;
+
+  Point3 min_;
+  Point3 max_;
+  int resolution_;
+  std::vector<float> densities_;
+  int num_blocks_;
+  Vec3 block_size_;
+  std::vector<float> majorants_;
+  Material* phase_function_;
+};
+
+#endif  // PEWPEW_GRID_MEDIUM_H_
\ No newline at end of file
@@ -4,18 +4,23 @@
 #include <memory>
 #include <optional>
 
+#include "aabb.h"
 #include "float.h"
 #include "material.h"
 #include "ray.h"
+#include "sampler.h"
 #include "vec3.h"
 
 class Material;
 
 class HitRecord {
  public:
+  // `footprint` is the width of the ray cone at the hit, in texture
+  // coordinates.
   HitRecord(Float t, const Point3& p, Material* material,
-            const Vec3& outward_normal, const Ray& ray)
-      : t_(t), p_(p), material_(material) {
+            const Vec3& outward_normal, const Ray& ray, Float u = 0,
+            Float v = 0, Float footprint = 0)
+      : t_(t), p_(p), material_(material), u_(u), v_(v), footprint_(footprint) {
     is_front_face_ = Dot(ray.direction(), outward_normal) < 0;
     normal_ = is_front_face_ ? outward_normal : -outward_normal;
   }
@@ -25,11 +30,17 @@ class HitRecord {
   Material* material() const { return material_; }
   bool is_front_face() const { return is_front_face_; }
   Vec3 normal() const { return normal_; }
+  Float u() const { return u_; }
+  Float v() const { return v_; }
+  Float footprint() const { return footprint_; }
 
  private:
   Float t_;
   Point3 p_;
   Material* material_;
+  Float u_;
+  Float v_;
+  Float footprint_;
   bool is_front_face_;
   Vec3 normal_;
 };
@@ -40,6 +51,26 @@ class Hittable {
 
   virtual std::optional<HitRecord> Hit(const Ray& ray, Float tmin,
                                        Float tmax) const = 0;
+  // Bounds every point that `Hit` may return.
+  virtual Aabb BoundingBox() const = 0;
+
+  // The fraction of light along `ray` that gets through between `tmin` and
+  // `tmax`, for shadow rays. Media estimate it, surfaces block everything.
+  virtual Float Transmittance(const Ray& ray, Float tmin, Float tmax) const {
+    return Hit(ray, tmin, tmax).has_value() ? 0 : 1;
+  }
+
+  // Lights, sampled by next-event estimation, implement the following.
+  virtual Float Area() const { return 0; }
+  // A direction from `origin` towards a point of the object.
+  virtual Vec3 SampleDirection(const Point3& origin,
+                               const Sample2D& sample) const {
+    return Vec3{1, 0, 0};
+  }
+  // The solid angle density of `SampleDirection` picking `direction`.
+  virtual Float PdfValue(const Point3& origin, const Vec3& direction) const {
+    return 0;
+  }
 };
 
 #endif  // PEWPEW_HITTABLE_H_
\ No newline at end of file
@@ -20,4 +20,16 @@ std::optional<HitRecord> HittableList::Hit(const Ray& ray, Float tmin,
   }
 
   return record;
+}
+
+Float HittableList::Transmittance(const Ray& ray, Float tmin,
+                                  Float tmax) const {
+  Float transmittance = 1;
+  for (const auto& object : objects_) {
+    transmittance *= object->Transmittance(ray, tmin, tmax);
+    if (transmittance == 0) {
+      break;
+    }
+  }
+  return transmittance;
 }
\ No newline at end of file
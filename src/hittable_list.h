@@ -5,19 +5,30 @@
 #include <optional>
 #include <vector>
 
+#include "aabb.h"
 #include "float.h"
 #include "hittable.h"
 #include "ray.h"
 
 class HittableList : public Hittable {
  public:
-  void Add(std::shared_ptr<Hittable> object) { objects_.push_back(object); }
+  void Add(std::shared_ptr<Hittable> object) {
+    bounding_box_ = Aabb{bounding_box_, object->BoundingBox()};
+    objects_.push_back(object);
+  }
+
+  const std::vector<std::shared_ptr<Hittable>>& objects() const {
+    return objects_;
+  }
 
   std::optional<HitRecord> Hit(const Ray& ray, Float tmin,
                                Float tmax) const override;
+  Aabb BoundingBox() const override { return bounding_box_; }
+  Float Transmittance(const Ray& ray, Float tmin, Float tmax) const override;
 
  private:
   std::vector<std::shared_ptr<Hittable>> objects_;
+  Aabb bounding_box_;
 };
 
 #endif  // PEWPEW_HITTABLE_LIST_H_
\ No newline at end of file
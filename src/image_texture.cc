@@ -0,0 +1,324 @@
+#include "image_texture.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "color.h"
+#include "float.h"
+#include "texture_cache.h"
+#include "vec3.h"
+
+namespace {
+
+using Level = ImageTexture::Level;
+
+// Interleaves the bits of the coordinates within a tile.
+uint32_t MortonIndex(uint32_t x, uint32_t y) {
+  auto spread = [](uint32_t value) {
+    value = (value | (value << 8)) & 0x00ff00ff;
+    value = (value | (value << 4)) & 0x0f0f0f0f;
+    value = (value | (value << 2)) & 0x33333333;
+    return (value | (value << 1)) & 0x55555555;
+  };
+  return spread(x) | (spread(y) << 1);
+}
+
+const std::array<float, 256>& SrgbToLinearTable() {
+  static const std::array<float, 256> table = [] {
+    std::array<float, 256> table;
+    for (int i = 0; i < 256; i++) {
+      const double x = i / 255.0;
+      table[i] = x <= 0.04045 ? x / 12.92 : std::pow((x + 0.055) / 1.055, 2.4);
+    }
+    return table;
+  }();
+  return table;
+}
+
+uint8_t LinearToSrgb8(double x) {
+  x = std::clamp(x, 0.0, 1.0);
+  x = x <= 0.0031308 ? 12.92 * x : 1.055 * std::pow(x, 1 / 2.4) - 0.055;
+  return static_cast<uint8_t>(255 * x + 0.5);
+}
+
+uint32_t PackTexel(uint8_t r, uint8_t g, uint8_t b) {
+  return r | (g << 8) | (b << 16);
+}
+
+// Skips whitespace and comments, then reads a number.
+bool ReadPpmNumber(std::istream& stream, int* value) {
+  while (true) {
+    const int c = stream.peek();
+    if (c == '#') {
+      std::string comment;
+      std::getline(stream, comment);
+    } else if (std::isspace(c)) {
+      stream.get();
+    } else {
+      break;
+    }
+  }
+  return static_cast<bool>(stream >> *value);
+}
+
+// Bands are rows of tiles, stored as `level.width` by `kTextureTileSize`
+// texels in row-major order.
+bool WriteBand(int fd, const Level& level, int band,
+               const std::vector<uint32_t>& texels) {
+  TextureTile tile;
+  for (int tile_x = 0; tile_x < level.num_tiles_x; tile_x++) {
+    tile.fill(0);
+    for (int y = 0; y < kTextureTileSize; y++) {
+      for (int x = 0; x < kTextureTileSize; x++) {
+        const int image_x = tile_x * kTextureTileSize + x;
+        if (image_x < level.width) {
+          tile[MortonIndex(x, y)] = texels[y * level.width + image_x];
+        }
+      }
+    }
+
+    const uint64_t index =
+        level.first_tile + band * level.num_tiles_x + tile_x;
+    if (pwrite(fd, tile.data(), sizeof(tile), index * sizeof(tile)) !=
+        sizeof(tile)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ReadBand(int fd, const Level& level, int band,
+              std::vector<uint32_t>* texels) {
+  texels->resize(level.width * kTextureTileSize);
+  TextureTile tile;
+  for (int tile_x = 0; tile_x < level.num_tiles_x; tile_x++) {
+    const uint64_t index =
+        level.first_tile + band * level.num_tiles_x + tile_x;
+    if (pread(fd, tile.data(), sizeof(tile), index * sizeof(tile)) !=
+        sizeof(tile)) {
+      return false;
+    }
+
+    for (int y = 0; y < kTextureTileSize; y++) {
+      for (int x = 0; x < kTextureTileSize; x++) {
+        const int image_x = tile_x * kTextureTileSize + x;
+        if (image_x < level.width) {
+          (*texels)[y * level.width + image_x] = tile[MortonIndex(x, y)];
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Averages 2x2 texels of `source` in linear space, into band `band` of
+// `destination`.
+bool Downsample(int fd, const Level& source, const Level& destination,
+                int band, std::vector<uint32_t>* top,
+                std::vector<uint32_t>* bottom) {
+  if (!ReadBand(fd, source, 2 * band, top)) {
+    return false;
+  }
+  if (2 * band + 1 < source.num_tiles_y &&
+      !ReadBand(fd, source, 2 * band + 1, bottom)) {
+    return false;
+  }
+
+  const std::array<float, 256>& to_linear = SrgbToLinearTable();
+  auto source_texel = [&](int x, int y) {
+    x = std::min(x, source.width - 1);
+    y = std::min(y, source.height - 1);
+    const int band_y = y % kTextureTileSize;
+    const std::vector<uint32_t>& texels =
+        y / kTextureTileSize == 2 * band ? *top : *bottom;
+    return texels[band_y * source.width + x];
+  };
+
+  std::vector<uint32_t> texels(destination.width * kTextureTileSize, 0);
+  const int band_height = std::min(
+      kTextureTileSize, destination.height - band * kTextureTileSize);
+  for (int y = 0; y < band_height; y++) {
+    const int source_y = 2 * (band * kTextureTileSize + y);
+    for (int x = 0; x < destination.width; x++) {
+      const uint32_t corners[4] = {
+          source_texel(2 * x, source_y),
+          source_texel(2 * x + 1, source_y),
+          source_texel(2 * x, source_y + 1),
+          source_texel(2 * x + 1, source_y + 1),
+      };
+      uint8_t channels[3];
+      for (int k = 0; k < 3; k++) {
+        double sum = 0;
+        for (uint32_t corner : corners) {
+          sum += to_linear[(corner >> (8 * k)) & 0xff];
+        }
+        channels[k] = LinearToSrgb8(sum / 4);
+      }
+      texels[y * destination.width + x] =
+          PackTexel(channels[0], channels[1], channels[2]);
+    }
+  }
+
+  return WriteBand(fd, destination, band, texels);
+}
+
+int CreateTemporaryFile() {
+  const char* directory = std::getenv("TMPDIR");
+  std::string path = std::string{directory != nullptr ? directory : "/tmp"} +
+                     "/pewpew-texture-XXXXXX";
+  const int fd = mkstemp(path.data());
+  if (fd >= 0) {
+    // The file lives as long as its descriptor.
+    unlink(path.c_str());
+  }
+  return fd;
+}
+
+}  // namespace
+
+std::unique_ptr<ImageTexture> ImageTexture::Load(const std::string& path,
+                                                 TextureCache* cache) {
+  std::ifstream file{path, std::ios::binary};
+  std::string magic;
+  int width;
+  int height;
+  int max_value;
+  if (!file || !(file >> magic) || magic != "P6" ||
+      !ReadPpmNumber(file, &width) || !ReadPpmNumber(file, &height) ||
+      !ReadPpmNumber(file, &max_value) || width <= 0 || height <= 0 ||
+      max_value != 255) {
+    std::cerr << path << " is not a binary PPM with 8-bit channels"
+              << std::endl;
+    return nullptr;
+  }
+  // A single whitespace character separates the header from the pixels.
+  file.get();
+
+  std::vector<Level> levels;
+  uint64_t num_tiles = 0;
+  for (int level_width = width, level_height = height;;
+       level_width = std::max(1, (level_width + 1) / 2),
+           level_height = std::max(1, (level_height + 1) / 2)) {
+    const Level level{
+        .width = level_width,
+        .height = level_height,
+        .num_tiles_x = (level_width + kTextureTileSize - 1) / kTextureTileSize,
+        .num_tiles_y =
+            (level_height + kTextureTileSize - 1) / kTextureTileSize,
+        .first_tile = num_tiles,
+    };
+    levels.push_back(level);
+    num_tiles += static_cast<uint64_t>(level.num_tiles_x) * level.num_tiles_y;
+    if (level_width == 1 && level_height == 1) {
+      break;
+    }
+  }
+
+  const int fd = CreateTemporaryFile();
+  if (fd < 0) {
+    std::cerr << "Error creating a texture file for " << path << std::endl;
+    return nullptr;
+  }
+  const int file_id = cache->AddFile(fd);
+
+  const Level& base = levels[0];
+  std::vector<uint8_t> row(3 * width);
+  std::vector<uint32_t> texels(base.width * kTextureTileSize);
+  for (int band = 0; band < base.num_tiles_y; band++) {
+    std::fill(texels.begin(), texels.end(), 0);
+    for (int y = 0; y < kTextureTileSize; y++) {
+      if (band * kTextureTileSize + y >= height) {
+        break;
+      }
+      file.read(reinterpret_cast<char*>(row.data()), row.size());
+      for (int x = 0; x < width; x++) {
+        texels[y * width + x] =
+            PackTexel(row[3 * x], row[3 * x + 1], row[3 * x + 2]);
+      }
+    }
+
+    if (!file || !WriteBand(fd, base, band, texels)) {
+      std::cerr << "Error decoding " << path << std::endl;
+      return nullptr;
+    }
+  }
+
+  std::vector<uint32_t> top;
+  std::vector<uint32_t> bottom;
+  for (size_t level = 1; level < levels.size(); level++) {
+    for (int band = 0; band < levels[level].num_tiles_y; band++) {
+      if (!Downsample(fd, levels[level - 1], levels[level], band, &top,
+                      &bottom)) {
+        std::cerr << "Error building the mip levels of " << path
+                  << std::endl;
+        return nullptr;
+      }
+    }
+  }
+
+  return std::unique_ptr<ImageTexture>(
+      new ImageTexture(cache, file_id, std::move(levels)));
+}
+
+Color ImageTexture::Value(Float u, Float v, const Point3& p,
+                          Float footprint) const {
+  const Float s = u - std::floor(u);
+  // Rows go from top to bottom.
+  const Float t = 1 - std::clamp<Float>(v, 0, 1);
+
+  // The level where the footprint covers about one texel.
+  const int num_levels = levels_.size();
+  const Float lod = std::clamp<Float>(
+      std::log2(std::max<Float>(footprint * levels_[0].width, 1)), 0,
+      num_levels - 1);
+  const int level = static_cast<int>(lod);
+  const Float weight = lod - level;
+
+  const Color color = Bilinear(level, s, t);
+  if (weight == 0 || level + 1 >= num_levels) {
+    return color;
+  }
+  return (1 - weight) * color + weight * Bilinear(level + 1, s, t);
+}
+
+Color ImageTexture::Bilinear(int level_index, Float s, Float t) const {
+  const Level& level = levels_[level_index];
+  const Float x = s * level.width - static_cast<Float>(0.5);
+  const Float y = t * level.height - static_cast<Float>(0.5);
+  const int x0 = static_cast<int>(std::floor(x));
+  const int y0 = static_cast<int>(std::floor(y));
+  const Float fx = x - x0;
+  const Float fy = y - y0;
+
+  return (1 - fy) * ((1 - fx) * Texel(level, x0, y0) +
+                     fx * Texel(level, x0 + 1, y0)) +
+         fy * ((1 - fx) * Texel(level, x0, y0 + 1) +
+               fx * Texel(level, x0 + 1, y0 + 1));
+}
+
+Color ImageTexture::Texel(const Level& level, int x, int y) const {
+  x = ((x % level.width) + level.width) % level.width;
+  y = std::clamp(y, 0, level.height - 1);
+
+  const int tile_x = x >> kTextureTileSizeLog2;
+  const int tile_y = y >> kTextureTileSizeLog2;
+  const std::shared_ptr<const TextureTile> tile = cache_->GetTile(
+      file_id_, level.first_tile + tile_y * level.num_tiles_x + tile_x);
+  const uint32_t texel = (*tile)[MortonIndex(x & (kTextureTileSize - 1),
+                                             y & (kTextureTileSize - 1))];
+
+  const std::array<float, 256>& to_linear = SrgbToLinearTable();
+  return Color{to_linear[texel & 0xff], to_linear[(texel >> 8) & 0xff],
+               to_linear[(texel >> 16) & 0xff]};
+}
\ No newline at end of file
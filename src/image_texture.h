@@ -0,0 +1,52 @@
+#ifndef PEWPEW_IMAGE_TEXTURE_H_
+#define PEWPEW_IMAGE_TEXTURE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "color.h"
+#include "float.h"
+#include "texture.h"
+#include "texture_cache.h"
+#include "vec3.h"
+
+// An image mapped over [0, 1]^2, wrapping horizontally and clamped
+// vertically, as suits longitude-latitude maps. Images are decoded once into
+// a mip pyramid of 32x32 tiles, in Morton order within each tile, stored in a
+// temporary file and paged in through a `TextureCache`. Lookups are
+// trilinear, with the level chosen from the ray cone footprint.
+class ImageTexture : public Texture {
+ public:
+  // Decodes a binary PPM one band of tiles at a time, so that images larger
+  // than memory can be loaded. Returns null on errors.
+  static std::unique_ptr<ImageTexture> Load(const std::string& path,
+                                            TextureCache* cache);
+
+  Color Value(Float u, Float v, const Point3& p,
+              Float footprint) const override;
+
+  struct Level {
+    int width;
+    int height;
+    int num_tiles_x;
+    int num_tiles_y;
+    // Index of the first tile of the level in the file.
+    uint64_t first_tile;
+  };
+
+ private:
+  ImageTexture(TextureCache* cache, int file_id, std::vector<Level> levels)
+      : cache_(cache), file_id_(file_id), levels_(std::move(levels)) {}
+
+  Color Bilinear(int level, Float s, Float t) const;
+  Color Texel(const Level& level, int x, int y) const;
+
+  TextureCache* cache_;
+  int file_id_;
+  std::vector<Level> levels_;
+};
+
+#endif  // PEWPEW_IMAGE_TEXTURE_H_
\ No newline at end of file
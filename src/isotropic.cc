@@ -0,0 +1,30 @@
+#include "isotropic.h"
+
+#include <numbers>
+#include <optional>
+
+#include "color.h"
+#include "float.h"
+#include "hittable.h"
+#include "material.h"
+#include "ray.h"
+#include "sampler.h"
+#include "vec3.h"
+
+std::optional<ScatterRecord> Isotropic::Scatter(const Ray& ray,
+                                                const HitRecord& record,
+                                                Sampler* sampler) const {
+  const Sample2D sample = sampler->Get2D();
+  const Ray scattered{record.p(), SampleUnitVector(sample.u, sample.v)};
+  return ScatterRecord{albedo_, scattered};
+}
+
+Color Isotropic::Evaluate(const Ray& ray, const HitRecord& record,
+                          const Vec3& direction) const {
+  return albedo_ / (4 * std::numbers::pi_v<Float>);
+}
+
+Float Isotropic::ScatterPdf(const Ray& ray, const HitRecord& record,
+                            const Vec3& direction) const {
+  return 1 / (4 * std::numbers::pi_v<Float>);
+}
\ No newline at end of file
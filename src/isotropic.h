@@ -0,0 +1,31 @@
+#ifndef PEWPEW_ISOTROPIC_H_
+#define PEWPEW_ISOTROPIC_H_
+
+#include <optional>
+
+#include "color.h"
+#include "hittable.h"
+#include "material.h"
+#include "ray.h"
+#include "sampler.h"
+#include "vec3.h"
+
+// The phase function of media that scatter equally in all directions.
+class Isotropic : public Material {
+ public:
+  Isotropic(const Color& albedo) : albedo_(albedo) {}
+
+  std::optional<ScatterRecord> Scatter(const Ray& ray, const HitRecord& record,
+                                       Sampler* sampler) const override;
+
+  bool IsDiffuse() const override { return true; }
+  Color Evaluate(const Ray& ray, const HitRecord& record,
+                 const Vec3& direction) const override;
+  Float ScatterPdf(const Ray& ray, const HitRecord& record,
+                   const Vec3& direction) const override;
+
+ private:
+  Color albedo_;
+};
+
+#endif  // PEWPEW_ISOTROPIC_H_
\ No newline at end of file
@@ -1,19 +1,48 @@
 #include "lambertian.h"
 
+#include <numbers>
 #include <optional>
 
+#include "color.h"
+#include "float.h"
 #include "hittable.h"
 #include "material.h"
 #include "ray.h"
+#include "sampler.h"
+#include "texture.h"
 #include "vec3.h"
 
-std::optional<ScatterRecord> Lambertian::Scatter(
-    const Ray& ray, const HitRecord& record) const {
-  Vec3 scatter_direction = record.normal() + RandomUnitVector();
+std::optional<ScatterRecord> Lambertian::Scatter(const Ray& ray,
+                                                 const HitRecord& record,
+                                                 Sampler* sampler) const {
+  const Sample2D sample = sampler->Get2D();
+  Vec3 scatter_direction =
+      record.normal() + SampleUnitVector(sample.u, sample.v);
   if (scatter_direction.near_zero()) {
     scatter_direction = record.normal();
   }
 
   const Ray scattered{record.p(), scatter_direction};
-  return ScatterRecord{albedo_, scattered};
+  return ScatterRecord{Albedo(record), scattered};
+}
+
+Color Lambertian::Evaluate(const Ray& ray, const HitRecord& record,
+                           const Vec3& direction) const {
+  const Float cosine = Dot(record.normal(), UnitVector(direction));
+  if (cosine <= 0) {
+    return Color{0, 0, 0};
+  }
+  return Albedo(record) * (cosine / std::numbers::pi_v<Float>);
+}
+
+Float Lambertian::ScatterPdf(const Ray& ray, const HitRecord& record,
+                             const Vec3& direction) const {
+  const Float cosine = Dot(record.normal(), UnitVector(direction));
+  return cosine <= 0 ? 0 : cosine / std::numbers::pi_v<Float>;
+}
+
+Color Lambertian::Albedo(const HitRecord& record) const {
+  return texture_ != nullptr ? texture_->Value(record.u(), record.v(),
+                                               record.p(), record.footprint())
+                             : albedo_;
 }
\ No newline at end of file
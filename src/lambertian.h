@@ -7,16 +7,30 @@
 #include "hittable.h"
 #include "material.h"
 #include "ray.h"
+#include "sampler.h"
+#include "texture.h"
+#include "vec3.h"
 
 class Lambertian : public Material {
  public:
   Lambertian(const Color& albedo) : albedo_(albedo) {}
+  // The texture is owned by the scene.
+  Lambertian(const Texture* texture) : texture_(texture) {}
 
-  std::optional<ScatterRecord> Scatter(const Ray& ray,
-                                       const HitRecord& record) const override;
+  std::optional<ScatterRecord> Scatter(const Ray& ray, const HitRecord& record,
+                                       Sampler* sampler) const override;
+
+  bool IsDiffuse() const override { return true; }
+  Color Evaluate(const Ray& ray, const HitRecord& record,
+                 const Vec3& direction) const override;
+  Float ScatterPdf(const Ray& ray, const HitRecord& record,
+                   const Vec3& direction) const override;
 
  private:
+  Color Albedo(const HitRecord& record) const;
+
   Color albedo_;
+  const Texture* texture_ = nullptr;
 };
 
 #endif  // PEWPEW_LAMBERTIAN_H_
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include "light_list.h"
+
+#include <memory>
+
+#include "alias_table.h"
+#include "color.h"
+#include "float.h"
+#include "hittable.h"
+
+void LightList::Add(std::shared_ptr<Hittable> light, const Color& emission) {
+  // Luminance, times the area, is proportional to the emitted power.
+  powers_.push_back(Luminance(emission) * light->Area());
+  lights_.push_back(light);
+}
+
+void LightList::Build() {
+  if (!lights_.empty()) {
+    table_ = AliasTable{powers_};
+  }
+}
+
+const Hittable& LightList::Sample(Float u, Float* probability) const {
+  const int index = table_.Sample(u);
+  *probability = table_.probability(index);
+  return *lights_[index];
+}
\ No newline at end of file
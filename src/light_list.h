@@ -0,0 +1,44 @@
+#ifndef PEWPEW_LIGHT_LIST_H_
+#define PEWPEW_LIGHT_LIST_H_
+
+#include <memory>
+#include <vector>
+
+#include "alias_table.h"
+#include "color.h"
+#include "environment_map.h"
+#include "float.h"
+#include "hittable.h"
+
+// The emissive objects of a scene, also added to its `HittableList`, for
+// next-event estimation. Lights are picked in proportion to their estimated
+// power, so that the many dim lights of a scene don't take samples from the
+// few that light most of it.
+class LightList {
+ public:
+  // `emission` is the radiance of the light's material.
+  void Add(std::shared_ptr<Hittable> light, const Color& emission);
+  // Builds the sampling table, once all the lights are added.
+  void Build();
+
+  // Whether there are no lights besides the environment.
+  bool empty() const { return lights_.empty(); }
+
+  // Lights the scene from infinitely far away, owned by the scene.
+  void set_environment(const EnvironmentMap* environment) {
+    environment_ = environment;
+  }
+  const EnvironmentMap* environment() const { return environment_; }
+
+  // Picks a light from `u` in [0, 1), and sets `*probability` to the
+  // probability of picking it.
+  const Hittable& Sample(Float u, Float* probability) const;
+
+ private:
+  std::vector<std::shared_ptr<Hittable>> lights_;
+  std::vector<Float> powers_;
+  AliasTable table_;
+  const EnvironmentMap* environment_ = nullptr;
+};
+
+#endif  // PEWPEW_LIGHT_LIST_H_
\ No newline at end of file
@@ -1,83 +1,207 @@
 #include <SDL2/SDL.h>
 
-#include <memory>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "app.h"
+#include "app_settings.h"
 #include "camera.h"
-#include "color.h"
-#include "dielectric.h"
-#include "hittable_list.h"
-#include "lambertian.h"
-#include "material.h"
-#include "metal.h"
-#include "sphere.h"
-#include "vec3.h"
+#include "checkpoint.h"
+#include "distributed.h"
+#include "hittable.h"
+#include "numa.h"
+#include "options.h"
+#include "render_server.h"
+#include "render_service.h"
+#include "replay.h"
+#include "scene.h"
+#include "tiled_framebuffer.h"
 
-int main(int argc, char** argv) {
-  HittableList world;
-  Lambertian ground_material{Color{0.5, 0.5, 0.5}};
-  world.Add(
-      std::make_shared<Sphere>(Point3{0, -1000, 0}, 1000, &ground_material));
-
-  std::vector<std::unique_ptr<Material>> materials;
-  for (int a = -11; a < 11; a++) {
-    for (int b = -11; b < 11; b++) {
-      Float choose_mat = RandomFloat();
-      Float center_x = a + 0.9 * RandomFloat();
-      Float center_z = b + 0.9 * RandomFloat();
-      Point3 center{center_x, 0.2, center_z};
-
-      if ((center - Point3{4, 0.2, 0}).length() > 0.9) {
-        if (choose_mat < 0.8) {
-          // Diffuse.
-          Color albedo = Color::Random() * Color::Random();
-          materials.push_back(std::make_unique<Lambertian>(albedo));
-          world.Add(
-              std::make_shared<Sphere>(center, 0.2, materials.back().get()));
-        } else if (choose_mat < 0.95) {
-          // Metal.
-          Color albedo = Color::Random(0.5, 1);
-          Float fuzz = RandomFloat(0, 0.5);
-          materials.push_back(std::make_unique<Metal>(albedo, fuzz));
-          world.Add(
-              std::make_shared<Sphere>(center, 0.2, materials.back().get()));
-        } else {
-          // Glass.
-          materials.push_back(std::make_unique<Dielectric>(1.5));
-          world.Add(
-              std::make_shared<Sphere>(center, 0.2, materials.back().get()));
+namespace {
+
+bool RenderHeadless(Camera* camera, const Hittable& world,
+                    const Options& options) {
+  camera->Initialize(SettingsUpdateType::kUpdateTextureAndSettings);
+
+  if (options.resume) {
+    Checkpoint checkpoint;
+    if (!ReadCheckpoint(options.checkpoint_path, &checkpoint) ||
+        !camera->RestoreCheckpoint(checkpoint)) {
+      return false;
+    }
+    std::cerr << "Resuming at " << camera->accumulated_samples_per_pixel()
+              << "/" << camera->target_samples_per_pixel()
+              << " samples per pixel" << std::endl;
+  }
+
+  std::optional<CheckpointWriter> checkpoint_writer;
+  if (!options.checkpoint_path.empty()) {
+    checkpoint_writer.emplace(options.checkpoint_path,
+                              options.compress_checkpoints);
+  }
+
+  const std::chrono::seconds checkpoint_interval{options.checkpoint_interval};
+  std::chrono::time_point last_checkpoint_time =
+      std::chrono::steady_clock::now();
+  RenderService render_service{camera};
+  std::future<bool> done = render_service.Submit(
+      RenderJob{
+          .world = &world,
+          .settings = camera->settings(),
+          .update_type = SettingsUpdateType::kNoUpdates,
+      },
+      [&](const PhaseEvent& event) {
+        const std::chrono::time_point now = std::chrono::steady_clock::now();
+        if (checkpoint_writer.has_value() && !event.is_done &&
+            now - last_checkpoint_time >= checkpoint_interval) {
+          checkpoint_writer->Submit(camera->MakeCheckpoint());
+          last_checkpoint_time = now;
         }
-      }
+      });
+  done.wait();
+
+  return camera->WriteImage(options.output_path);
+}
+
+// Renders one tile at a time to completion and stores it in a memory-mapped
+// framebuffer, so that only the tile being rendered is kept in memory.
+bool RenderHeadlessTiled(Camera* camera, const Hittable& world,
+                         const Options& options) {
+  const CameraSettings& settings = camera->settings();
+  camera->InitializeViewport();
+
+  TiledFramebuffer framebuffer{settings.image_width, settings.image_height,
+                               options.tile_size,
+                               options.half_float_framebuffer};
+  if (!framebuffer.Open(options.framebuffer_path)) {
+    return false;
+  }
+
+  const int samples_per_pixel = 1 << settings.samples_per_pixel_log2;
+  std::vector<AccumulationFloat> tile_data;
+  std::vector<Float> colors;
+  for (int index = 0; index < framebuffer.num_tiles(); index++) {
+    camera->RenderTile(framebuffer.tile(index), /*sample_begin=*/0,
+                       samples_per_pixel, world, &tile_data);
+    colors.resize(tile_data.size());
+    for (size_t k = 0; k < tile_data.size(); k++) {
+      colors[k] = tile_data[k] / samples_per_pixel;
     }
+    framebuffer.StoreTile(index, colors);
+  }
+
+  return framebuffer.WriteImage(options.output_path,
+                               Tonemapper{options.tonemap});
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    return 1;
   }
 
-  Dielectric material1{1.5};
-  world.Add(std::make_shared<Sphere>(Point3{0, 1, 0}, 1.0, &material1));
+  if (options.numa) {
+    EnableNumaPlacement();
+  }
 
-  Lambertian material2{Color{0.4, 0.2, 0.1}};
-  world.Add(std::make_shared<Sphere>(Point3{-4, 1, 0}, 1.0, &material2));
+  // Servers build the scenes of their jobs, and clients none.
+  if (options.mode == RunMode::kServer) {
+    RenderServer server{options.address};
+    return server.Run() ? 0 : 1;
+  }
+  if (options.mode == RunMode::kSubmit) {
+    std::vector<std::string> flags;
+    for (int i = 1; i < argc; i++) {
+      if (!std::string_view{argv[i]}.starts_with("--submit=")) {
+        flags.push_back(argv[i]);
+      }
+    }
+    return SubmitRenderJob(options, std::move(flags)) ? 0 : 1;
+  }
+
+  Scene scene;
+  if (!BuildScene(options.scene, &scene)) {
+    return 1;
+  }
+  const Hittable* world = &SceneRoot(scene);
 
-  Metal material3{Color{0.7, 0.6, 0.5}, 0.0};
-  world.Add(std::make_shared<Sphere>(Point3{4, 1, 0}, 1.0, &material3));
+  // The scene is read by every thread on every bounce, so each node gets its
+  // own copy, built by a thread of that node so that it's allocated there.
+  std::vector<Scene> node_scenes;
+  std::optional<NumaReplicatedHittable> replicated_world;
+  if (options.replicate_scene_per_numa_node && NumNumaNodes() > 1) {
+    node_scenes.resize(NumNumaNodes());
+    std::vector<const Hittable*> replicas;
+    for (int node = 0; node < NumNumaNodes(); node++) {
+      RunOnNumaNode(node, [&options, &node_scenes, node] {
+        BuildScene(options.scene, &node_scenes[node]);
+      });
+      replicas.push_back(&SceneRoot(node_scenes[node]));
+    }
+    replicated_world.emplace(std::move(replicas));
+    world = &replicated_world.value();
+  }
 
-  AppSettings settings{
-      .window_width = 1280,
-      .window_height = 720,
+  const AppSettings settings = ToAppSettings(options, scene.view);
 
-      .enable_rendering = true,
+  bool success = true;
+  switch (options.mode) {
+    case RunMode::kGui: {
+      std::optional<Replay> replay;
+      if (!options.replay_path.empty()) {
+        std::vector<ReplayEdit> edits;
+        if (!ReadReplayScript(options.replay_path, &edits)) {
+          return 1;
+        }
+        replay.emplace(std::move(edits), options.replay_samples_per_pixel);
+      }
 
-      .image_scale_factor = 0.5f,
-      .samples_per_pixel_log2 = 0,
-      .max_depth_log2 = 3,
-      .fov = 20.0f,
-      .look_from = {13.0f, 2.0f, 3.0f},
-      .look_at = {0.0f, 0.0f, 0.0f},
-      .view_up = {0.0f, 1.0f, 0.0f},
-      .defocus_angle = 0.6f,
-      .focus_distance = 10.0f,
-  };
-  App app{settings, world};
-  app.Run();
+      App app{settings, *world, &scene.lights};
+      if (replay.has_value()) {
+        app.set_replay(&replay.value());
+      }
+      app.Run();
+      if (replay.has_value()) {
+        replay->PrintReport();
+      }
+      break;
+    }
+    case RunMode::kHeadless: {
+      Camera camera{ToCameraSettings(settings)};
+      camera.set_tonemap_settings(options.tonemap);
+      camera.set_lights(&scene.lights);
+      success = options.framebuffer_path.empty()
+                    ? RenderHeadless(&camera, *world, options)
+                    : RenderHeadlessTiled(&camera, *world, options);
+      break;
+    }
+    case RunMode::kCoordinator: {
+      Camera camera{ToCameraSettings(settings)};
+      camera.set_tonemap_settings(options.tonemap);
+      camera.set_lights(&scene.lights);
+      Coordinator coordinator{options.address, options.executable,
+                              SceneFlags(options.scene),
+                              options.num_local_workers, options.tile_size,
+                              options.worker_timeout};
+      success = coordinator.Render(&camera, *world) &&
+                camera.WriteImage(options.output_path);
+      break;
+    }
+    case RunMode::kWorker:
+      success = RunWorker(options.address, *world, &scene.lights);
+      break;
+    case RunMode::kServer:
+    case RunMode::kSubmit:
+      break;
+  }
 
-  return 0;
+  return success ? 0 : 1;
 }
\ No newline at end of file
@@ -4,8 +4,11 @@
 #include <optional>
 
 #include "color.h"
+#include "float.h"
 #include "hittable.h"
 #include "ray.h"
+#include "sampler.h"
+#include "vec3.h"
 
 class HitRecord;
 
@@ -27,7 +30,27 @@ class Material {
   virtual ~Material() = default;
 
   virtual std::optional<ScatterRecord> Scatter(
-      const Ray& ray, const HitRecord& record) const = 0;
+      const Ray& ray, const HitRecord& record, Sampler* sampler) const = 0;
+
+  // The radiance emitted at the hit towards the origin of `ray`.
+  virtual Color Emitted(const Ray& ray, const HitRecord& record) const {
+    return Color{0, 0, 0};
+  }
+
+  // Diffuse materials scatter light over a range of directions, hence can
+  // sample lights directly, and implement `Evaluate`.
+  virtual bool IsDiffuse() const { return false; }
+  // The scattering function towards `direction`, times the cosine, per unit
+  // solid angle.
+  virtual Color Evaluate(const Ray& ray, const HitRecord& record,
+                         const Vec3& direction) const {
+    return Color{0, 0, 0};
+  }
+  // The solid angle density of `Scatter` picking `direction`.
+  virtual Float ScatterPdf(const Ray& ray, const HitRecord& record,
+                           const Vec3& direction) const {
+    return 0;
+  }
 };
 
 #endif  // PEWPEW_MATERIAL_H_
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef PEWPEW_MEDIUM_H_
+#define PEWPEW_MEDIUM_H_
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#include "float.h"
+#include "pcg_random.hpp"
+#include "ray.h"
+#include "utils.h"
+
+// Media sample free-flight distances in `Hittable::Hit`, which has no
+// sampler, from a generator seeded by the ray: each ray starts from its own
+// path vertex, which keeps renders deterministic across threads and
+// processes. Hashing where the ray enters the medium decorrelates the media
+// a ray crosses.
+inline pcg32 MediumRandomGenerator(const Ray& ray, Float entry_t) {
+  uint64_t hash = 0;
+  for (Float value : {ray.origin().x(), ray.origin().y(), ray.origin().z(),
+                      ray.direction().x(), ray.direction().y(),
+                      ray.direction().z(), entry_t}) {
+    hash = HashSeed(hash ^ std::bit_cast<uint32_t>(static_cast<float>(value)));
+  }
+  return pcg32{hash, /*stream=*/0};
+}
+
+inline Float MediumRandomFloat(pcg32* rng) {
+  return ((*rng)() >> 8) * 0x1p-24f;
+}
+
+// Samples a distance to the next collision in a medium of extinction
+// `sigma`.
+inline Float SampleFreeFlight(pcg32* rng, Float sigma) {
+  return -std::log(1 - MediumRandomFloat(rng)) / sigma;
+}
+
+#endif  // PEWPEW_MEDIUM_H_
\ No newline at end of file
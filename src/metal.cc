@@ -5,13 +5,16 @@
 #include "hittable.h"
 #include "material.h"
 #include "ray.h"
+#include "sampler.h"
 #include "vec3.h"
 
 std::optional<ScatterRecord> Metal::Scatter(const Ray& ray,
-                                            const HitRecord& record) const {
+                                            const HitRecord& record,
+                                            Sampler* sampler) const {
+  const Sample2D sample = sampler->Get2D();
   Vec3 reflection_direction = Reflect(ray.direction(), record.normal());
-  reflection_direction =
-      UnitVector(reflection_direction) + (fuzz_ * RandomUnitVector());
+  reflection_direction = UnitVector(reflection_direction) +
+                         (fuzz_ * SampleUnitVector(sample.u, sample.v));
   if (Dot(reflection_direction, record.normal()) <= 0) {
     return std::nullopt;
   }
@@ -8,13 +8,14 @@
 #include "hittable.h"
 #include "material.h"
 #include "ray.h"
+#include "sampler.h"
 
 class Metal : public Material {
  public:
   Metal(const Color& albedo, Float fuzz) : albedo_(albedo), fuzz_(fuzz) {}
 
-  std::optional<ScatterRecord> Scatter(const Ray& ray,
-                                       const HitRecord& record) const override;
+  std::optional<ScatterRecord> Scatter(const Ray& ray, const HitRecord& record,
+                                       Sampler* sampler) const override;
 
  private:
   Color albedo_;
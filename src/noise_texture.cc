@@ -0,0 +1,60 @@
+#include "noise_texture.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "color.h"
+#include "float.h"
+#include "vec3.h"
+
+Color NoiseTexture::Value(Float u, Float v, const Point3& p,
+                          Float footprint) const {
+  switch (pattern_) {
+    case NoisePattern::kSmooth:
+      return ToColor(noise_.Noise(scale_ * p), p);
+    case NoisePattern::kTurbulence:
+      return ToColor(noise_.Turbulence(scale_ * p, kTurbulenceDepth), p);
+    case NoisePattern::kMarble:
+      return ToColor(noise_.Turbulence(p, kTurbulenceDepth), p);
+  }
+  return Color{0, 0, 0};
+}
+
+void NoiseTexture::Values(const Point3* points, int count,
+                          Color* colors) const {
+  constexpr int kBatchSize = 64;
+  Point3 scaled[kBatchSize];
+  Float noise[kBatchSize];
+  for (int begin = 0; begin < count; begin += kBatchSize) {
+    const int batch_size = std::min(kBatchSize, count - begin);
+    const Point3* batch = points + begin;
+    if (pattern_ != NoisePattern::kMarble) {
+      for (int i = 0; i < batch_size; i++) {
+        scaled[i] = scale_ * batch[i];
+      }
+      batch = scaled;
+    }
+
+    if (pattern_ == NoisePattern::kSmooth) {
+      noise_.Noise(batch, batch_size, noise);
+    } else {
+      noise_.Turbulence(batch, batch_size, kTurbulenceDepth, noise);
+    }
+    for (int i = 0; i < batch_size; i++) {
+      colors[begin + i] = ToColor(noise[i], points[begin + i]);
+    }
+  }
+}
+
+Color NoiseTexture::ToColor(Float noise, const Point3& p) const {
+  switch (pattern_) {
+    case NoisePattern::kSmooth:
+      return Color{0.5, 0.5, 0.5} * (1 + noise);
+    case NoisePattern::kTurbulence:
+      return Color{1, 1, 1} * noise;
+    case NoisePattern::kMarble:
+      return Color{0.5, 0.5, 0.5} *
+             (1 + std::sin(scale_ * p.z() + 10 * noise));
+  }
+  return Color{0, 0, 0};
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef PEWPEW_NOISE_TEXTURE_H_
+#define PEWPEW_NOISE_TEXTURE_H_
+
+#include <cstdint>
+
+#include "color.h"
+#include "float.h"
+#include "perlin.h"
+#include "texture.h"
+#include "vec3.h"
+
+enum class NoisePattern {
+  // Smooth noise, remapped to [0, 1].
+  kSmooth,
+  kTurbulence,
+  // Stripes along z, perturbed by turbulence.
+  kMarble,
+};
+
+// Solid textures made of Perlin noise, from the second book.
+class NoiseTexture : public Texture {
+ public:
+  NoiseTexture(NoisePattern pattern, Float scale, uint64_t seed)
+      : pattern_(pattern), scale_(scale), noise_(seed) {}
+
+  Color Value(Float u, Float v, const Point3& p,
+              Float footprint) const override;
+
+  // `colors[i]` is the texture at `points[i]`, evaluated four points at a
+  // time.
+  void Values(const Point3* points, int count, Color* colors) const;
+
+ private:
+  static constexpr int kTurbulenceDepth = 7;
+
+  Color ToColor(Float noise, const Point3& p) const;
+
+  NoisePattern pattern_;
+  Float scale_;
+  Perlin noise_;
+};
+
+#endif  // PEWPEW_NOISE_TEXTURE_H_
\ No newline at end of file
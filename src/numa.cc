@@ -0,0 +1,167 @@
+#include "numa.h"
+
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct NumaPlacement {
+  bool enabled = false;
+  std::vector<std::vector<int>> node_cpus;
+  // Indexed by OpenMP thread number.
+  std::vector<int> thread_cpus;
+  std::vector<int> thread_nodes;
+};
+
+NumaPlacement& Placement() {
+  static NumaPlacement placement;
+  return placement;
+}
+
+thread_local int current_node = 0;
+thread_local int pinned_cpu = -1;
+
+// Parses lists such as "0-15,32-47".
+std::vector<int> ParseCpuList(const std::string& list) {
+  std::vector<int> cpus;
+  std::stringstream stream{list};
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    const size_t dash = range.find('-');
+    try {
+      const int first = std::stoi(range.substr(0, dash));
+      const int last = dash == std::string::npos
+                           ? first
+                           : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; cpu++) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception&) {
+      // Blank lines and other malformed ranges are skipped.
+    }
+  }
+  return cpus;
+}
+
+bool PinCurrentThread(const std::vector<int>& cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+}  // namespace
+
+std::vector<std::vector<int>> DiscoverNumaNodes() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+
+  std::vector<std::pair<int, std::vector<int>>> nodes;
+  std::error_code error;
+  for (const std::filesystem::directory_entry& entry :
+       std::filesystem::directory_iterator{"/sys/devices/system/node",
+                                           error}) {
+    const std::string name = entry.path().filename().string();
+    if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+        !std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+      continue;
+    }
+
+    std::ifstream file{entry.path() / "cpulist"};
+    std::string list;
+    std::getline(file, list);
+    std::vector<int> cpus;
+    for (int cpu : ParseCpuList(list)) {
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+    // Memory-only nodes and nodes outside of our affinity have no CPUs.
+    if (!cpus.empty()) {
+      nodes.emplace_back(std::stoi(name.substr(4)), std::move(cpus));
+    }
+  }
+  std::sort(nodes.begin(), nodes.end());
+
+  std::vector<std::vector<int>> node_cpus;
+  for (auto& [node, cpus] : nodes) {
+    node_cpus.push_back(std::move(cpus));
+  }
+
+  if (node_cpus.empty()) {
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+    node_cpus.push_back(std::move(cpus));
+  }
+
+  return node_cpus;
+}
+
+void EnableNumaPlacement() {
+  NumaPlacement& placement = Placement();
+  placement.node_cpus = DiscoverNumaNodes();
+  placement.thread_cpus.clear();
+  placement.thread_nodes.clear();
+  for (size_t node = 0; node < placement.node_cpus.size(); node++) {
+    for (int cpu : placement.node_cpus[node]) {
+      placement.thread_cpus.push_back(cpu);
+      placement.thread_nodes.push_back(node);
+    }
+  }
+  placement.enabled = true;
+}
+
+int NumNumaNodes() {
+  const NumaPlacement& placement = Placement();
+  return placement.enabled ? placement.node_cpus.size() : 1;
+}
+
+void PlaceOpenMpThread() {
+  const NumaPlacement& placement = Placement();
+  if (!placement.enabled) {
+    return;
+  }
+
+  const int thread = omp_get_thread_num();
+  const int index = thread % placement.thread_cpus.size();
+  const int cpu = placement.thread_cpus[index];
+  // The master thread is the one that started the region, e.g. that of the
+  // GUI, which would otherwise stay pinned once the region ends.
+  if (thread != 0 && cpu != pinned_cpu && PinCurrentThread({cpu})) {
+    pinned_cpu = cpu;
+  }
+  current_node = placement.thread_nodes[index];
+}
+
+int CurrentNumaNode() { return current_node; }
+
+void RunOnNumaNode(int node, const std::function<void()>& function) {
+  std::thread thread{[node, &function] {
+    const NumaPlacement& placement = Placement();
+    if (placement.enabled) {
+      PinCurrentThread(placement.node_cpus[node]);
+      current_node = node;
+    }
+    function();
+  }};
+  thread.join();
+}
\ No newline at end of file
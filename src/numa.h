@@ -0,0 +1,87 @@
+#ifndef PEWPEW_NUMA_H_
+#define PEWPEW_NUMA_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "aabb.h"
+#include "float.h"
+#include "hittable.h"
+#include "ray.h"
+
+// The CPUs of each NUMA node this process may run on, read from
+// /sys/devices/system/node. Machines without NUMA information are one node.
+std::vector<std::vector<int>> DiscoverNumaNodes();
+
+// Makes `PlaceOpenMpThread` pin OpenMP threads, filling one node before the
+// next. With a static schedule, each node then gets a contiguous block of
+// rows, and the pages its threads touch first.
+void EnableNumaPlacement();
+int NumNumaNodes();
+
+// Pins the calling OpenMP thread to its CPU, if placement is enabled, except
+// the master thread, which keeps its own affinity but still uses the memory
+// of the first node. Called at the start of every parallel region, since
+// OpenMP thread pools belong to the thread that starts the region, and not
+// every region is started by the same thread.
+void PlaceOpenMpThread();
+// The node of the calling thread, 0 if it wasn't placed.
+int CurrentNumaNode();
+
+// Runs `function` on a thread pinned to `node`, e.g. so that the memory it
+// allocates is local to that node.
+void RunOnNumaNode(int node, const std::function<void()>& function);
+
+// Forwards hits to the replica of the scene on the node of the calling
+// thread.
+class NumaReplicatedHittable : public Hittable {
+ public:
+  explicit NumaReplicatedHittable(std::vector<const Hittable*> replicas)
+      : replicas_(std::move(replicas)) {}
+
+  std::optional<HitRecord> Hit(const Ray& ray, Float tmin,
+                               Float tmax) const override {
+    return replicas_[CurrentNumaNode()]->Hit(ray, tmin, tmax);
+  }
+  // The replicas are the same.
+  Aabb BoundingBox() const override { return replicas_[0]->BoundingBox(); }
+  Float Transmittance(const Ray& ray, Float tmin, Float tmax) const override {
+    return replicas_[CurrentNumaNode()]->Transmittance(ray, tmin, tmax);
+  }
+
+ private:
+  std::vector<const Hittable*> replicas_;
+};
+
+// Leaves new elements uninitialized rather than zeroed, so that large buffers
+// can be first touched, hence placed, by the threads that use them.
+template <typename T>
+class UninitializedAllocator : public std::allocator<T> {
+ public:
+  template <typename U>
+  struct rebind {
+    using other = UninitializedAllocator<U>;
+  };
+
+  UninitializedAllocator() = default;
+  template <typename U>
+  UninitializedAllocator(const UninitializedAllocator<U>&) {}
+
+  template <typename U>
+  void construct(U* pointer) {
+    ::new (static_cast<void*>(pointer)) U;
+  }
+  template <typename U, typename... Args>
+  void construct(U* pointer, Args&&... args) {
+    ::new (static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+  }
+};
+
+template <typename T>
+using UninitializedVector = std::vector<T, UninitializedAllocator<T>>;
+
+#endif  // PEWPEW_NUMA_H_
\ No newline at end of file
@@ -0,0 +1,441 @@
+#include "options.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "app.h"
+#include "sampler.h"
+#include "scene.h"
+#include "tonemap.h"
+
+namespace {
+
+bool ParseNumber(std::string_view value, int* result) {
+  const char* end = value.data() + value.size();
+  auto [pointer, error] = std::from_chars(value.data(), end, *result);
+  return error == std::errc{} && pointer == end;
+}
+
+// Not every standard library ships `std::from_chars` for floats yet.
+bool ParseNumber(std::string_view value, float* result) {
+  const std::string string{value};
+  char* end;
+  *result = std::strtof(string.c_str(), &end);
+  return !string.empty() && *end == '\0';
+}
+
+// `count` comma-separated numbers.
+bool ParseNumbers(std::string_view value, int count, float* numbers) {
+  for (int k = 0; k < count; k++) {
+    const size_t comma = k < count - 1 ? value.find(',') : value.size();
+    if (comma == std::string_view::npos ||
+        !ParseNumber(value.substr(0, comma), &numbers[k])) {
+      return false;
+    }
+    value.remove_prefix(std::min(comma + 1, value.size()));
+  }
+  return true;
+}
+
+// `x,y,width,height`, as fractions of the image.
+bool ParseRegion(std::string_view value, float* region) {
+  return ParseNumbers(value, 4, region) && region[0] >= 0 &&
+         region[1] >= 0 && region[2] > 0 && region[3] > 0 &&
+         region[0] + region[2] <= 1 && region[1] + region[3] <= 1;
+}
+
+bool ParseSamplerType(std::string_view value, SamplerType* result) {
+  if (value == "independent") {
+    *result = SamplerType::kIndependent;
+  } else if (value == "stratified") {
+    *result = SamplerType::kStratified;
+  } else if (value == "sobol") {
+    *result = SamplerType::kSobol;
+  } else if (value == "blue_noise") {
+    *result = SamplerType::kBlueNoise;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseSceneType(std::string_view value, SceneType* result) {
+  if (value == "random_spheres") {
+    *result = SceneType::kRandomSpheres;
+  } else if (value == "earth") {
+    *result = SceneType::kEarth;
+  } else if (value == "perlin_spheres") {
+    *result = SceneType::kPerlinSpheres;
+  } else if (value == "fog") {
+    *result = SceneType::kFog;
+  } else if (value == "cornell_box") {
+    *result = SceneType::kCornellBox;
+  } else if (value == "many_lights") {
+    *result = SceneType::kManyLights;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseBvhType(std::string_view value, BvhType* result) {
+  if (value == "none") {
+    *result = BvhType::kNone;
+  } else if (value == "binary") {
+    *result = BvhType::kBinary;
+  } else if (value == "wide") {
+    *result = BvhType::kWide;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseTonemapOperator(std::string_view value, TonemapOperator* result) {
+  if (value == "clamp") {
+    *result = TonemapOperator::kClamp;
+  } else if (value == "aces") {
+    *result = TonemapOperator::kAces;
+  } else if (value == "filmic") {
+    *result = TonemapOperator::kFilmic;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  *options = Options{
+      .mode = RunMode::kGui,
+      .executable = argv[0],
+      .scene =
+          SceneOptions{
+              .type = SceneType::kRandomSpheres,
+              .bvh = BvhType::kWide,
+              .texture_path = "",
+              .texture_cache_bytes = size_t{256} << 20,
+              .environment_path = "",
+          },
+      .output_path = "image.ppm",
+      .address = "",
+      .checkpoint_path = "",
+      .checkpoint_interval = 60,
+      .compress_checkpoints = false,
+      .resume = false,
+      .num_local_workers = 0,
+      .tile_size = 64,
+      .worker_timeout = 300,
+      .samples_per_pixel_log2 = 0,
+      .image_scale_factor = 0.5f,
+      .fov = std::nullopt,
+      .look_from = std::nullopt,
+      .look_at = std::nullopt,
+      .phase_time_budget_ms = 0.0f,
+      .sampler_type = SamplerType::kSobol,
+      .enable_denoiser = false,
+      .enable_path_guiding = false,
+      .enable_primary_hit_cache = false,
+      .region = {0.0f, 0.0f, 0.0f, 0.0f},
+      .tonemap = TonemapSettings{TonemapOperator::kClamp, 0},
+      .numa = false,
+      .replicate_scene_per_numa_node = false,
+      .framebuffer_path = "",
+      .half_float_framebuffer = false,
+      .priority = 0,
+      .replay_path = "",
+      .replay_samples_per_pixel = 16,
+  };
+
+  for (int i = 1; i < argc; i++) {
+    const std::string_view argument = argv[i];
+    const size_t equal = argument.find('=');
+    const std::string_view name = argument.substr(0, equal);
+    const std::string_view value =
+        equal == std::string_view::npos ? "" : argument.substr(equal + 1);
+
+    bool success = true;
+    if (name == "--headless") {
+      options->mode = RunMode::kHeadless;
+    } else if (name == "--coordinator") {
+      options->mode = RunMode::kCoordinator;
+      options->address = value;
+      success = !value.empty();
+    } else if (name == "--worker") {
+      options->mode = RunMode::kWorker;
+      options->address = value;
+      success = !value.empty();
+    } else if (name == "--server") {
+      options->mode = RunMode::kServer;
+      options->address = value;
+      success = !value.empty();
+    } else if (name == "--submit") {
+      options->mode = RunMode::kSubmit;
+      options->address = value;
+      success = !value.empty();
+    } else if (name == "--priority") {
+      success = ParseNumber(value, &options->priority);
+    } else if (name == "--scene") {
+      success = ParseSceneType(value, &options->scene.type);
+    } else if (name == "--bvh") {
+      success = ParseBvhType(value, &options->scene.bvh);
+    } else if (name == "--texture") {
+      options->scene.texture_path = value;
+      success = !value.empty();
+    } else if (name == "--texture_cache_mb") {
+      int texture_cache_mb;
+      success = ParseNumber(value, &texture_cache_mb) && texture_cache_mb > 0;
+      options->scene.texture_cache_bytes =
+          static_cast<size_t>(texture_cache_mb) << 20;
+    } else if (name == "--environment") {
+      options->scene.environment_path = value;
+      success = !value.empty();
+    } else if (name == "--output") {
+      options->output_path = value;
+      success = !value.empty();
+    } else if (name == "--checkpoint") {
+      options->checkpoint_path = value;
+      success = !value.empty();
+    } else if (name == "--checkpoint_interval") {
+      success = ParseNumber(value, &options->checkpoint_interval) &&
+                options->checkpoint_interval >= 0;
+    } else if (name == "--compress_checkpoints") {
+      options->compress_checkpoints = true;
+    } else if (name == "--resume") {
+      options->resume = true;
+    } else if (name == "--local_workers") {
+      success = ParseNumber(value, &options->num_local_workers) &&
+                options->num_local_workers >= 0;
+    } else if (name == "--tile_size") {
+      success = ParseNumber(value, &options->tile_size) &&
+                options->tile_size > 0;
+    } else if (name == "--worker_timeout") {
+      success = ParseNumber(value, &options->worker_timeout) &&
+                options->worker_timeout >= 0;
+    } else if (name == "--samples_per_pixel_log2") {
+      success = ParseNumber(value, &options->samples_per_pixel_log2) &&
+                options->samples_per_pixel_log2 >= 0 &&
+                options->samples_per_pixel_log2 <= 12;
+    } else if (name == "--image_scale_factor") {
+      success = ParseNumber(value, &options->image_scale_factor) &&
+                options->image_scale_factor > 0;
+    } else if (name == "--fov") {
+      float fov;
+      success = ParseNumber(value, &fov) && fov > 0 && fov < 180;
+      options->fov = fov;
+    } else if (name == "--look_from") {
+      std::array<float, 3> look_from;
+      success = ParseNumbers(value, 3, look_from.data());
+      options->look_from = look_from;
+    } else if (name == "--look_at") {
+      std::array<float, 3> look_at;
+      success = ParseNumbers(value, 3, look_at.data());
+      options->look_at = look_at;
+    } else if (name == "--phase_time_budget_ms") {
+      success = ParseNumber(value, &options->phase_time_budget_ms) &&
+                options->phase_time_budget_ms > 0;
+    } else if (name == "--denoise") {
+      options->enable_denoiser = true;
+    } else if (name == "--path_guiding") {
+      options->enable_path_guiding = true;
+    } else if (name == "--primary_hit_cache") {
+      options->enable_primary_hit_cache = true;
+    } else if (name == "--region") {
+      success = ParseRegion(value, options->region);
+    } else if (name == "--sampler") {
+      success = ParseSamplerType(value, &options->sampler_type);
+    } else if (name == "--tonemap") {
+      success = ParseTonemapOperator(value, &options->tonemap.tonemap_operator);
+    } else if (name == "--exposure") {
+      float exposure;
+      success = ParseNumber(value, &exposure);
+      options->tonemap.exposure = exposure;
+    } else if (name == "--numa") {
+      options->numa = true;
+    } else if (name == "--numa_replicate_scene") {
+      options->numa = true;
+      options->replicate_scene_per_numa_node = true;
+    } else if (name == "--framebuffer") {
+      options->framebuffer_path = value;
+      success = !value.empty();
+    } else if (name == "--half_float_framebuffer") {
+      options->half_float_framebuffer = true;
+    } else if (name == "--replay") {
+      options->replay_path = value;
+      success = !value.empty();
+    } else if (name == "--replay_spp") {
+      success = ParseNumber(value, &options->replay_samples_per_pixel) &&
+                options->replay_samples_per_pixel > 0;
+    } else {
+      std::cerr << "Unknown flag: " << argument << std::endl;
+      return false;
+    }
+
+    if (!success) {
+      std::cerr << "Invalid value for " << name << ": " << value << std::endl;
+      return false;
+    }
+  }
+
+  if (!options->replay_path.empty() && options->mode != RunMode::kGui) {
+    std::cerr << "--replay is only supported by the GUI" << std::endl;
+    return false;
+  }
+
+  if (options->resume && options->checkpoint_path.empty()) {
+    std::cerr << "--resume needs a --checkpoint path" << std::endl;
+    return false;
+  }
+
+  // Checkpoints only hold the accumulated image, and resumed renders must
+  // match uninterrupted ones.
+  if (options->resume && options->enable_path_guiding) {
+    std::cerr << "--resume doesn't support --path_guiding" << std::endl;
+    return false;
+  }
+  if (options->resume && options->enable_primary_hit_cache) {
+    std::cerr << "--resume doesn't support --primary_hit_cache" << std::endl;
+    return false;
+  }
+  if (options->resume && options->enable_denoiser) {
+    std::cerr << "--resume doesn't support --denoise" << std::endl;
+    return false;
+  }
+
+  // Workers only send back accumulations, without the features the denoiser
+  // needs.
+  if (options->mode == RunMode::kCoordinator && options->enable_denoiser) {
+    std::cerr << "--coordinator doesn't support --denoise" << std::endl;
+    return false;
+  }
+
+  // Tiles are rendered to completion one after the other, so there are no
+  // phases to checkpoint nor whole image to denoise.
+  if (!options->framebuffer_path.empty() &&
+      (options->mode != RunMode::kHeadless ||
+       !options->checkpoint_path.empty() || options->enable_denoiser)) {
+    std::cerr << "--framebuffer is only supported by headless renders, "
+              << "without checkpoints or denoising" << std::endl;
+    return false;
+  }
+
+  // The guide and the primary hits are kept over the phases of a single
+  // process.
+  const bool is_progressive = (options->mode == RunMode::kGui ||
+                               options->mode == RunMode::kHeadless ||
+                               options->mode == RunMode::kSubmit) &&
+                              options->framebuffer_path.empty();
+  if (options->enable_path_guiding && !is_progressive) {
+    std::cerr << "--path_guiding is only supported by progressive renders"
+              << std::endl;
+    return false;
+  }
+  if (options->enable_primary_hit_cache && !is_progressive) {
+    std::cerr << "--primary_hit_cache is only supported by progressive renders"
+              << std::endl;
+    return false;
+  }
+  if (options->region[2] > 0 && !is_progressive) {
+    std::cerr << "--region is only supported by progressive renders"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+AppSettings ToAppSettings(const Options& options, const SceneView& view) {
+  AppSettings settings{
+      .window_width = 1280,
+      .window_height = 720,
+
+      .enable_rendering = true,
+
+      .image_scale_factor = options.image_scale_factor,
+      .samples_per_pixel_log2 = options.samples_per_pixel_log2,
+      .max_depth_log2 = 3,
+      .fov = options.fov.value_or(view.fov),
+      .look_from = {view.look_from[0], view.look_from[1], view.look_from[2]},
+      .look_at = {view.look_at[0], view.look_at[1], view.look_at[2]},
+      .view_up = {0.0f, 1.0f, 0.0f},
+      .defocus_angle = view.defocus_angle,
+      .focus_distance = view.focus_distance,
+      .enable_sky = view.enable_sky,
+      .enable_time_budget = options.phase_time_budget_ms > 0,
+      .phase_time_budget_ms = options.phase_time_budget_ms > 0
+                                  ? options.phase_time_budget_ms
+                                  : 16.0f,
+      .sampler_type = static_cast<int>(options.sampler_type),
+      .enable_denoiser = options.enable_denoiser,
+      .enable_path_guiding = options.enable_path_guiding,
+      .enable_primary_hit_cache = options.enable_primary_hit_cache,
+      // Only worth it when the image is watched.
+      .enable_preview = options.mode == RunMode::kGui,
+      .region = {options.region[0], options.region[1], options.region[2],
+                 options.region[3]},
+      .tonemap_operator = static_cast<int>(options.tonemap.tonemap_operator),
+      .exposure = static_cast<float>(options.tonemap.exposure),
+  };
+  if (options.look_from.has_value()) {
+    std::copy(options.look_from->begin(), options.look_from->end(),
+              settings.look_from);
+  }
+  if (options.look_at.has_value()) {
+    std::copy(options.look_at->begin(), options.look_at->end(),
+              settings.look_at);
+  }
+  return settings;
+}
+
+std::vector<std::string> SceneFlags(const SceneOptions& options) {
+  std::vector<std::string> flags;
+  switch (options.type) {
+    case SceneType::kRandomSpheres:
+      flags.push_back("--scene=random_spheres");
+      break;
+    case SceneType::kEarth:
+      flags.push_back("--scene=earth");
+      break;
+    case SceneType::kPerlinSpheres:
+      flags.push_back("--scene=perlin_spheres");
+      break;
+    case SceneType::kFog:
+      flags.push_back("--scene=fog");
+      break;
+    case SceneType::kCornellBox:
+      flags.push_back("--scene=cornell_box");
+      break;
+    case SceneType::kManyLights:
+      flags.push_back("--scene=many_lights");
+      break;
+  }
+  switch (options.bvh) {
+    case BvhType::kNone:
+      flags.push_back("--bvh=none");
+      break;
+    case BvhType::kBinary:
+      flags.push_back("--bvh=binary");
+      break;
+    case BvhType::kWide:
+      flags.push_back("--bvh=wide");
+      break;
+  }
+  if (!options.texture_path.empty()) {
+    flags.push_back("--texture=" + options.texture_path);
+  }
+  flags.push_back("--texture_cache_mb=" +
+                  std::to_string(options.texture_cache_bytes >> 20));
+  if (!options.environment_path.empty()) {
+    flags.push_back("--environment=" + options.environment_path);
+  }
+  return flags;
+}
\ No newline at end of file
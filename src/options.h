@@ -0,0 +1,78 @@
+#ifndef PEWPEW_OPTIONS_H_
+#define PEWPEW_OPTIONS_H_
+
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "app.h"
+#include "sampler.h"
+#include "scene.h"
+#include "tonemap.h"
+
+enum class RunMode {
+  kGui,
+  kHeadless,
+  kCoordinator,
+  kWorker,
+  kServer,
+  kSubmit,
+};
+
+struct Options {
+  RunMode mode;
+  std::string executable;
+  SceneOptions scene;
+  std::string output_path;
+  std::string address;
+  std::string checkpoint_path;
+  int checkpoint_interval;
+  bool compress_checkpoints;
+  bool resume;
+  int num_local_workers;
+  int tile_size;
+  // In seconds, 0 for none.
+  int worker_timeout;
+  int samples_per_pixel_log2;
+  float image_scale_factor;
+  // Overrides of the view of the scene.
+  std::optional<float> fov;
+  std::optional<std::array<float, 3>> look_from;
+  std::optional<std::array<float, 3>> look_at;
+  float phase_time_budget_ms;
+  SamplerType sampler_type;
+  bool enable_denoiser;
+  bool enable_path_guiding;
+  bool enable_primary_hit_cache;
+  // The region rendered and written, as fractions of the image: x, y, width
+  // and height. The whole image if the width is 0.
+  float region[4];
+  TonemapSettings tonemap;
+  // Pins render threads to the CPUs of NUMA nodes, and optionally builds a
+  // copy of the scene on each node.
+  bool numa;
+  bool replicate_scene_per_numa_node;
+  // Renders headless images tile by tile into this file, so that their size
+  // isn't bounded by memory.
+  std::string framebuffer_path;
+  bool half_float_framebuffer;
+  // Jobs submitted to a render server preempt those of lower priorities.
+  int priority;
+  // A script of edits replayed by the GUI, which reports how long they take
+  // to show, at first and with this many samples per pixel.
+  std::string replay_path;
+  int replay_samples_per_pixel;
+};
+
+// Parses `--name=value` flags. Prints an error and returns false on unknown
+// or malformed flags.
+bool ParseOptions(int argc, char** argv, Options* options);
+
+// The settings of the app, or of headless renders, starting from `view`.
+AppSettings ToAppSettings(const Options& options, const SceneView& view);
+
+// The flags that select the scene, for the workers spawned by a coordinator.
+std::vector<std::string> SceneFlags(const SceneOptions& options);
+
+#endif  // PEWPEW_OPTIONS_H_
\ No newline at end of file
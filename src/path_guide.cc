@@ -0,0 +1,161 @@
+#include "path_guide.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+#include "float.h"
+#include "sampler.h"
+#include "utils.h"
+#include "vec3.h"
+
+namespace {
+
+// Cells are found by linear probing from their hash.
+constexpr int kMaxProbes = 16;
+// Cells with fewer records are too noisy to be sampled.
+constexpr uint32_t kMinRecords = 16;
+
+}  // namespace
+
+PathGuide::PathGuide()
+    : camera_{}, cell_angle_(0), cells_(new Cell[kNumCells]),
+      distributions_(kNumCells) {}
+
+void PathGuide::Reset(const Point3& camera, Float cell_angle) {
+  camera_ = camera;
+  cell_angle_ = cell_angle;
+  // clang-format off
+  #pragma omp parallel for schedule(static)
+  // clang-format on
+  for (int i = 0; i < kNumCells; i++) {
+    Cell& cell = cells_[i];
+    cell.key.store(0, std::memory_order_relaxed);
+    cell.num_records.store(0, std::memory_order_relaxed);
+    for (std::atomic<float>& radiance : cell.radiance) {
+      radiance.store(0, std::memory_order_relaxed);
+    }
+    distributions_[i].can_sample = false;
+  }
+}
+
+int PathGuide::FindCell(const Point3& p, const Vec3& normal) {
+  // Cells double in size as the distance to the camera does.
+  const Float extent =
+      std::max<Float>((p - camera_).length() * cell_angle_, 1e-6);
+  const int level = static_cast<int>(std::floor(std::log2(extent)));
+  const Float inverse_cell_size = std::ldexp(Float{1}, -level);
+
+  // Both sides of thin objects see different light, so the dominant axis of
+  // the normal and its sign are part of the key.
+  int normal_axis = 0;
+  for (int axis = 1; axis < 3; axis++) {
+    if (std::abs(normal[axis]) > std::abs(normal[normal_axis])) {
+      normal_axis = axis;
+    }
+  }
+  uint64_t key = HashSeed(2 * normal_axis + (normal[normal_axis] < 0));
+  key = HashSeed(key ^ static_cast<uint32_t>(level));
+  for (int axis = 0; axis < 3; axis++) {
+    const int64_t coordinate =
+        static_cast<int64_t>(std::floor(p[axis] * inverse_cell_size));
+    key = HashSeed(key ^ static_cast<uint64_t>(coordinate));
+  }
+  key = std::max<uint64_t>(key, 1);
+
+  for (int probe = 0; probe < kMaxProbes; probe++) {
+    const int index = (key + probe) & (kNumCells - 1);
+    std::atomic<uint64_t>& cell_key = cells_[index].key;
+    uint64_t current = cell_key.load(std::memory_order_relaxed);
+    if (current == 0 && cell_key.compare_exchange_strong(
+                            current, key, std::memory_order_relaxed)) {
+      return index;
+    }
+    // Either the cell was taken, possibly by another thread with the same
+    // key, or the exchange failed and `current` is the key that won.
+    if (current == key) {
+      return index;
+    }
+  }
+  return -1;
+}
+
+Vec3 PathGuide::Sample(int cell, const Sample2D& sample) const {
+  const std::array<float, kNumBins>& cdf = distributions_[cell].cdf;
+  const int bin = std::min<int>(
+      std::upper_bound(cdf.begin(), cdf.end(), sample.u) - cdf.begin(),
+      kNumBins - 1);
+  // The rest of `sample.u` places the direction within the bin.
+  const Float begin = bin > 0 ? cdf[bin - 1] : 0;
+  const Float width = cdf[bin] - begin;
+  const Float within =
+      width > 0 ? std::clamp<Float>((sample.u - begin) / width, 0, 1) : 0.5;
+
+  const Float pi = std::numbers::pi_v<Float>;
+  const Float z =
+      -1 + 2 * (bin / kNumBinsPerAxis + within) / kNumBinsPerAxis;
+  const Float phi =
+      2 * pi * (bin % kNumBinsPerAxis + sample.v) / kNumBinsPerAxis;
+  const Float radius = std::sqrt(std::max<Float>(0, 1 - z * z));
+  return Vec3{radius * std::cos(phi - pi), z, radius * std::sin(phi - pi)};
+}
+
+Float PathGuide::Pdf(int cell, const Vec3& direction) const {
+  const std::array<float, kNumBins>& cdf = distributions_[cell].cdf;
+  const int bin = Bin(direction);
+  const Float probability = cdf[bin] - (bin > 0 ? cdf[bin - 1] : 0);
+  // Bins have the same solid angle.
+  return probability * kNumBins / (4 * std::numbers::pi_v<Float>);
+}
+
+void PathGuide::Record(int cell, const Vec3& direction, Float radiance) {
+  if (!(radiance > 0) || std::isinf(radiance)) {
+    return;
+  }
+  cells_[cell].radiance[Bin(direction)].fetch_add(
+      static_cast<float>(radiance), std::memory_order_relaxed);
+  cells_[cell].num_records.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PathGuide::Update() {
+  // clang-format off
+  #pragma omp parallel for schedule(static)
+  // clang-format on
+  for (int i = 0; i < kNumCells; i++) {
+    const Cell& cell = cells_[i];
+    Distribution& distribution = distributions_[i];
+    distribution.can_sample = false;
+    if (cell.num_records.load(std::memory_order_relaxed) < kMinRecords) {
+      continue;
+    }
+
+    float sum = 0;
+    for (int bin = 0; bin < kNumBins; bin++) {
+      sum += cell.radiance[bin].load(std::memory_order_relaxed);
+      distribution.cdf[bin] = sum;
+    }
+    if (sum <= 0) {
+      continue;
+    }
+    for (float& value : distribution.cdf) {
+      value /= sum;
+    }
+    distribution.cdf.back() = 1;
+    distribution.can_sample = true;
+  }
+}
+
+int PathGuide::Bin(const Vec3& direction) {
+  const Vec3 unit_direction = UnitVector(direction);
+  const Float pi = std::numbers::pi_v<Float>;
+  const Float phi = std::atan2(unit_direction.z(), unit_direction.x()) + pi;
+  const int z_bin = std::clamp(
+      static_cast<int>((unit_direction.y() + 1) / 2 * kNumBinsPerAxis), 0,
+      kNumBinsPerAxis - 1);
+  const int phi_bin = std::clamp(
+      static_cast<int>(phi / (2 * pi) * kNumBinsPerAxis), 0,
+      kNumBinsPerAxis - 1);
+  return z_bin * kNumBinsPerAxis + phi_bin;
+}
\ No newline at end of file
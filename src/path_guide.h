@@ -0,0 +1,75 @@
+#ifndef PEWPEW_PATH_GUIDE_H_
+#define PEWPEW_PATH_GUIDE_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "float.h"
+#include "sampler.h"
+#include "vec3.h"
+
+// A cache of the radiance arriving at the diffuse hits of the paths, learned
+// while rendering, to sample directions where light comes from.
+//
+// Space is hashed into cells that grow with the distance to the camera, so
+// that they cover about the same number of pixels wherever they are. Each
+// cell splits the sphere of directions into equal-area bins. Paths add their
+// radiance to the cells they go through during a phase, with atomics only;
+// the directions are sampled from the distributions built from what was
+// learned in the previous phases.
+class PathGuide {
+ public:
+  PathGuide();
+
+  // Forgets everything. `cell_angle` is the angle, seen from `camera`, below
+  // which hits are grouped into the same cell.
+  void Reset(const Point3& camera, Float cell_angle);
+
+  // The cell of `p` on a surface facing `normal`, or -1 if the cache is full.
+  int FindCell(const Point3& p, const Vec3& normal);
+
+  // Whether the cell has learned enough to be sampled.
+  bool CanSample(int cell) const { return distributions_[cell].can_sample; }
+  Vec3 Sample(int cell, const Sample2D& sample) const;
+  // The solid angle density of `Sample` picking `direction`.
+  Float Pdf(int cell, const Vec3& direction) const;
+
+  // Adds an estimate of the radiance arriving from `direction`, that is the
+  // radiance divided by the density of sampling the direction. Thread-safe.
+  void Record(int cell, const Vec3& direction, Float radiance);
+
+  // Builds the distributions from what was recorded so far. Must not run
+  // concurrently with the other methods.
+  void Update();
+
+ private:
+  static constexpr int kNumCellsLog2 = 16;
+  static constexpr int kNumCells = 1 << kNumCellsLog2;
+  // Bins of cos(theta) by bins of phi.
+  static constexpr int kNumBinsPerAxis = 8;
+  static constexpr int kNumBins = kNumBinsPerAxis * kNumBinsPerAxis;
+
+  struct Cell {
+    // 0 while the cell is free.
+    std::atomic<uint64_t> key;
+    std::atomic<uint32_t> num_records;
+    std::array<std::atomic<float>, kNumBins> radiance;
+  };
+
+  struct Distribution {
+    bool can_sample;
+    std::array<float, kNumBins> cdf;
+  };
+
+  static int Bin(const Vec3& direction);
+
+  Point3 camera_;
+  Float cell_angle_;
+  std::unique_ptr<Cell[]> cells_;
+  std::vector<Distribution> distributions_;
+};
+
+#endif  // PEWPEW_PATH_GUIDE_H_
\ No newline at end of file
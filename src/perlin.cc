@@ -0,0 +1,219 @@
+#include "perlin.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <utility>
+
+#include "float.h"
+#include "pcg_random.hpp"
+#include "simd.h"
+#include "vec3.h"
+#include "vec3_wide.h"
+
+namespace {
+
+constexpr int kWidth = FloatX4::kWidth;
+
+// The corners of a lattice cell, indexed by their offsets as
+// `x | y << 1 | z << 2`.
+constexpr int kNumCorners = 8;
+
+float Fade(float t) { return t * t * (3 - 2 * t); }
+FloatX4 Fade(FloatX4 t) {
+  return t * t * (FloatX4{3.0f} - FloatX4{2.0f} * t);
+}
+
+template <typename T>
+T Lerp(T a, T b, T t) {
+  return a + t * (b - a);
+}
+
+// Interpolates the corner values of a cell.
+template <typename T>
+T Trilinear(const T (&corners)[kNumCorners], T u, T v, T w) {
+  const T x00 = Lerp(corners[0], corners[1], u);
+  const T x10 = Lerp(corners[2], corners[3], u);
+  const T x01 = Lerp(corners[4], corners[5], u);
+  const T x11 = Lerp(corners[6], corners[7], u);
+  return Lerp(Lerp(x00, x10, v), Lerp(x01, x11, v), w);
+}
+
+// Loads `count` points, repeating the last one to fill the lanes.
+Vec3x4 LoadPartial(const Point3* points, int count) {
+  Point3 lanes[kWidth];
+  for (int i = 0; i < kWidth; i++) {
+    lanes[i] = points[std::min(i, count - 1)];
+  }
+  return Vec3x4::Load(lanes);
+}
+
+void StorePartial(FloatX4 lanes, int count, Float* values) {
+  float stored[kWidth];
+  lanes.Store(stored);
+  std::copy(stored, stored + count, values);
+}
+
+}  // namespace
+
+Perlin::Perlin(uint64_t seed) {
+  pcg32 rng{seed, /*stream=*/0};
+  auto random_float = [&rng] { return (rng() >> 8) * 0x1p-24f * 2 - 1; };
+  for (std::array<float, 4>& gradient : gradients_) {
+    const Vec3 direction =
+        UnitVector(Vec3{random_float(), random_float(), random_float()});
+    gradient = {static_cast<float>(direction.x()),
+                static_cast<float>(direction.y()),
+                static_cast<float>(direction.z()), 0.0f};
+  }
+
+  for (std::array<uint8_t, kSize>* permutation :
+       {&permutation_x_, &permutation_y_, &permutation_z_}) {
+    std::iota(permutation->begin(), permutation->end(), 0);
+    for (int i = kSize - 1; i > 0; i--) {
+      std::uniform_int_distribution<int> distribution{0, i};
+      std::swap((*permutation)[i], (*permutation)[distribution(rng)]);
+    }
+  }
+}
+
+Float Perlin::Noise(const Point3& p) const {
+  // In single precision, like the lanes.
+  const float x = static_cast<float>(p.x());
+  const float y = static_cast<float>(p.y());
+  const float z = static_cast<float>(p.z());
+  const float floor_x = std::floor(x);
+  const float floor_y = std::floor(y);
+  const float floor_z = std::floor(z);
+  const float offsets_x[2] = {x - floor_x, x - floor_x - 1};
+  const float offsets_y[2] = {y - floor_y, y - floor_y - 1};
+  const float offsets_z[2] = {z - floor_z, z - floor_z - 1};
+  const int i = static_cast<int>(floor_x);
+  const int j = static_cast<int>(floor_y);
+  const int k = static_cast<int>(floor_z);
+  const int hashes_x[2] = {permutation_x_[i & (kSize - 1)],
+                           permutation_x_[(i + 1) & (kSize - 1)]};
+  const int hashes_y[2] = {permutation_y_[j & (kSize - 1)],
+                           permutation_y_[(j + 1) & (kSize - 1)]};
+  const int hashes_z[2] = {permutation_z_[k & (kSize - 1)],
+                           permutation_z_[(k + 1) & (kSize - 1)]};
+
+  float corners[kNumCorners];
+  for (int corner = 0; corner < kNumCorners; corner++) {
+    const int di = corner & 1;
+    const int dj = (corner >> 1) & 1;
+    const int dk = corner >> 2;
+    const std::array<float, 4>& gradient =
+        gradients_[hashes_x[di] ^ hashes_y[dj] ^ hashes_z[dk]];
+    corners[corner] = gradient[0] * offsets_x[di] +
+                      gradient[1] * offsets_y[dj] +
+                      gradient[2] * offsets_z[dk];
+  }
+  return Trilinear(corners, Fade(offsets_x[0]), Fade(offsets_y[0]),
+                   Fade(offsets_z[0]));
+}
+
+FloatX4 Perlin::Noise(const Vec3x4& p) const {
+  const FloatX4 floor_x = Floor(p.x());
+  const FloatX4 floor_y = Floor(p.y());
+  const FloatX4 floor_z = Floor(p.z());
+  const FloatX4 u = p.x() - floor_x;
+  const FloatX4 v = p.y() - floor_y;
+  const FloatX4 w = p.z() - floor_z;
+
+  float cells[3][kWidth];
+  floor_x.Store(cells[0]);
+  floor_y.Store(cells[1]);
+  floor_z.Store(cells[2]);
+  // The permutations of both sides of the cell along each axis, per lane.
+  int hashes[3][2][kWidth];
+  const std::array<uint8_t, kSize>* permutations[3] = {
+      &permutation_x_, &permutation_y_, &permutation_z_};
+  for (int axis = 0; axis < 3; axis++) {
+    for (int lane = 0; lane < kWidth; lane++) {
+      const int cell = static_cast<int>(cells[axis][lane]);
+      hashes[axis][0][lane] = (*permutations[axis])[cell & (kSize - 1)];
+      hashes[axis][1][lane] = (*permutations[axis])[(cell + 1) & (kSize - 1)];
+    }
+  }
+
+  const FloatX4 one{1.0f};
+  const FloatX4 offsets_x[2] = {u, u - one};
+  const FloatX4 offsets_y[2] = {v, v - one};
+  const FloatX4 offsets_z[2] = {w, w - one};
+  FloatX4 corners[kNumCorners];
+  for (int corner = 0; corner < kNumCorners; corner++) {
+    const int di = corner & 1;
+    const int dj = (corner >> 1) & 1;
+    const int dk = corner >> 2;
+    // There is no gather before AVX2, so the gradients of the lanes are
+    // loaded whole and transposed.
+    FloatX4 gradients[kWidth];
+    for (int lane = 0; lane < kWidth; lane++) {
+      const int index = hashes[0][di][lane] ^ hashes[1][dj][lane] ^
+                        hashes[2][dk][lane];
+      gradients[lane] = FloatX4::Load(gradients_[index].data());
+    }
+    Transpose(&gradients[0], &gradients[1], &gradients[2], &gradients[3]);
+    corners[corner] = gradients[0] * offsets_x[di] +
+                      gradients[1] * offsets_y[dj] +
+                      gradients[2] * offsets_z[dk];
+  }
+  return Trilinear(corners, Fade(u), Fade(v), Fade(w));
+}
+
+void Perlin::Noise(const Point3* points, int count, Float* values) const {
+  for (int i = 0; i < count; i += kWidth) {
+    const int lanes = std::min(kWidth, count - i);
+    StorePartial(Noise(LoadPartial(points + i, lanes)), lanes, values + i);
+  }
+}
+
+Float Perlin::Turbulence(const Point3& p, int depth) const {
+  FloatX4 sum{0.0f};
+  FloatX4 frequency{1.0f, 2.0f, 4.0f, 8.0f};
+  FloatX4 weight{1.0f, 0.5f, 0.25f, 0.125f};
+  for (int octave = 0; octave < depth; octave += kWidth) {
+    if (depth - octave < kWidth) {
+      // Drops the lanes past the last octave.
+      const FloatX4 lane{0.0f, 1.0f, 2.0f, 3.0f};
+      weight = Select(lane < FloatX4{static_cast<float>(depth - octave)},
+                      weight, FloatX4{0.0f});
+    }
+    const Vec3x4 octave_points{
+        FloatX4{static_cast<float>(p.x())} * frequency,
+        FloatX4{static_cast<float>(p.y())} * frequency,
+        FloatX4{static_cast<float>(p.z())} * frequency};
+    sum = sum + Noise(octave_points) * weight;
+    frequency = frequency * FloatX4{16.0f};
+    weight = weight * FloatX4{1.0f / 16};
+  }
+
+  float lanes[kWidth];
+  sum.Store(lanes);
+  return std::abs((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+}
+
+FloatX4 Perlin::Turbulence(const Vec3x4& p, int depth) const {
+  FloatX4 sum{0.0f};
+  Vec3x4 octave_points = p;
+  FloatX4 weight{1.0f};
+  for (int octave = 0; octave < depth; octave++) {
+    sum = sum + Noise(octave_points) * weight;
+    octave_points = octave_points * FloatX4{2.0f};
+    weight = weight * FloatX4{0.5f};
+  }
+  return Abs(sum);
+}
+
+void Perlin::Turbulence(const Point3* points, int count, int depth,
+                        Float* values) const {
+  for (int i = 0; i < count; i += kWidth) {
+    const int lanes = std::min(kWidth, count - i);
+    StorePartial(Turbulence(LoadPartial(points + i, lanes), depth), lanes,
+                 values + i);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef PEWPEW_PERLIN_H_
+#define PEWPEW_PERLIN_H_
+
+#include <array>
+#include <cstdint>
+
+#include "float.h"
+#include "simd.h"
+#include "vec3.h"
+#include "vec3_wide.h"
+
+// Gradient noise over a 256^3 lattice, as in the second book, with the
+// permutations and gradients generated once from a seed. Evaluation is
+// vectorized: four points per call, only the table lookups being scalar.
+class Perlin {
+ public:
+  explicit Perlin(uint64_t seed);
+
+  // In [-1, 1].
+  Float Noise(const Point3& p) const;
+  FloatX4 Noise(const Vec3x4& p) const;
+  // `values[i]` is the noise at `points[i]`.
+  void Noise(const Point3* points, int count, Float* values) const;
+
+  // The absolute value of `depth` octaves of noise, the weight of each octave
+  // halving as its frequency doubles. The octaves of a single point are
+  // evaluated as lanes.
+  Float Turbulence(const Point3& p, int depth) const;
+  FloatX4 Turbulence(const Vec3x4& p, int depth) const;
+  void Turbulence(const Point3* points, int count, int depth,
+                  Float* values) const;
+
+ private:
+  static constexpr int kSize = 256;
+
+  // Padded to 4 floats, so that each loads as one pack.
+  alignas(16) std::array<std::array<float, 4>, kSize> gradients_;
+  std::array<uint8_t, kSize> permutation_x_;
+  std::array<uint8_t, kSize> permutation_y_;
+  std::array<uint8_t, kSize> permutation_z_;
+};
+
+#endif  // PEWPEW_PERLIN_H_
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "quad.h"
+
+#include <cmath>
+#include <limits>
+#include <optional>
+
+#include "aabb.h"
+#include "float.h"
+#include "hittable.h"
+#include "ray.h"
+#include "sampler.h"
+#include "vec3.h"
+
+Quad::Quad(const Point3& q, const Vec3& u, const Vec3& v, Material* material)
+    : q_(q), u_(u), v_(v), material_(material) {
+  const Vec3 n = Cross(u, v);
+  w_ = n / Dot(n, n);
+  normal_ = UnitVector(n);
+  d_ = Dot(normal_, q);
+  area_ = n.length();
+}
+
+std::optional<HitRecord> Quad::Hit(const Ray& ray, Float tmin,
+                                   Float tmax) const {
+  const Float denominator = Dot(normal_, ray.direction());
+  if (std::fabs(denominator) < 1e-8) {
+    return std::nullopt;
+  }
+
+  const Float t = (d_ - Dot(normal_, ray.origin())) / denominator;
+  if (t <= tmin || t >= tmax) {
+    return std::nullopt;
+  }
+
+  const Point3 intersection = ray.at(t);
+  const Vec3 planar = intersection - q_;
+  const Float alpha = Dot(w_, Cross(planar, v_));
+  const Float beta = Dot(w_, Cross(u_, planar));
+  if (alpha < 0 || alpha > 1 || beta < 0 || beta > 1) {
+    return std::nullopt;
+  }
+
+  const Float footprint = ray.ConeWidth(t) / std::sqrt(area_);
+  return HitRecord{t, intersection, material_, normal_, ray, alpha, beta,
+                   footprint};
+}
+
+Aabb Quad::BoundingBox() const {
+  // Padded, so that axis-aligned quads don't have flat boxes.
+  const Vec3 padding{1e-4, 1e-4, 1e-4};
+  const Aabb box{Aabb{q_, q_ + u_ + v_}, Aabb{q_ + u_, q_ + v_}};
+  return Aabb{box.min() - padding, box.max() + padding};
+}
+
+Vec3 Quad::SampleDirection(const Point3& origin,
+                           const Sample2D& sample) const {
+  return q_ + sample.u * u_ + sample.v * v_ - origin;
+}
+
+Float Quad::PdfValue(const Point3& origin, const Vec3& direction) const {
+  const std::optional<HitRecord> hit =
+      Hit(Ray{origin, direction}, static_cast<Float>(0.001),
+          std::numeric_limits<Float>::infinity());
+  if (!hit.has_value()) {
+    return 0;
+  }
+
+  // Converts the uniform density over the area to solid angle.
+  const Float distance_squared =
+      hit->t() * hit->t() * direction.length_squared();
+  const Float cosine =
+      std::fabs(Dot(direction, normal_)) / direction.length();
+  return distance_squared / (cosine * area_);
+}
\ No newline at end of file
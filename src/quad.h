@@ -0,0 +1,42 @@
+#ifndef PEWPEW_QUAD_H_
+#define PEWPEW_QUAD_H_
+
+#include <optional>
+
+#include "aabb.h"
+#include "float.h"
+#include "hittable.h"
+#include "material.h"
+#include "ray.h"
+#include "sampler.h"
+#include "vec3.h"
+
+// The parallelogram with corner `q` and edges `u` and `v`, from the second
+// book.
+class Quad : public Hittable {
+ public:
+  Quad(const Point3& q, const Vec3& u, const Vec3& v, Material* material);
+
+  std::optional<HitRecord> Hit(const Ray& ray, Float tmin,
+                               Float tmax) const override;
+  Aabb BoundingBox() const override;
+
+  Float Area() const override { return area_; }
+  Vec3 SampleDirection(const Point3& origin,
+                       const Sample2D& sample) const override;
+  Float PdfValue(const Point3& origin, const Vec3& direction) const override;
+
+ private:
+  Point3 q_;
+  Vec3 u_;
+  Vec3 v_;
+  // Maps points of the plane to their coordinates along `u_` and `v_`.
+  Vec3 w_;
+  Vec3 normal_;
+  // The plane is the points p with Dot(normal_, p) == d_.
+  Float d_;
+  Float area_;
+  Material* material_;
+};
+
+#endif  // PEWPEW_QUAD_H_
\ No newline at end of file
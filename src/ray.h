@@ -4,20 +4,36 @@
 #include "float.h"
 #include "vec3.h"
 
+// Rays can carry a cone, an isotropic simplification of ray differentials,
+// which gives the width of the pixel footprint along the ray for texture
+// filtering.
 class Ray {
  public:
   Ray() {}
   Ray(const Point3& origin, const Vec3& direction)
       : origin_(origin), direction_(direction) {}
+  Ray(const Point3& origin, const Vec3& direction, Float cone_width,
+      Float cone_angle)
+      : origin_(origin),
+        direction_(direction),
+        cone_width_(cone_width),
+        cone_angle_(cone_angle),
+        cone_spread_(cone_angle * direction.length()) {}
 
   const Vec3& origin() const { return origin_; }
   const Vec3& direction() const { return direction_; }
+  Float cone_angle() const { return cone_angle_; }
 
   Point3 at(Float t) const { return origin_ + t * direction_; }
+  Float ConeWidth(Float t) const { return cone_width_ + t * cone_spread_; }
 
  private:
   Point3 origin_;
   Vec3 direction_;
+  Float cone_width_ = 0;
+  Float cone_angle_ = 0;
+  // The width increase per unit of `t`, which depends on the direction length.
+  Float cone_spread_ = 0;
 };
 
 #endif  // PEWPEW_RAY_H_
\ No newline at end of file
@@ -0,0 +1,332 @@
+#include "render_server.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "app.h"
+#include "app_settings.h"
+#include "camera.h"
+#include "options.h"
+#include "scene.h"
+#include "socket.h"
+
+namespace {
+
+// Bounds what a malformed job makes the server allocate.
+constexpr uint32_t kMaxFlags = 256;
+constexpr uint32_t kMaxFlagSize = 4096;
+
+// How long the server waits for resources to free up when it can't accept.
+constexpr std::chrono::milliseconds kAcceptRetryDelay{100};
+
+// Flags of other modes, which render jobs would otherwise silently ignore.
+constexpr std::string_view kUnsupportedFlags[] = {
+    "--coordinator",
+    "--worker",
+    "--server",
+    "--submit",
+    "--checkpoint",
+    "--checkpoint_interval",
+    "--compress_checkpoints",
+    "--resume",
+    "--local_workers",
+    "--tile_size",
+    "--worker_timeout",
+    "--numa",
+    "--numa_replicate_scene",
+    "--framebuffer",
+    "--half_float_framebuffer",
+    "--replay",
+    "--replay_spp",
+};
+
+// A count, then each flag as its size and its characters.
+bool SendFlags(int fd, const std::vector<std::string>& flags) {
+  const uint32_t num_flags = flags.size();
+  if (!SendAll(fd, &num_flags, sizeof(num_flags))) {
+    return false;
+  }
+  for (const std::string& flag : flags) {
+    const uint32_t size = flag.size();
+    if (!SendAll(fd, &size, sizeof(size)) ||
+        !SendAll(fd, flag.data(), size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ReceiveFlags(int fd, std::vector<std::string>* flags) {
+  uint32_t num_flags;
+  if (!ReceiveAll(fd, &num_flags, sizeof(num_flags)) ||
+      num_flags > kMaxFlags) {
+    return false;
+  }
+  flags->resize(num_flags);
+  for (std::string& flag : *flags) {
+    uint32_t size;
+    if (!ReceiveAll(fd, &size, sizeof(size)) || size > kMaxFlagSize) {
+      return false;
+    }
+    flag.resize(size);
+    if (!ReceiveAll(fd, flag.data(), size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Clients send nothing after their job, so a readable connection is one they
+// closed, e.g. to give up on a preview.
+bool IsConnectionClosed(int fd) {
+  pollfd connection_poll{fd, POLLIN, 0};
+  return poll(&connection_poll, 1, /*timeout=*/0) > 0;
+}
+
+// Errors of `accept` that go away once jobs finish and free their resources.
+bool IsOutOfResources(int error) {
+  return error == EMFILE || error == ENFILE || error == ENOBUFS ||
+         error == ENOMEM;
+}
+
+void Reply(int fd, bool success) {
+  SendAll(fd, &success, sizeof(success));
+  close(fd);
+}
+
+}  // namespace
+
+RenderServer::RenderServer(const std::string& address)
+    : address_(address),
+      scheduler_thread_(std::bind_front(&RenderServer::Schedule, this)) {}
+
+bool RenderServer::Run() {
+  const int listen_fd = OpenSocket(address_, /*is_server=*/true);
+  if (listen_fd < 0) {
+    std::cerr << "Error listening on " << address_ << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  // Accepts again at once after interruptions, and after clients that went
+  // away before being accepted.
+  while (true) {
+    const int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd >= 0) {
+      // Scenes may take a while to build, so jobs are read on their own
+      // threads, which end once the job is queued.
+      std::thread(&RenderServer::Serve, this, fd).detach();
+    } else if (IsOutOfResources(errno)) {
+      std::cerr << "Error accepting a job: " << std::strerror(errno)
+                << std::endl;
+      std::this_thread::sleep_for(kAcceptRetryDelay);
+    } else if (errno != EINTR && errno != ECONNABORTED && errno != EPROTO &&
+               errno != EPERM) {
+      std::cerr << "Error accepting jobs on " << address_ << ": "
+                << std::strerror(errno) << std::endl;
+      close(listen_fd);
+      return false;
+    }
+  }
+}
+
+void RenderServer::Serve(int fd) {
+  std::vector<std::string> flags;
+  if (!ReceiveFlags(fd, &flags)) {
+    close(fd);
+    return;
+  }
+
+  std::unique_ptr<Job> job = MakeJob(std::move(flags));
+  if (job == nullptr) {
+    Reply(fd, /*success=*/false);
+    return;
+  }
+
+  job->fd = fd;
+  {
+    const std::lock_guard<std::mutex> guard(mutex_);
+    job->sequence = next_sequence_++;
+    jobs_.push_back(std::move(job));
+  }
+  condition_.notify_one();
+}
+
+std::unique_ptr<RenderServer::Job> RenderServer::MakeJob(
+    std::vector<std::string> flags) {
+  std::vector<char*> argv = {const_cast<char*>("pewpew")};
+  for (std::string& flag : flags) {
+    const std::string_view name =
+        std::string_view{flag}.substr(0, flag.find('='));
+    if (std::ranges::find(kUnsupportedFlags, name) !=
+        std::end(kUnsupportedFlags)) {
+      std::cerr << "Render jobs are headless progressive renders, and don't "
+                << "support " << name << std::endl;
+      return nullptr;
+    }
+    argv.push_back(flag.data());
+  }
+  Options options;
+  if (!ParseOptions(argv.size(), argv.data(), &options)) {
+    return nullptr;
+  }
+  options.mode = RunMode::kHeadless;
+
+  const Scene* scene = FindScene(options.scene);
+  if (scene == nullptr) {
+    return nullptr;
+  }
+
+  CameraSettings settings =
+      ToCameraSettings(ToAppSettings(options, scene->view));
+  if (settings.phase_scheduling != PhaseScheduling::kTimeBudget) {
+    settings.phase_scheduling = PhaseScheduling::kTimeBudget;
+    settings.phase_time_budget_ms = kPhaseTimeBudgetMs;
+  }
+  auto camera = std::make_unique<Camera>(settings);
+  camera->set_tonemap_settings(options.tonemap);
+  camera->set_lights(&scene->lights);
+  return std::make_unique<Job>(Job{
+      .priority = options.priority,
+      .sequence = 0,
+      .scene = scene,
+      .camera = std::move(camera),
+      .is_started = false,
+      .output_path = options.output_path,
+      .fd = -1,
+  });
+}
+
+const Scene* RenderServer::FindScene(const SceneOptions& options) {
+  std::string key;
+  for (const std::string& flag : SceneFlags(options)) {
+    key += flag + " ";
+  }
+
+  std::shared_ptr<CachedScene> cached_scene;
+  {
+    const std::lock_guard<std::mutex> guard(scenes_mutex_);
+    std::shared_ptr<CachedScene>& entry = scenes_[key];
+    if (entry == nullptr) {
+      entry = std::make_shared<CachedScene>();
+    }
+    cached_scene = entry;
+  }
+
+  // Jobs of other scenes needn't wait for this one to build.
+  std::call_once(cached_scene->built, [&options, &cached_scene] {
+    cached_scene->is_valid = BuildScene(options, &cached_scene->scene);
+  });
+  if (!cached_scene->is_valid) {
+    // Built again for the next job, e.g. once a missing texture is there.
+    const std::lock_guard<std::mutex> guard(scenes_mutex_);
+    auto it = scenes_.find(key);
+    if (it != scenes_.end() && it->second == cached_scene) {
+      scenes_.erase(it);
+    }
+    return nullptr;
+  }
+  return &cached_scene->scene;
+}
+
+void RenderServer::Schedule(std::stop_token token) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock, token, [this] { return !jobs_.empty(); });
+    if (token.stop_requested()) {
+      break;
+    }
+
+    Job* job = std::max_element(jobs_.begin(), jobs_.end(),
+                                [](const std::unique_ptr<Job>& a,
+                                   const std::unique_ptr<Job>& b) {
+                                  return a->priority != b->priority
+                                             ? a->priority < b->priority
+                                             : a->sequence > b->sequence;
+                                })
+                   ->get();
+    lock.unlock();
+
+    bool is_done = IsConnectionClosed(job->fd);
+    bool success = false;
+    if (!is_done) {
+      Camera* camera = job->camera.get();
+      if (!job->is_started) {
+        camera->Initialize(SettingsUpdateType::kUpdateTextureAndSettings);
+        job->is_started = true;
+      }
+      camera->InitializePhase();
+      camera->Render(std::stop_token{}, SceneRoot(*job->scene));
+      if (camera->done_rendering()) {
+        is_done = true;
+        success = camera->WriteImage(job->output_path);
+      }
+    }
+
+    lock.lock();
+    if (is_done) {
+      Reply(job->fd, success);
+      std::erase_if(jobs_, [job](const std::unique_ptr<Job>& other) {
+        return other.get() == job;
+      });
+    }
+  }
+
+  for (const std::unique_ptr<Job>& job : jobs_) {
+    close(job->fd);
+  }
+}
+
+bool SubmitRenderJob(const Options& options, std::vector<std::string> flags) {
+  flags.push_back("--output=" +
+                  std::filesystem::absolute(options.output_path).string());
+  if (!options.scene.texture_path.empty()) {
+    flags.push_back(
+        "--texture=" +
+        std::filesystem::absolute(options.scene.texture_path).string());
+  }
+  if (!options.scene.environment_path.empty()) {
+    flags.push_back(
+        "--environment=" +
+        std::filesystem::absolute(options.scene.environment_path).string());
+  }
+
+  const int fd = OpenSocket(options.address, /*is_server=*/false);
+  if (fd < 0) {
+    std::cerr << "Error connecting to " << options.address << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  bool success = false;
+  const bool is_answered = SendFlags(fd, flags) &&
+                           ReceiveAll(fd, &success, sizeof(success));
+  close(fd);
+  if (!is_answered) {
+    std::cerr << "Lost the connection to " << options.address << std::endl;
+    return false;
+  }
+  if (!success) {
+    std::cerr << "The render job failed, see the log of the server"
+              << std::endl;
+  }
+  return success;
+}
\ No newline at end of file
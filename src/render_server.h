@@ -0,0 +1,82 @@
+#ifndef PEWPEW_RENDER_SERVER_H_
+#define PEWPEW_RENDER_SERVER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera.h"
+#include "options.h"
+#include "scene.h"
+
+// Renders the jobs submitted to `address`, each the command line of a
+// headless render, with a single pool of render threads. Every phase goes to
+// the job of highest priority, the oldest among equals, so a preview waits
+// for at most a phase of a long final render, which resumes afterwards.
+// Phases are time-budgeted unless the job sets its own budget, to bound that
+// wait. Scenes and their BVHs are built for the first job that needs them and
+// kept for the later ones.
+class RenderServer {
+ public:
+  // Jobs without a time budget get this one.
+  static constexpr float kPhaseTimeBudgetMs = 100;
+
+  explicit RenderServer(const std::string& address);
+
+  RenderServer(const RenderServer&) = delete;
+  RenderServer& operator=(const RenderServer&) = delete;
+
+  // Serves until the process is killed. Prints an error and returns false if
+  // the address can't be listened on.
+  bool Run();
+
+ private:
+  struct Job {
+    int priority;
+    // Orders the jobs of a priority.
+    uint64_t sequence;
+    const Scene* scene;
+    std::unique_ptr<Camera> camera;
+    bool is_started;
+    std::string output_path;
+    // The connection of the client, answered once the image is written.
+    int fd;
+  };
+
+  struct CachedScene {
+    std::once_flag built;
+    bool is_valid = false;
+    Scene scene;
+  };
+
+  // Reads the job of a new connection, and queues it.
+  void Serve(int fd);
+  std::unique_ptr<Job> MakeJob(std::vector<std::string> flags);
+  // Builds the scene of `options` unless it is cached. Returns nullptr if it
+  // fails to build.
+  const Scene* FindScene(const SceneOptions& options);
+  // Renders a phase of the next job at a time.
+  void Schedule(std::stop_token token);
+
+  std::string address_;
+  std::mutex scenes_mutex_;
+  std::map<std::string, std::shared_ptr<CachedScene>> scenes_;
+  std::mutex mutex_;
+  std::condition_variable_any condition_;
+  std::vector<std::unique_ptr<Job>> jobs_;
+  uint64_t next_sequence_ = 0;
+  std::jthread scheduler_thread_;
+};
+
+// Submits a render job to the server at `options.address`, and waits until
+// its image is written. `flags` are the command line of the job; its paths
+// are resolved from the current directory rather than the server's.
+bool SubmitRenderJob(const Options& options, std::vector<std::string> flags);
+
+#endif  // PEWPEW_RENDER_SERVER_H_
\ No newline at end of file
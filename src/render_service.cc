@@ -0,0 +1,122 @@
+#include "render_service.h"
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stop_token>
+#include <utility>
+
+#include "app_settings.h"
+#include "camera.h"
+
+RenderService::RenderService(Camera* camera)
+    : camera_(camera), thread_(std::bind_front(&RenderService::Run, this)) {}
+
+RenderService::~RenderService() {
+  thread_.request_stop();
+  {
+    const std::lock_guard<std::mutex> guard(mutex_);
+    phase_stop_source_.request_stop();
+  }
+  thread_.join();
+}
+
+std::future<bool> RenderService::Submit(const RenderJob& job,
+                                        PhaseCallback on_phase) {
+  std::future<bool> done;
+  {
+    const std::lock_guard<std::mutex> guard(mutex_);
+    SettingsUpdateType update_type = job.update_type;
+    if (has_pending_job_) {
+      update_type = std::max(update_type, pending_job_.update_type);
+      pending_done_.set_value(false);
+    }
+    pending_job_ = job;
+    pending_job_.update_type = update_type;
+    pending_on_phase_ = std::move(on_phase);
+    pending_done_ = std::promise<bool>{};
+    done = pending_done_.get_future();
+    has_pending_job_ = true;
+    phase_stop_source_.request_stop();
+  }
+  condition_.notify_one();
+  return done;
+}
+
+void RenderService::Cancel() {
+  const std::lock_guard<std::mutex> guard(mutex_);
+  if (has_pending_job_) {
+    pending_done_.set_value(false);
+    has_pending_job_ = false;
+  }
+  is_cancel_requested_ = true;
+  phase_stop_source_.request_stop();
+}
+
+void RenderService::WithCamera(const std::function<void(Camera*)>& function) {
+  const std::lock_guard<std::mutex> guard(mutex_);
+  function(camera_);
+}
+
+bool RenderService::is_busy() {
+  const std::lock_guard<std::mutex> guard(mutex_);
+  return has_pending_job_ || is_rendering_job_;
+}
+
+void RenderService::Run(std::stop_token token) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock, token, [this] { return has_pending_job_; });
+    if (token.stop_requested()) {
+      break;
+    }
+
+    const RenderJob job = pending_job_;
+    const PhaseCallback on_phase = std::move(pending_on_phase_);
+    std::promise<bool> done = std::move(pending_done_);
+    has_pending_job_ = false;
+    is_cancel_requested_ = false;
+    is_rendering_job_ = true;
+    phase_stop_source_ = std::stop_source{};
+
+    if (job.update_type != SettingsUpdateType::kNoUpdates) {
+      camera_->set_settings(job.settings);
+      camera_->Initialize(job.update_type);
+    }
+
+    // Phases follow each other without waiting for anyone. The camera is only
+    // done once a phase completes the target samples of every row, so a
+    // cancelled last phase doesn't resolve the job as rendered.
+    bool is_done = camera_->done_rendering();
+    while (!is_done && !has_pending_job_ && !is_cancel_requested_ &&
+           !token.stop_requested()) {
+      camera_->InitializePhase();
+      const std::stop_token phase_token = phase_stop_source_.get_token();
+      lock.unlock();
+
+      camera_->Render(phase_token, *job.world);
+      is_done = camera_->done_rendering();
+      if (on_phase != nullptr) {
+        on_phase(PhaseEvent{
+            .phase = camera_->current_phase(),
+            .accumulated_samples_per_pixel =
+                camera_->accumulated_samples_per_pixel(),
+            .target_samples_per_pixel = camera_->target_samples_per_pixel(),
+            .phase_render_time = camera_->phase_render_time(),
+            .is_done = is_done,
+        });
+      }
+
+      lock.lock();
+    }
+
+    is_rendering_job_ = false;
+    done.set_value(is_done);
+  }
+
+  if (has_pending_job_) {
+    pending_done_.set_value(false);
+    has_pending_job_ = false;
+  }
+}
\ No newline at end of file
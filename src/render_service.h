@@ -0,0 +1,83 @@
+#ifndef PEWPEW_RENDER_SERVICE_H_
+#define PEWPEW_RENDER_SERVICE_H_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+#include "app_settings.h"
+#include "camera.h"
+#include "hittable.h"
+
+struct RenderJob {
+  const Hittable* world;
+  CameraSettings settings;
+  // How the camera is initialized for the job. `kNoUpdates` continues its
+  // accumulation, e.g. after restoring a checkpoint, and ignores `settings`.
+  SettingsUpdateType update_type;
+};
+
+// Reported after each phase, interrupted ones included.
+struct PhaseEvent {
+  int phase;
+  int accumulated_samples_per_pixel;
+  int target_samples_per_pixel;
+  double phase_render_time;
+  bool is_done;
+};
+
+// Renders the phases of one job at a time with a camera, back to back, on a
+// thread that lives as long as the service, so that OpenMP keeps its thread
+// pool across phases and jobs.
+class RenderService {
+ public:
+  // Called on the render thread, between phases, when the camera is
+  // consistent, e.g. for checkpoints.
+  using PhaseCallback = std::function<void(const PhaseEvent&)>;
+
+  // `camera` must outlive the service.
+  explicit RenderService(Camera* camera);
+  ~RenderService();
+
+  RenderService(const RenderService&) = delete;
+  RenderService& operator=(const RenderService&) = delete;
+
+  // Replaces the current job, whose phase is interrupted, unless it is the
+  // first one, so resubmitting a job restarts it. The future is true once
+  // the job reaches its target samples per pixel, false if it is replaced
+  // or canceled before. Jobs replaced before they start are merged into the
+  // next one, which initializes the camera for both.
+  std::future<bool> Submit(const RenderJob& job,
+                           PhaseCallback on_phase = nullptr);
+  // Stops the current job, if any, keeping its image.
+  void Cancel();
+
+  // Runs `function` while the render thread neither initializes the camera
+  // nor starts a phase, though a phase may be rendering meanwhile: the
+  // image, settings and tonemapping of the camera are safe to use.
+  void WithCamera(const std::function<void(Camera*)>& function);
+
+  // Whether a job is pending or rendering.
+  bool is_busy();
+
+ private:
+  void Run(std::stop_token token);
+
+  Camera* camera_;
+  std::mutex mutex_;
+  std::condition_variable_any condition_;
+  bool has_pending_job_ = false;
+  RenderJob pending_job_;
+  PhaseCallback pending_on_phase_;
+  std::promise<bool> pending_done_;
+  bool is_rendering_job_ = false;
+  bool is_cancel_requested_ = false;
+  // Interrupts the phase being rendered.
+  std::stop_source phase_stop_source_;
+  std::jthread thread_;
+};
+
+#endif  // PEWPEW_RENDER_SERVICE_H_
\ No newline at end of file
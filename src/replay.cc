@@ -0,0 +1,274 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "app.h"
+#include "app_settings.h"
+#include "render_service.h"
+
+namespace {
+
+struct Setting {
+  const char* name;
+  int num_values;
+  SettingsUpdateType update_type;
+  void (*apply)(const float* values, AppSettings* settings);
+};
+
+// Those of the debug window that restart the render. Booleans are 0 or 1.
+const Setting kSettings[] = {
+    {"image_scale_factor", 1, SettingsUpdateType::kUpdateTextureAndSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->image_scale_factor = std::max(values[0], 0.1f);
+     }},
+    {"samples_per_pixel_log2", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->samples_per_pixel_log2 =
+           std::clamp(static_cast<int>(values[0]), 0, 12);
+     }},
+    {"max_depth_log2", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->max_depth_log2 =
+           std::clamp(static_cast<int>(values[0]), 0, 30);
+     }},
+    {"sampler", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->sampler_type = std::clamp(static_cast<int>(values[0]), 0, 3);
+     }},
+    // 0 disables time-budgeted phases.
+    {"phase_time_budget_ms", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->enable_time_budget = values[0] > 0;
+       if (settings->enable_time_budget) {
+         settings->phase_time_budget_ms = values[0];
+       }
+     }},
+    {"fov", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->fov = std::clamp(values[0], 1.0f, 179.0f);
+     }},
+    {"look_from", 3, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       std::copy(values, values + 3, settings->look_from);
+     }},
+    {"look_at", 3, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       std::copy(values, values + 3, settings->look_at);
+     }},
+    {"view_up", 3, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       std::copy(values, values + 3, settings->view_up);
+     }},
+    {"defocus_angle", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->defocus_angle = std::clamp(values[0], 0.0f, 179.0f);
+     }},
+    {"focus_distance", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->focus_distance = std::max(values[0], 0.1f);
+     }},
+    // Fractions of the image, as `--region`. A width of 0 clears it.
+    {"region", 4, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       std::copy(values, values + 4, settings->region);
+     }},
+    {"denoiser", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->enable_denoiser = values[0] != 0;
+     }},
+    {"path_guiding", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->enable_path_guiding = values[0] != 0;
+     }},
+    {"primary_hit_cache", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->enable_primary_hit_cache = values[0] != 0;
+     }},
+    {"preview", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->enable_preview = values[0] != 0;
+     }},
+    {"sky", 1, SettingsUpdateType::kUpdateSettings,
+     [](const float* values, AppSettings* settings) {
+       settings->enable_sky = values[0] != 0;
+     }},
+};
+
+const Setting* FindSetting(std::string_view name) {
+  for (const Setting& setting : kSettings) {
+    if (name == setting.name) {
+      return &setting;
+    }
+  }
+  return nullptr;
+}
+
+// Comma-separated.
+bool ParseValues(const std::string& text, std::vector<float>* values) {
+  values->clear();
+  const char* begin = text.c_str();
+  while (true) {
+    char* end;
+    values->push_back(std::strtof(begin, &end));
+    if (end == begin || (*end != ',' && *end != '\0')) {
+      return false;
+    }
+    if (*end == '\0') {
+      return true;
+    }
+    begin = end + 1;
+  }
+}
+
+void PrintLatencies(const std::string& name, std::vector<double> latencies) {
+  std::cout << name << ": ";
+  if (latencies.empty()) {
+    std::cout << "no edits shown" << std::endl;
+    return;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  // Nearest rank.
+  auto percentile = [&latencies](double fraction) {
+    const size_t rank = std::ceil(fraction * latencies.size());
+    return latencies[std::clamp<size_t>(rank, 1, latencies.size()) - 1];
+  };
+  std::cout << std::fixed << std::setprecision(1) << "p50 " << percentile(0.5)
+            << "ms, p90 " << percentile(0.9) << "ms, p99 "
+            << percentile(0.99) << "ms, max " << latencies.back()
+            << "ms over " << latencies.size() << " edits" << std::endl;
+}
+
+}  // namespace
+
+bool ReadReplayScript(const std::string& path,
+                      std::vector<ReplayEdit>* edits) {
+  std::ifstream file{path};
+  if (!file) {
+    std::cerr << "Error opening " << path << std::endl;
+    return false;
+  }
+
+  edits->clear();
+  std::string line;
+  for (int line_number = 1; std::getline(file, line); line_number++) {
+    std::istringstream stream{line};
+    ReplayEdit edit;
+    std::string values;
+    if (!(stream >> edit.delay_ms)) {
+      // Blank lines and comments.
+      stream.clear();
+      std::string first_word;
+      if (!(stream >> first_word) || first_word.starts_with('#')) {
+        continue;
+      }
+      std::cerr << path << ":" << line_number << ": expected a delay"
+                << std::endl;
+      return false;
+    }
+
+    std::string extra;
+    const Setting* setting = nullptr;
+    if (stream >> edit.setting >> values && !(stream >> extra)) {
+      setting = FindSetting(edit.setting);
+    }
+    if (setting == nullptr || edit.delay_ms < 0 ||
+        !ParseValues(values, &edit.values) ||
+        static_cast<int>(edit.values.size()) != setting->num_values) {
+      std::cerr << path << ":" << line_number
+                << ": expected a delay, a setting and its values" << std::endl;
+      return false;
+    }
+    edits->push_back(edit);
+  }
+  return true;
+}
+
+SettingsUpdateType Replay::Advance(AppSettings* settings) {
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  if (!is_started_) {
+    edit_time_ = now;
+    is_started_ = true;
+  }
+  if (num_applied_edits_ == edits_.size()) {
+    return SettingsUpdateType::kNoUpdates;
+  }
+
+  // An edit at a time, so that each restarts the render.
+  const ReplayEdit& edit = edits_[num_applied_edits_];
+  if (now - edit_time_ <
+      std::chrono::duration<double, std::milli>(edit.delay_ms)) {
+    return SettingsUpdateType::kNoUpdates;
+  }
+
+  num_unshown_phases_ += !has_shown_phase_;
+  num_unshown_samples_ += !has_shown_samples_;
+  const Setting* setting = FindSetting(edit.setting);
+  setting->apply(edit.values.data(), settings);
+  num_applied_edits_++;
+  edit_time_ = now;
+  has_shown_phase_ = false;
+  has_shown_samples_ = false;
+  return setting->update_type;
+}
+
+RenderService::PhaseCallback Replay::MakePhaseCallback() {
+  // Phases run one after the other, so those of the jobs of earlier edits
+  // report before those of later ones.
+  return [this, edit = num_applied_edits_](const PhaseEvent& event) {
+    phase_edit_ = edit;
+    if (event.accumulated_samples_per_pixel >= samples_per_pixel_ ||
+        event.is_done) {
+      samples_edit_ = edit;
+    }
+  };
+}
+
+void Replay::StartFrame() {
+  frame_has_phase_ =
+      num_applied_edits_ > 0 && phase_edit_ == num_applied_edits_;
+  frame_has_samples_ =
+      num_applied_edits_ > 0 && samples_edit_ == num_applied_edits_;
+}
+
+void Replay::FinishFrame() {
+  const double latency =
+      std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - edit_time_)
+          .count();
+  if (frame_has_phase_ && !has_shown_phase_) {
+    phase_latencies_.push_back(latency);
+    has_shown_phase_ = true;
+  }
+  if (frame_has_samples_ && !has_shown_samples_) {
+    samples_latencies_.push_back(latency);
+    has_shown_samples_ = true;
+  }
+}
+
+bool Replay::done() const {
+  return num_applied_edits_ == edits_.size() && has_shown_samples_;
+}
+
+void Replay::PrintReport() const {
+  PrintLatencies("Edit to first pixel", phase_latencies_);
+  PrintLatencies("Edit to " + std::to_string(samples_per_pixel_) + " spp",
+                 samples_latencies_);
+  if (num_unshown_samples_ > 0) {
+    std::cout << "Replaced before showing: " << num_unshown_phases_
+              << " edits at first, " << num_unshown_samples_ << " at "
+              << samples_per_pixel_ << " spp" << std::endl;
+  }
+}
\ No newline at end of file
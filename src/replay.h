@@ -0,0 +1,75 @@
+#ifndef PEWPEW_REPLAY_H_
+#define PEWPEW_REPLAY_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "app.h"
+#include "app_settings.h"
+#include "render_service.h"
+
+// Sets a setting of the app to `values`, `delay_ms` after the previous edit
+// of a replay, or after the first frame.
+struct ReplayEdit {
+  double delay_ms;
+  std::string setting;
+  std::vector<float> values;
+};
+
+// Reads a replay script, with one edit per line: a delay, a setting and its
+// values, e.g. "250 look_from 13,2,3". Lines starting with '#' are comments.
+// Prints an error and returns false on unknown settings.
+bool ReadReplayScript(const std::string& path, std::vector<ReplayEdit>* edits);
+
+// Replays edits in the app, as if made in its debug window, and measures how
+// long each takes to show: until the first frame that shows a phase or
+// preview rendered with it, and until the first that shows
+// `samples_per_pixel` samples per pixel, or as many as the render has.
+// Edits replaced before showing are counted apart.
+class Replay {
+ public:
+  Replay(std::vector<ReplayEdit> edits, int samples_per_pixel)
+      : edits_(std::move(edits)), samples_per_pixel_(samples_per_pixel) {}
+
+  // Applies the edits that are due to `settings`, and returns the update they
+  // need.
+  SettingsUpdateType Advance(AppSettings* settings);
+  // For the jobs submitted after edits. Called on the render thread.
+  RenderService::PhaseCallback MakePhaseCallback();
+  // Called before a frame copies the image, and after it is presented.
+  void StartFrame();
+  void FinishFrame();
+
+  // Whether every edit was applied, and the last one shown.
+  bool done() const;
+  void PrintReport() const;
+
+ private:
+  std::vector<ReplayEdit> edits_;
+  int samples_per_pixel_;
+  size_t num_applied_edits_ = 0;
+  bool is_started_ = false;
+  // Of the last edit, or of the first frame.
+  std::chrono::steady_clock::time_point edit_time_;
+  // The last edits, counted from 1, that rendered a phase, and the samples
+  // per pixel. Set by the render thread.
+  std::atomic<size_t> phase_edit_ = 0;
+  std::atomic<size_t> samples_edit_ = 0;
+  // As of the start of the frame.
+  bool frame_has_phase_ = false;
+  bool frame_has_samples_ = false;
+  bool has_shown_phase_ = true;
+  bool has_shown_samples_ = true;
+  // In milliseconds.
+  std::vector<double> phase_latencies_;
+  std::vector<double> samples_latencies_;
+  // Replaced before showing at first, and with the samples per pixel.
+  int num_unshown_phases_ = 0;
+  int num_unshown_samples_ = 0;
+};
+
+#endif  // PEWPEW_REPLAY_H_
\ No newline at end of file
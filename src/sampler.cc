@@ -0,0 +1,290 @@
+#include "sampler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "float.h"
+#include "utils.h"
+
+namespace {
+
+uint32_t Hash(uint64_t a, uint64_t b) {
+  return static_cast<uint32_t>(HashSeed(HashSeed(a) ^ b));
+}
+
+uint64_t PixelSeed(int i, int j) {
+  return HashSeed((static_cast<uint64_t>(j) << 32) | static_cast<uint32_t>(i));
+}
+
+// Maps 32 random bits to [0, 1), keeping the 24 bits a float can represent.
+Float ToFloat(uint32_t bits) { return (bits >> 8) * 0x1p-24f; }
+
+// Rounding may push values close to 1 up to 1 itself.
+Float ClampBelowOne(Float value) {
+  return std::min(value, std::nextafter(Float{1}, Float{0}));
+}
+
+Float Fraction(double value) {
+  return ClampBelowOne(value - std::floor(value));
+}
+
+uint32_t ReverseBits(uint32_t x) {
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+  x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+// Hash-based Owen scrambling, from Burley's "Practical Hash-based Owen
+// Scrambling" (JCGT 2020).
+uint32_t LaineKarrasPermutation(uint32_t x, uint32_t seed) {
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+  return x;
+}
+
+uint32_t NestedUniformScramble(uint32_t x, uint32_t seed) {
+  return ReverseBits(LaineKarrasPermutation(ReverseBits(x), seed));
+}
+
+uint32_t SobolSecondDimension(uint32_t index) {
+  uint32_t result = 0;
+  for (uint32_t v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1) {
+    if (index & 1) {
+      result ^= v;
+    }
+  }
+  return result;
+}
+
+// Kensler's hash-based permutation, from "Correlated Multi-Jittered
+// Sampling". With a power-of-two length, it never needs to cycle-walk.
+uint32_t Permute(uint32_t i, uint32_t mask, uint32_t seed) {
+  i ^= seed;
+  i *= 0xe170893du;
+  i ^= seed >> 16;
+  i ^= (i & mask) >> 4;
+  i ^= seed >> 8;
+  i *= 0x0929eb3fu;
+  i ^= seed >> 23;
+  i ^= (i & mask) >> 1;
+  i *= 1 | seed >> 27;
+  i *= 0x6935fa69u;
+  i ^= (i & mask) >> 11;
+  i *= 0x74dcb303u;
+  i ^= (i & mask) >> 2;
+  i *= 0x9e501cc3u;
+  i ^= (i & mask) >> 2;
+  i *= 0xc860a3dfu;
+  i &= mask;
+  i ^= i >> 5;
+  return (i + seed) & mask;
+}
+
+class IndependentSampler : public Sampler {
+ public:
+  void StartPixelSample(int i, int j, int sample_index) override {
+    SeedRandom(PixelSeed(i, j), sample_index);
+  }
+
+  Float Get1D() override { return RandomFloat(); }
+
+  Sample2D Get2D() override {
+    const Float u = RandomFloat();
+    return Sample2D{u, RandomFloat()};
+  }
+};
+
+// Jitters the samples of a pixel within a grid of strata. Each dimension
+// shuffles the strata differently, so that dimensions stay uncorrelated.
+class StratifiedSampler : public Sampler {
+ public:
+  StratifiedSampler(int samples_per_pixel)
+      : samples_per_pixel_(samples_per_pixel),
+        strata_x_(1 << (std::countr_zero(
+                            static_cast<unsigned>(samples_per_pixel)) /
+                        2)),
+        strata_y_(samples_per_pixel / strata_x_) {}
+
+  void StartPixelSample(int i, int j, int sample_index) override {
+    pixel_seed_ = PixelSeed(i, j);
+    sample_index_ = sample_index & (samples_per_pixel_ - 1);
+    dimension_ = 0;
+  }
+
+  Float Get1D() override {
+    const uint32_t seed = Hash(pixel_seed_, dimension_++);
+    const uint32_t stratum =
+        Permute(sample_index_, samples_per_pixel_ - 1, seed);
+    const Float jitter = ToFloat(Hash(seed, sample_index_));
+    return ClampBelowOne((stratum + jitter) / samples_per_pixel_);
+  }
+
+  Sample2D Get2D() override {
+    const uint32_t seed = Hash(pixel_seed_, dimension_++);
+    const uint32_t stratum =
+        Permute(sample_index_, samples_per_pixel_ - 1, seed);
+    const Float jitter_u = ToFloat(Hash(seed, 2 * sample_index_));
+    const Float jitter_v = ToFloat(Hash(seed, 2 * sample_index_ + 1));
+    const Float u = (stratum % strata_x_ + jitter_u) / strata_x_;
+    const Float v = (stratum / strata_x_ + jitter_v) / strata_y_;
+    return Sample2D{ClampBelowOne(u), ClampBelowOne(v)};
+  }
+
+ private:
+  int samples_per_pixel_;
+  int strata_x_;
+  int strata_y_;
+  uint64_t pixel_seed_;
+  uint32_t sample_index_;
+  uint32_t dimension_;
+};
+
+// Owen-scrambled Sobol points, with an independent scramble per pixel and
+// per dimension. Every power-of-two prefix of the sequence is well
+// stratified, which suits progressive phases.
+class SobolSampler : public Sampler {
+ public:
+  void StartPixelSample(int i, int j, int sample_index) override {
+    pixel_seed_ = PixelSeed(i, j);
+    sample_index_ = sample_index;
+    dimension_ = 0;
+  }
+
+  Float Get1D() override {
+    const uint32_t seed = Hash(pixel_seed_, dimension_++);
+    const uint32_t index = NestedUniformScramble(sample_index_, seed);
+    return ToFloat(NestedUniformScramble(ReverseBits(index), Hash(seed, 1)));
+  }
+
+  Sample2D Get2D() override {
+    const uint32_t seed = Hash(pixel_seed_, dimension_++);
+    const uint32_t index = NestedUniformScramble(sample_index_, seed);
+    return Sample2D{
+        ToFloat(NestedUniformScramble(ReverseBits(index), Hash(seed, 1))),
+        ToFloat(NestedUniformScramble(SobolSecondDimension(index),
+                                      Hash(seed, 2)))};
+  }
+
+ private:
+  uint64_t pixel_seed_;
+  uint32_t sample_index_;
+  uint32_t dimension_;
+};
+
+const int kBlueNoiseSize = 64;
+
+// Ranks the texels of a tileable texture by inserting them one at a time in
+// the largest void left, which is the void-and-cluster method without its
+// initial pattern. Thresholding the ranks at any level gives blue noise.
+std::vector<Float> GenerateBlueNoise() {
+  const int size = kBlueNoiseSize;
+  const int num_texels = size * size;
+  const Float sigma = 1.5;
+
+  std::vector<Float> kernel(num_texels);
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      const int dx = std::min(x, size - x);
+      const int dy = std::min(y, size - y);
+      kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) /
+                                      (2 * sigma * sigma));
+    }
+  }
+
+  // Tiny perturbations break the ties of the empty texture.
+  std::vector<Float> energy(num_texels);
+  for (int index = 0; index < num_texels; index++) {
+    energy[index] = 1e-3 * ToFloat(Hash(index, 0));
+  }
+
+  std::vector<bool> is_set(num_texels, false);
+  std::vector<Float> texture(num_texels);
+  for (int rank = 0; rank < num_texels; rank++) {
+    int best = -1;
+    for (int index = 0; index < num_texels; index++) {
+      if (!is_set[index] && (best < 0 || energy[index] < energy[best])) {
+        best = index;
+      }
+    }
+
+    is_set[best] = true;
+    texture[best] = (rank + 0.5) / num_texels;
+
+    const int best_x = best % size;
+    const int best_y = best / size;
+    for (int y = 0; y < size; y++) {
+      for (int x = 0; x < size; x++) {
+        const int kernel_x = (x - best_x) & (size - 1);
+        const int kernel_y = (y - best_y) & (size - 1);
+        energy[y * size + x] += kernel[kernel_y * size + kernel_x];
+      }
+    }
+  }
+
+  return texture;
+}
+
+Float BlueNoise(int x, int y) {
+  static const std::vector<Float> texture = GenerateBlueNoise();
+  return texture[(y & (kBlueNoiseSize - 1)) * kBlueNoiseSize +
+                 (x & (kBlueNoiseSize - 1))];
+}
+
+// Rank-1 lattices (golden ratio and R2 sequences) shared by all pixels, and
+// offset per pixel by a blue noise texture (a Cranley-Patterson rotation).
+// Errors of neighboring pixels are then negatively correlated, which looks
+// like high frequency noise at low sample counts.
+class BlueNoiseSampler : public Sampler {
+ public:
+  void StartPixelSample(int i, int j, int sample_index) override {
+    i_ = i;
+    j_ = j;
+    sample_index_ = sample_index;
+    dimension_ = 0;
+  }
+
+  Float Get1D() override {
+    const uint32_t seed = Hash(dimension_++, 0);
+    const Float offset = BlueNoise(i_ + seed, j_ + (seed >> 8));
+    return Fraction(offset + sample_index_ * 0.6180339887498949);
+  }
+
+  Sample2D Get2D() override {
+    const uint32_t seed = Hash(dimension_++, 0);
+    const Float offset_u = BlueNoise(i_ + seed, j_ + (seed >> 8));
+    const Float offset_v = BlueNoise(i_ + (seed >> 16), j_ + (seed >> 24));
+    return Sample2D{Fraction(offset_u + sample_index_ * 0.7548776662466927),
+                    Fraction(offset_v + sample_index_ * 0.5698402909980532)};
+  }
+
+ private:
+  int i_;
+  int j_;
+  uint32_t sample_index_;
+  uint32_t dimension_;
+};
+
+}  // namespace
+
+std::unique_ptr<Sampler> MakeSampler(SamplerType type, int samples_per_pixel) {
+  switch (type) {
+    case SamplerType::kStratified:
+      return std::make_unique<StratifiedSampler>(samples_per_pixel);
+    case SamplerType::kSobol:
+      return std::make_unique<SobolSampler>();
+    case SamplerType::kBlueNoise:
+      return std::make_unique<BlueNoiseSampler>();
+    case SamplerType::kIndependent:
+    default:
+      return std::make_unique<IndependentSampler>();
+  }
+}
\ No newline at end of file
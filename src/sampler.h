@@ -0,0 +1,37 @@
+#ifndef PEWPEW_SAMPLER_H_
+#define PEWPEW_SAMPLER_H_
+
+#include <memory>
+
+#include "float.h"
+
+enum class SamplerType {
+  kIndependent,
+  kStratified,
+  kSobol,
+  kBlueNoise,
+};
+
+struct Sample2D {
+  Float u;
+  Float v;
+};
+
+// Generates the random numbers of a pixel sample, one dimension after the
+// other: pixel jitter, lens position, then the BSDF samples of each bounce.
+// Samples only depend on their pixel and sample index, so renders stay
+// deterministic whichever thread or process computes them.
+class Sampler {
+ public:
+  virtual ~Sampler() = default;
+
+  virtual void StartPixelSample(int i, int j, int sample_index) = 0;
+  virtual Float Get1D() = 0;
+  virtual Sample2D Get2D() = 0;
+};
+
+// Samplers are stateful, so each rendering thread needs its own.
+// `samples_per_pixel` must be a power of two.
+std::unique_ptr<Sampler> MakeSampler(SamplerType type, int samples_per_pixel);
+
+#endif  // PEWPEW_SAMPLER_H_
\ No newline at end of file
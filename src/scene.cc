@@ -0,0 +1,353 @@
+#include "scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "bvh.h"
+#include "color.h"
+#include "constant_medium.h"
+#include "dielectric.h"
+#include "diffuse_light.h"
+#include "environment_map.h"
+#include "float.h"
+#include "grid_medium.h"
+#include "image_texture.h"
+#include "isotropic.h"
+#include "lambertian.h"
+#include "material.h"
+#include "metal.h"
+#include "noise_texture.h"
+#include "perlin.h"
+#include "quad.h"
+#include "sphere.h"
+#include "texture.h"
+#include "texture_cache.h"
+#include "utils.h"
+#include "vec3.h"
+#include "wide_bvh.h"
+
+namespace {
+
+// The final scene of the first book.
+void BuildRandomSpheresScene(Scene* scene) {
+  scene->view = SceneView{
+      .fov = 20.0f,
+      .look_from = {13.0f, 2.0f, 3.0f},
+      .look_at = {0.0f, 0.0f, 0.0f},
+      .defocus_angle = 0.6f,
+      .focus_distance = 10.0f,
+      .enable_sky = true,
+  };
+
+  const uint64_t scene_seed = 42;
+  SeedRandom(scene_seed, /*stream=*/0);
+
+  HittableList& world = scene->world;
+  std::vector<std::unique_ptr<Material>>& materials = scene->materials;
+
+  materials.push_back(std::make_unique<Lambertian>(Color{0.5, 0.5, 0.5}));
+  world.Add(std::make_shared<Sphere>(Point3{0, -1000, 0}, 1000,
+                                     materials.back().get()));
+
+  for (int a = -11; a < 11; a++) {
+    for (int b = -11; b < 11; b++) {
+      Float choose_mat = RandomFloat();
+      Float center_x = a + 0.9 * RandomFloat();
+      Float center_z = b + 0.9 * RandomFloat();
+      Point3 center{center_x, 0.2, center_z};
+
+      if ((center - Point3{4, 0.2, 0}).length() > 0.9) {
+        if (choose_mat < 0.8) {
+          // Diffuse.
+          Color albedo = Color::Random() * Color::Random();
+          materials.push_back(std::make_unique<Lambertian>(albedo));
+          world.Add(
+              std::make_shared<Sphere>(center, 0.2, materials.back().get()));
+        } else if (choose_mat < 0.95) {
+          // Metal.
+          Color albedo = Color::Random(0.5, 1);
+          Float fuzz = RandomFloat(0, 0.5);
+          materials.push_back(std::make_unique<Metal>(albedo, fuzz));
+          world.Add(
+              std::make_shared<Sphere>(center, 0.2, materials.back().get()));
+        } else {
+          // Glass.
+          materials.push_back(std::make_unique<Dielectric>(1.5));
+          world.Add(
+              std::make_shared<Sphere>(center, 0.2, materials.back().get()));
+        }
+      }
+    }
+  }
+
+  materials.push_back(std::make_unique<Dielectric>(1.5));
+  world.Add(
+      std::make_shared<Sphere>(Point3{0, 1, 0}, 1.0, materials.back().get()));
+
+  materials.push_back(std::make_unique<Lambertian>(Color{0.4, 0.2, 0.1}));
+  world.Add(
+      std::make_shared<Sphere>(Point3{-4, 1, 0}, 1.0, materials.back().get()));
+
+  materials.push_back(std::make_unique<Metal>(Color{0.7, 0.6, 0.5}, 0.0));
+  world.Add(
+      std::make_shared<Sphere>(Point3{4, 1, 0}, 1.0, materials.back().get()));
+}
+
+bool BuildEarthScene(const SceneOptions& options, Scene* scene) {
+  scene->view = SceneView{
+      .fov = 20.0f,
+      .look_from = {0.0f, 0.0f, 12.0f},
+      .look_at = {0.0f, 0.0f, 0.0f},
+      .defocus_angle = 0.0f,
+      .focus_distance = 10.0f,
+      .enable_sky = true,
+  };
+
+  if (options.texture_path.empty()) {
+    std::cerr << "The earth scene needs a --texture" << std::endl;
+    return false;
+  }
+  scene->texture_cache =
+      std::make_unique<TextureCache>(options.texture_cache_bytes);
+  std::unique_ptr<ImageTexture> texture =
+      ImageTexture::Load(options.texture_path, scene->texture_cache.get());
+  if (texture == nullptr) {
+    return false;
+  }
+  scene->textures.push_back(std::move(texture));
+
+  scene->materials.push_back(
+      std::make_unique<Lambertian>(scene->textures.back().get()));
+  scene->world.Add(std::make_shared<Sphere>(Point3{0, 0, 0}, 2,
+                                            scene->materials.back().get()));
+  return true;
+}
+
+// Two spheres of marble, from the second book.
+void BuildPerlinSpheresScene(Scene* scene) {
+  scene->view = SceneView{
+      .fov = 20.0f,
+      .look_from = {13.0f, 2.0f, 3.0f},
+      .look_at = {0.0f, 0.0f, 0.0f},
+      .defocus_angle = 0.0f,
+      .focus_distance = 10.0f,
+      .enable_sky = true,
+  };
+
+  const uint64_t noise_seed = 42;
+  scene->textures.push_back(
+      std::make_unique<NoiseTexture>(NoisePattern::kMarble, 4, noise_seed));
+  scene->materials.push_back(
+      std::make_unique<Lambertian>(scene->textures.back().get()));
+  scene->world.Add(std::make_shared<Sphere>(Point3{0, -1000, 0}, 1000,
+                                            scene->materials.back().get()));
+  scene->world.Add(std::make_shared<Sphere>(Point3{0, 2, 0}, 2,
+                                            scene->materials.back().get()));
+}
+
+// A smoke ball next to glass and a cloud of turbulence, with the camera of
+// the random spheres.
+void BuildFogScene(Scene* scene) {
+  scene->view = SceneView{
+      .fov = 20.0f,
+      .look_from = {13.0f, 2.0f, 3.0f},
+      .look_at = {0.0f, 0.0f, 0.0f},
+      .defocus_angle = 0.0f,
+      .focus_distance = 10.0f,
+      .enable_sky = true,
+  };
+
+  std::vector<std::unique_ptr<Material>>& materials = scene->materials;
+  HittableList& world = scene->world;
+  materials.push_back(std::make_unique<Lambertian>(Color{0.5, 0.5, 0.5}));
+  world.Add(std::make_shared<Sphere>(Point3{0, -1000, 0}, 1000,
+                                     materials.back().get()));
+  materials.push_back(std::make_unique<Dielectric>(1.5));
+  world.Add(
+      std::make_shared<Sphere>(Point3{4, 1, 0}, 1.0, materials.back().get()));
+
+  materials.push_back(std::make_unique<Isotropic>(Color{0.9, 0.6, 0.3}));
+  world.Add(std::make_shared<ConstantMedium>(
+      std::make_shared<Sphere>(Point3{0, 1, 0}, 1.0, nullptr), 2,
+      materials.back().get()));
+
+  // Turbulence above a threshold, fading out towards the edges of the box.
+  const int resolution = 64;
+  const uint64_t noise_seed = 7;
+  const Perlin noise{noise_seed};
+  std::vector<float> densities;
+  densities.reserve((resolution + 1) * (resolution + 1) * (resolution + 1));
+  for (int z = 0; z <= resolution; z++) {
+    for (int y = 0; y <= resolution; y++) {
+      for (int x = 0; x <= resolution; x++) {
+        const Point3 p = Point3{static_cast<Float>(x), static_cast<Float>(y),
+                                static_cast<Float>(z)} /
+                         resolution;
+        const Vec3 from_center = p - Point3{0.5, 0.5, 0.5};
+        const Float falloff =
+            std::max<Float>(0, 1 - 4 * from_center.length_squared());
+        const Float turbulence = noise.Turbulence(4 * p, 5);
+        densities.push_back(
+            static_cast<float>(std::max<Float>(0, turbulence - 0.2) * 20 *
+                               falloff));
+      }
+    }
+  }
+  materials.push_back(std::make_unique<Isotropic>(Color{0.8, 0.8, 0.8}));
+  world.Add(std::make_shared<GridMedium>(Point3{-5, 0.5, -3},
+                                         Point3{-1, 3.5, 3}, resolution,
+                                         std::move(densities),
+                                         materials.back().get()));
+}
+
+// The Cornell box of the second book, lit only by the quad in its ceiling.
+void BuildCornellBoxScene(Scene* scene) {
+  scene->view = SceneView{
+      .fov = 40.0f,
+      .look_from = {278.0f, 278.0f, -800.0f},
+      .look_at = {278.0f, 278.0f, 0.0f},
+      .defocus_angle = 0.0f,
+      .focus_distance = 10.0f,
+      .enable_sky = false,
+  };
+
+  std::vector<std::unique_ptr<Material>>& materials = scene->materials;
+  HittableList& world = scene->world;
+  materials.push_back(std::make_unique<Lambertian>(Color{0.65, 0.05, 0.05}));
+  Material* red = materials.back().get();
+  materials.push_back(std::make_unique<Lambertian>(Color{0.73, 0.73, 0.73}));
+  Material* white = materials.back().get();
+  materials.push_back(std::make_unique<Lambertian>(Color{0.12, 0.45, 0.15}));
+  Material* green = materials.back().get();
+
+  world.Add(std::make_shared<Quad>(Point3{555, 0, 0}, Vec3{0, 555, 0},
+                                   Vec3{0, 0, 555}, green));
+  world.Add(std::make_shared<Quad>(Point3{0, 0, 0}, Vec3{0, 555, 0},
+                                   Vec3{0, 0, 555}, red));
+  world.Add(std::make_shared<Quad>(Point3{0, 0, 0}, Vec3{555, 0, 0},
+                                   Vec3{0, 0, 555}, white));
+  world.Add(std::make_shared<Quad>(Point3{555, 555, 555}, Vec3{-555, 0, 0},
+                                   Vec3{0, 0, -555}, white));
+  world.Add(std::make_shared<Quad>(Point3{0, 0, 555}, Vec3{555, 0, 0},
+                                   Vec3{0, 555, 0}, white));
+  world.Add(std::make_shared<Sphere>(Point3{190, 90, 190}, 90, white));
+  materials.push_back(std::make_unique<Dielectric>(1.5));
+  world.Add(std::make_shared<Sphere>(Point3{370, 90, 370}, 90,
+                                     materials.back().get()));
+
+  const Color emission{15, 15, 15};
+  materials.push_back(std::make_unique<DiffuseLight>(emission));
+  const std::shared_ptr<Quad> light =
+      std::make_shared<Quad>(Point3{343, 554, 332}, Vec3{-130, 0, 0},
+                             Vec3{0, 0, -105}, materials.back().get());
+  world.Add(light);
+  scene->lights.Add(light, emission);
+}
+
+// The layout of the random spheres at night, the small spheres glowing with
+// powers spread over two orders of magnitude.
+void BuildManyLightsScene(Scene* scene) {
+  scene->view = SceneView{
+      .fov = 20.0f,
+      .look_from = {13.0f, 2.0f, 3.0f},
+      .look_at = {0.0f, 0.0f, 0.0f},
+      .defocus_angle = 0.0f,
+      .focus_distance = 10.0f,
+      .enable_sky = false,
+  };
+
+  const uint64_t scene_seed = 42;
+  SeedRandom(scene_seed, /*stream=*/0);
+
+  HittableList& world = scene->world;
+  std::vector<std::unique_ptr<Material>>& materials = scene->materials;
+
+  materials.push_back(std::make_unique<Lambertian>(Color{0.5, 0.5, 0.5}));
+  world.Add(std::make_shared<Sphere>(Point3{0, -1000, 0}, 1000,
+                                     materials.back().get()));
+
+  for (int a = -11; a < 11; a++) {
+    for (int b = -11; b < 11; b++) {
+      const Float center_x = a + 0.9 * RandomFloat();
+      const Float center_z = b + 0.9 * RandomFloat();
+      const Point3 center{center_x, 0.2, center_z};
+      if ((center - Point3{4, 0.2, 0}).length() <= 0.9) {
+        continue;
+      }
+      const Color emission =
+          Color::Random(0.2, 1) * std::pow(Float{10}, RandomFloat(-1, 1));
+      materials.push_back(std::make_unique<DiffuseLight>(emission));
+      const std::shared_ptr<Sphere> light =
+          std::make_shared<Sphere>(center, 0.2, materials.back().get());
+      world.Add(light);
+      scene->lights.Add(light, emission);
+    }
+  }
+
+  materials.push_back(std::make_unique<Dielectric>(1.5));
+  world.Add(
+      std::make_shared<Sphere>(Point3{0, 1, 0}, 1.0, materials.back().get()));
+
+  materials.push_back(std::make_unique<Lambertian>(Color{0.4, 0.2, 0.1}));
+  world.Add(
+      std::make_shared<Sphere>(Point3{-4, 1, 0}, 1.0, materials.back().get()));
+
+  materials.push_back(std::make_unique<Metal>(Color{0.7, 0.6, 0.5}, 0.0));
+  world.Add(
+      std::make_shared<Sphere>(Point3{4, 1, 0}, 1.0, materials.back().get()));
+}
+
+}  // namespace
+
+bool BuildScene(const SceneOptions& options, Scene* scene) {
+  bool success = true;
+  switch (options.type) {
+    case SceneType::kRandomSpheres:
+      BuildRandomSpheresScene(scene);
+      break;
+    case SceneType::kEarth:
+      success = BuildEarthScene(options, scene);
+      break;
+    case SceneType::kPerlinSpheres:
+      BuildPerlinSpheresScene(scene);
+      break;
+    case SceneType::kFog:
+      BuildFogScene(scene);
+      break;
+    case SceneType::kCornellBox:
+      BuildCornellBoxScene(scene);
+      break;
+    case SceneType::kManyLights:
+      BuildManyLightsScene(scene);
+      break;
+  }
+  if (!success) {
+    return false;
+  }
+
+  if (!options.environment_path.empty()) {
+    scene->environment = EnvironmentMap::Load(options.environment_path);
+    if (scene->environment == nullptr) {
+      return false;
+    }
+    scene->lights.set_environment(scene->environment.get());
+  }
+  scene->lights.Build();
+
+  switch (options.bvh) {
+    case BvhType::kNone:
+      break;
+    case BvhType::kBinary:
+      scene->bvh = std::make_unique<Bvh>(scene->world.objects());
+      break;
+    case BvhType::kWide:
+      scene->bvh = std::make_unique<WideBvh>(Bvh{scene->world.objects()});
+      break;
+  }
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef PEWPEW_SCENE_H_
+#define PEWPEW_SCENE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "environment_map.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "light_list.h"
+#include "material.h"
+#include "texture.h"
+#include "texture_cache.h"
+
+enum class SceneType {
+  kRandomSpheres,
+  kEarth,
+  kPerlinSpheres,
+  kFog,
+  kCornellBox,
+  kManyLights,
+};
+
+enum class BvhType {
+  // Rays are tested against every object.
+  kNone,
+  kBinary,
+  // Collapsed from the binary one, with quantized boxes.
+  kWide,
+};
+
+struct SceneOptions {
+  SceneType type;
+  BvhType bvh;
+  // The image wrapped around the globe of `kEarth`, as a binary PPM.
+  std::string texture_path;
+  size_t texture_cache_bytes;
+  // An HDR image lighting the scene from all around, in place of the sky, as
+  // a PFM or Radiance RGBE file. Optional.
+  std::string environment_path;
+};
+
+// Where the camera starts, in the units of `AppSettings`.
+struct SceneView {
+  float fov;
+  float look_from[3];
+  float look_at[3];
+  float defocus_angle;
+  float focus_distance;
+  // Whether rays that escape the scene see the sky, rather than black.
+  bool enable_sky;
+};
+
+struct Scene {
+  HittableList world;
+  // Over the objects of `world`, unless `BvhType::kNone`.
+  std::unique_ptr<Hittable> bvh;
+  // The emissive objects of `world`.
+  LightList lights;
+  std::vector<std::unique_ptr<Material>> materials;
+  std::vector<std::unique_ptr<Texture>> textures;
+  std::unique_ptr<TextureCache> texture_cache;
+  std::unique_ptr<EnvironmentMap> environment;
+  SceneView view;
+};
+
+// Builds the scene of `options.type`. Scenes are generated from fixed seeds,
+// so that every process of a distributed render agrees on them. Prints an
+// error and returns false if an input can't be loaded.
+bool BuildScene(const SceneOptions& options, Scene* scene);
+
+// What rays are traced against.
+inline const Hittable& SceneRoot(const Scene& scene) {
+  if (scene.bvh != nullptr) {
+    return *scene.bvh;
+  }
+  return scene.world;
+}
+
+#endif  // PEWPEW_SCENE_H_
\ No newline at end of file
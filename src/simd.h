@@ -0,0 +1,390 @@
+#ifndef PEWPEW_SIMD_H_
+#define PEWPEW_SIMD_H_
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define PEWPEW_SIMD_SSE
+// Division, square roots and rounding are only vector instructions on
+// AArch64, so 32-bit ARM takes the scalar fallback.
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define PEWPEW_SIMD_NEON
+#endif
+
+// Packs of 4 floats, backed by SSE or NEON when available, with a scalar
+// fallback. Comparisons return masks with all bits set in the lanes
+// where they hold, to be used with `Select` and `MoveMask`.
+//
+// Lanes are always single precision, whatever `Float` is.
+
+class FloatX4 {
+ public:
+  static constexpr int kWidth = 4;
+
+  FloatX4() = default;
+  FloatX4(float value) {
+#if defined(PEWPEW_SIMD_SSE)
+    v_ = _mm_set1_ps(value);
+#elif defined(PEWPEW_SIMD_NEON)
+    v_ = vdupq_n_f32(value);
+#else
+    for (int i = 0; i < kWidth; i++) {
+      v_[i] = value;
+    }
+#endif
+  }
+  FloatX4(float e0, float e1, float e2, float e3) {
+    const float e[kWidth] = {e0, e1, e2, e3};
+    *this = Load(e);
+  }
+
+  static FloatX4 Load(const float* values) {
+    FloatX4 result;
+#if defined(PEWPEW_SIMD_SSE)
+    result.v_ = _mm_loadu_ps(values);
+#elif defined(PEWPEW_SIMD_NEON)
+    result.v_ = vld1q_f32(values);
+#else
+    for (int i = 0; i < kWidth; i++) {
+      result.v_[i] = values[i];
+    }
+#endif
+    return result;
+  }
+
+  // The 4 bytes at `values`, as floats.
+  static FloatX4 LoadBytes(const uint8_t* values) {
+#if defined(PEWPEW_SIMD_SSE)
+    int32_t bytes;
+    std::memcpy(&bytes, values, sizeof(bytes));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero);
+    return FloatX4{_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero))};
+#else
+    return FloatX4{static_cast<float>(values[0]), static_cast<float>(values[1]),
+                   static_cast<float>(values[2]),
+                   static_cast<float>(values[3])};
+#endif
+  }
+
+  void Store(float* values) const {
+#if defined(PEWPEW_SIMD_SSE)
+    _mm_storeu_ps(values, v_);
+#elif defined(PEWPEW_SIMD_NEON)
+    vst1q_f32(values, v_);
+#else
+    for (int i = 0; i < kWidth; i++) {
+      values[i] = v_[i];
+    }
+#endif
+  }
+
+  float operator[](int lane) const {
+    float values[kWidth];
+    Store(values);
+    return values[lane];
+  }
+
+#if defined(PEWPEW_SIMD_SSE)
+  using Native = __m128;
+#elif defined(PEWPEW_SIMD_NEON)
+  using Native = float32x4_t;
+#endif
+
+#if defined(PEWPEW_SIMD_SSE) || defined(PEWPEW_SIMD_NEON)
+  explicit FloatX4(Native v) : v_(v) {}
+  Native native() const { return v_; }
+
+ private:
+  Native v_;
+#else
+  // The scalar fallback is used through the same operations as the
+  // intrinsics, which keeps the operators below free of special cases.
+  template <typename Operation>
+  static FloatX4 Map(const FloatX4& a, const FloatX4& b, Operation op) {
+    FloatX4 result;
+    for (int i = 0; i < kWidth; i++) {
+      result.v_[i] = op(a.v_[i], b.v_[i]);
+    }
+    return result;
+  }
+
+  static float MaskValue(bool value) {
+    const uint32_t bits = value ? 0xffffffffu : 0u;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+  }
+
+  static bool IsMaskSet(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 31) != 0;
+  }
+
+ private:
+  float v_[kWidth];
+#endif
+};
+
+#if defined(PEWPEW_SIMD_SSE)
+
+inline FloatX4 operator+(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_add_ps(a.native(), b.native())};
+}
+inline FloatX4 operator-(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_sub_ps(a.native(), b.native())};
+}
+inline FloatX4 operator*(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_mul_ps(a.native(), b.native())};
+}
+inline FloatX4 operator/(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_div_ps(a.native(), b.native())};
+}
+inline FloatX4 operator<(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_cmplt_ps(a.native(), b.native())};
+}
+inline FloatX4 operator<=(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_cmple_ps(a.native(), b.native())};
+}
+inline FloatX4 operator>(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_cmpgt_ps(a.native(), b.native())};
+}
+inline FloatX4 operator>=(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_cmpge_ps(a.native(), b.native())};
+}
+inline FloatX4 operator&(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_and_ps(a.native(), b.native())};
+}
+inline FloatX4 operator|(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_or_ps(a.native(), b.native())};
+}
+inline FloatX4 Min(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_min_ps(a.native(), b.native())};
+}
+inline FloatX4 Max(FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_max_ps(a.native(), b.native())};
+}
+inline FloatX4 Sqrt(FloatX4 a) { return FloatX4{_mm_sqrt_ps(a.native())}; }
+inline FloatX4 Floor(FloatX4 a) {
+#ifdef __SSE4_1__
+  return FloatX4{_mm_floor_ps(a.native())};
+#else
+  // Truncation rounds negative values up, which the comparison corrects.
+  const FloatX4 truncated{_mm_cvtepi32_ps(_mm_cvttps_epi32(a.native()))};
+  return truncated - (FloatX4{1.0f} & (truncated > a));
+#endif
+}
+// Selects `a` in the lanes set in `mask`, `b` elsewhere.
+inline FloatX4 Select(FloatX4 mask, FloatX4 a, FloatX4 b) {
+  return FloatX4{_mm_or_ps(_mm_and_ps(mask.native(), a.native()),
+                           _mm_andnot_ps(mask.native(), b.native()))};
+}
+// Returns one bit per lane, set if the lane is set in `mask`.
+inline int MoveMask(FloatX4 mask) { return _mm_movemask_ps(mask.native()); }
+inline FloatX4 RsqrtEstimate(FloatX4 a) {
+  return FloatX4{_mm_rsqrt_ps(a.native())};
+}
+inline FloatX4 ReciprocalEstimate(FloatX4 a) {
+  return FloatX4{_mm_rcp_ps(a.native())};
+}
+
+#elif defined(PEWPEW_SIMD_NEON)
+
+inline FloatX4 operator+(FloatX4 a, FloatX4 b) {
+  return FloatX4{vaddq_f32(a.native(), b.native())};
+}
+inline FloatX4 operator-(FloatX4 a, FloatX4 b) {
+  return FloatX4{vsubq_f32(a.native(), b.native())};
+}
+inline FloatX4 operator*(FloatX4 a, FloatX4 b) {
+  return FloatX4{vmulq_f32(a.native(), b.native())};
+}
+inline FloatX4 operator/(FloatX4 a, FloatX4 b) {
+  return FloatX4{vdivq_f32(a.native(), b.native())};
+}
+inline FloatX4 operator<(FloatX4 a, FloatX4 b) {
+  return FloatX4{vreinterpretq_f32_u32(vcltq_f32(a.native(), b.native()))};
+}
+inline FloatX4 operator<=(FloatX4 a, FloatX4 b) {
+  return FloatX4{vreinterpretq_f32_u32(vcleq_f32(a.native(), b.native()))};
+}
+inline FloatX4 operator>(FloatX4 a, FloatX4 b) {
+  return FloatX4{vreinterpretq_f32_u32(vcgtq_f32(a.native(), b.native()))};
+}
+inline FloatX4 operator>=(FloatX4 a, FloatX4 b) {
+  return FloatX4{vreinterpretq_f32_u32(vcgeq_f32(a.native(), b.native()))};
+}
+inline FloatX4 operator&(FloatX4 a, FloatX4 b) {
+  return FloatX4{vreinterpretq_f32_u32(
+      vandq_u32(vreinterpretq_u32_f32(a.native()),
+                vreinterpretq_u32_f32(b.native())))};
+}
+inline FloatX4 operator|(FloatX4 a, FloatX4 b) {
+  return FloatX4{vreinterpretq_f32_u32(
+      vorrq_u32(vreinterpretq_u32_f32(a.native()),
+                vreinterpretq_u32_f32(b.native())))};
+}
+inline FloatX4 Min(FloatX4 a, FloatX4 b) {
+  return FloatX4{vminq_f32(a.native(), b.native())};
+}
+inline FloatX4 Max(FloatX4 a, FloatX4 b) {
+  return FloatX4{vmaxq_f32(a.native(), b.native())};
+}
+inline FloatX4 Sqrt(FloatX4 a) { return FloatX4{vsqrtq_f32(a.native())}; }
+inline FloatX4 Floor(FloatX4 a) { return FloatX4{vrndmq_f32(a.native())}; }
+inline FloatX4 Select(FloatX4 mask, FloatX4 a, FloatX4 b) {
+  return FloatX4{
+      vbslq_f32(vreinterpretq_u32_f32(mask.native()), a.native(), b.native())};
+}
+inline int MoveMask(FloatX4 mask) {
+  const uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(mask.native()), 31);
+  return vgetq_lane_u32(bits, 0) | (vgetq_lane_u32(bits, 1) << 1) |
+         (vgetq_lane_u32(bits, 2) << 2) | (vgetq_lane_u32(bits, 3) << 3);
+}
+// The raw estimates of NEON are only accurate to about 8 bits, so they take
+// a Newton-Raphson step here to be at least as accurate as those of SSE.
+inline FloatX4 RsqrtEstimate(FloatX4 a) {
+  const float32x4_t estimate = vrsqrteq_f32(a.native());
+  const float32x4_t step =
+      vrsqrtsq_f32(vmulq_f32(a.native(), estimate), estimate);
+  return FloatX4{vmulq_f32(estimate, step)};
+}
+inline FloatX4 ReciprocalEstimate(FloatX4 a) {
+  const float32x4_t estimate = vrecpeq_f32(a.native());
+  const float32x4_t step = vrecpsq_f32(a.native(), estimate);
+  return FloatX4{vmulq_f32(estimate, step)};
+}
+
+#else
+
+inline FloatX4 operator+(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(a, b, [](float x, float y) { return x + y; });
+}
+inline FloatX4 operator-(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(a, b, [](float x, float y) { return x - y; });
+}
+inline FloatX4 operator*(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(a, b, [](float x, float y) { return x * y; });
+}
+inline FloatX4 operator/(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(a, b, [](float x, float y) { return x / y; });
+}
+inline FloatX4 operator<(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(
+      a, b, [](float x, float y) { return FloatX4::MaskValue(x < y); });
+}
+inline FloatX4 operator<=(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(
+      a, b, [](float x, float y) { return FloatX4::MaskValue(x <= y); });
+}
+inline FloatX4 operator>(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(
+      a, b, [](float x, float y) { return FloatX4::MaskValue(x > y); });
+}
+inline FloatX4 operator>=(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(
+      a, b, [](float x, float y) { return FloatX4::MaskValue(x >= y); });
+}
+inline FloatX4 operator&(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(a, b, [](float x, float y) {
+    return FloatX4::IsMaskSet(x) ? y : 0.0f;
+  });
+}
+inline FloatX4 operator|(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(a, b, [](float x, float y) {
+    return FloatX4::IsMaskSet(x) ? x : y;
+  });
+}
+inline FloatX4 Min(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(a, b, [](float x, float y) { return x < y ? x : y; });
+}
+inline FloatX4 Max(FloatX4 a, FloatX4 b) {
+  return FloatX4::Map(a, b, [](float x, float y) { return x > y ? x : y; });
+}
+inline FloatX4 Sqrt(FloatX4 a) {
+  return FloatX4::Map(a, a, [](float x, float) { return std::sqrt(x); });
+}
+inline FloatX4 Floor(FloatX4 a) {
+  return FloatX4::Map(a, a, [](float x, float) { return std::floor(x); });
+}
+inline FloatX4 Select(FloatX4 mask, FloatX4 a, FloatX4 b) {
+  float m[4], x[4], y[4];
+  mask.Store(m);
+  a.Store(x);
+  b.Store(y);
+  for (int i = 0; i < 4; i++) {
+    x[i] = FloatX4::IsMaskSet(m[i]) ? x[i] : y[i];
+  }
+  return FloatX4::Load(x);
+}
+inline int MoveMask(FloatX4 mask) {
+  float m[4];
+  mask.Store(m);
+  int result = 0;
+  for (int i = 0; i < 4; i++) {
+    result |= FloatX4::IsMaskSet(m[i]) << i;
+  }
+  return result;
+}
+inline FloatX4 RsqrtEstimate(FloatX4 a) {
+  return FloatX4::Map(a, a, [](float x, float) { return 1 / std::sqrt(x); });
+}
+inline FloatX4 ReciprocalEstimate(FloatX4 a) {
+  return FloatX4::Map(a, a, [](float x, float) { return 1 / x; });
+}
+
+#endif
+
+inline FloatX4 Abs(FloatX4 a) { return Max(a, FloatX4{0.0f} - a); }
+
+// Transposes the 4x4 matrix of rows `r0` to `r3`, e.g. to turn four vectors
+// into packs of their x, y and z.
+inline void Transpose(FloatX4* r0, FloatX4* r1, FloatX4* r2, FloatX4* r3) {
+#if defined(PEWPEW_SIMD_SSE)
+  __m128 a = r0->native();
+  __m128 b = r1->native();
+  __m128 c = r2->native();
+  __m128 d = r3->native();
+  _MM_TRANSPOSE4_PS(a, b, c, d);
+  *r0 = FloatX4{a};
+  *r1 = FloatX4{b};
+  *r2 = FloatX4{c};
+  *r3 = FloatX4{d};
+#else
+  float m[4][4];
+  r0->Store(m[0]);
+  r1->Store(m[1]);
+  r2->Store(m[2]);
+  r3->Store(m[3]);
+  *r0 = FloatX4{m[0][0], m[1][0], m[2][0], m[3][0]};
+  *r1 = FloatX4{m[0][1], m[1][1], m[2][1], m[3][1]};
+  *r2 = FloatX4{m[0][2], m[1][2], m[2][2], m[3][2]};
+  *r3 = FloatX4{m[0][3], m[1][3], m[2][3], m[3][3]};
+#endif
+}
+
+// Estimates refined with one Newton-Raphson step, accurate to about 22 bits
+// instead of the 12 of SSE's, or the 16 of NEON's after their own step.
+inline FloatX4 RsqrtApprox(FloatX4 a) {
+  const FloatX4 estimate = RsqrtEstimate(a);
+  return estimate *
+         (FloatX4{1.5f} - FloatX4{0.5f} * a * estimate * estimate);
+}
+
+inline FloatX4 ReciprocalApprox(FloatX4 a) {
+  const FloatX4 estimate = ReciprocalEstimate(a);
+  return estimate * (FloatX4{2.0f} - a * estimate);
+}
+
+inline float RsqrtApprox(float a) { return RsqrtApprox(FloatX4{a})[0]; }
+
+inline float ReciprocalApprox(float a) {
+  return ReciprocalApprox(FloatX4{a})[0];
+}
+
+#endif  // PEWPEW_SIMD_H_
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "socket.h"
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+bool IsTcpAddress(const std::string& address, std::string* host,
+                  std::string* port) {
+  const size_t colon = address.rfind(':');
+  if (colon == std::string::npos || colon + 1 == address.size() ||
+      address.find('/') != std::string::npos) {
+    return false;
+  }
+
+  *host = address.substr(0, colon);
+  *port = address.substr(colon + 1);
+  return std::all_of(port->begin(), port->end(), ::isdigit);
+}
+
+int OpenSocket(const std::string& address, bool is_server) {
+  std::string host;
+  std::string port;
+  if (IsTcpAddress(address, &host, &port)) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = is_server ? AI_PASSIVE : 0;
+    addrinfo* result;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) {
+      return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo* info = result; info != nullptr; info = info->ai_next) {
+      fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+      if (fd < 0) {
+        continue;
+      }
+
+      if (is_server) {
+        const int enable = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if (bind(fd, info->ai_addr, info->ai_addrlen) == 0 &&
+            listen(fd, SOMAXCONN) == 0) {
+          break;
+        }
+      } else if (connect(fd, info->ai_addr, info->ai_addrlen) == 0) {
+        break;
+      }
+
+      close(fd);
+      fd = -1;
+    }
+    freeaddrinfo(result);
+    return fd;
+  }
+
+  sockaddr_un socket_address{};
+  socket_address.sun_family = AF_UNIX;
+  if (address.size() >= sizeof(socket_address.sun_path)) {
+    return -1;
+  }
+  std::strcpy(socket_address.sun_path, address.c_str());
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+
+  const sockaddr* generic_address =
+      reinterpret_cast<const sockaddr*>(&socket_address);
+  bool success;
+  if (is_server) {
+    unlink(address.c_str());
+    success = bind(fd, generic_address, sizeof(socket_address)) == 0 &&
+              listen(fd, SOMAXCONN) == 0;
+  } else {
+    success = connect(fd, generic_address, sizeof(socket_address)) == 0;
+  }
+
+  if (!success) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool SendAll(int fd, const void* data, size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    // `MSG_NOSIGNAL` turns a dead peer into an error instead of a `SIGPIPE`.
+    const ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      return false;
+    }
+    bytes += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+bool ReceiveAll(int fd, void* data, size_t size) {
+  char* bytes = static_cast<char*>(data);
+  while (size > 0) {
+    const ssize_t received = recv(fd, bytes, size, 0);
+    if (received <= 0) {
+      return false;
+    }
+    bytes += received;
+    size -= received;
+  }
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef PEWPEW_SOCKET_H_
+#define PEWPEW_SOCKET_H_
+
+#include <cstddef>
+#include <string>
+
+// Addresses are either a Unix socket path (e.g. "/tmp/pewpew.sock") or a TCP
+// "host:port" pair (e.g. "localhost:7777").
+
+bool IsTcpAddress(const std::string& address, std::string* host,
+                  std::string* port);
+
+// Listens on `address` if `is_server`, or connects to it. Returns the socket,
+// or -1 on errors, with `errno` set.
+int OpenSocket(const std::string& address, bool is_server);
+
+// Both return false if the peer closes the connection or fails.
+bool SendAll(int fd, const void* data, size_t size);
+bool ReceiveAll(int fd, void* data, size_t size);
+
+#endif  // PEWPEW_SOCKET_H_
\ No newline at end of file
@@ -1,11 +1,14 @@
 #include "sphere.h"
 
 #include <cmath>
+#include <limits>
+#include <numbers>
 #include <optional>
 
 #include "float.h"
 #include "hittable.h"
 #include "ray.h"
+#include "sampler.h"
 #include "vec3.h"
 
 std::optional<HitRecord> Sphere::Hit(const Ray& ray, Float tmin,
@@ -32,5 +35,59 @@ std::optional<HitRecord> Sphere::Hit(const Ray& ray, Float tmin,
 
   const Point3 intersection = ray.at(root);
   const Vec3 outward_normal = (intersection - center_) / radius_;
-  return HitRecord{root, intersection, material_, outward_normal, ray};
+
+  // Longitude and latitude, from -x around the y axis, and from -y to +y.
+  const Float pi = std::numbers::pi_v<Float>;
+  const Float theta = std::acos(-outward_normal.y());
+  const Float phi = std::atan2(-outward_normal.z(), outward_normal.x()) + pi;
+  const Float u = phi / (2 * pi);
+  const Float v = theta / pi;
+  const Float footprint = ray.ConeWidth(root) / (2 * pi * std::abs(radius_));
+  return HitRecord{root, intersection, material_, outward_normal, ray, u, v,
+                   footprint};
+}
+
+Float Sphere::Area() const {
+  return 4 * std::numbers::pi_v<Float> * radius_ * radius_;
+}
+
+Vec3 Sphere::SampleDirection(const Point3& origin,
+                             const Sample2D& sample) const {
+  const Vec3 direction = center_ - origin;
+  const Float distance_squared = direction.length_squared();
+  if (distance_squared <= radius_ * radius_) {
+    return SampleUnitVector(sample.u, sample.v);
+  }
+
+  const Float cos_theta_max =
+      std::sqrt(1 - radius_ * radius_ / distance_squared);
+  const Float z = 1 + sample.v * (cos_theta_max - 1);
+  const Float phi = 2 * std::numbers::pi_v<Float> * sample.u;
+  const Float sin_theta = std::sqrt(std::fmax(Float{0}, 1 - z * z));
+
+  // An orthonormal basis around the direction to the center.
+  const Vec3 w = UnitVector(direction);
+  const Vec3 a = std::fabs(w.x()) > 0.9 ? Vec3{0, 1, 0} : Vec3{1, 0, 0};
+  const Vec3 v = UnitVector(Cross(w, a));
+  const Vec3 u = Cross(w, v);
+  return (sin_theta * std::cos(phi)) * u + (sin_theta * std::sin(phi)) * v +
+         z * w;
+}
+
+Float Sphere::PdfValue(const Point3& origin, const Vec3& direction) const {
+  const Float distance_squared = (center_ - origin).length_squared();
+  if (distance_squared <= radius_ * radius_) {
+    return 1 / (4 * std::numbers::pi_v<Float>);
+  }
+  if (!Hit(Ray{origin, direction}, static_cast<Float>(0.001),
+           std::numeric_limits<Float>::infinity())
+           .has_value()) {
+    return 0;
+  }
+
+  const Float cos_theta_max =
+      std::sqrt(1 - radius_ * radius_ / distance_squared);
+  const Float solid_angle =
+      2 * std::numbers::pi_v<Float> * (1 - cos_theta_max);
+  return 1 / solid_angle;
 }
\ No newline at end of file
@@ -4,10 +4,12 @@
 #include <memory>
 #include <optional>
 
+#include "aabb.h"
 #include "float.h"
 #include "hittable.h"
 #include "material.h"
 #include "ray.h"
+#include "sampler.h"
 #include "vec3.h"
 
 class Sphere : public Hittable {
@@ -17,6 +19,16 @@ class Sphere : public Hittable {
 
   std::optional<HitRecord> Hit(const Ray& ray, Float tmin,
                                Float tmax) const override;
+  Aabb BoundingBox() const override {
+    const Vec3 radius{radius_, radius_, radius_};
+    return Aabb{center_ - radius, center_ + radius};
+  }
+
+  Float Area() const override;
+  // Samples the cone of directions the sphere subtends from `origin`.
+  Vec3 SampleDirection(const Point3& origin,
+                       const Sample2D& sample) const override;
+  Float PdfValue(const Point3& origin, const Vec3& direction) const override;
 
  private:
   Point3 center_;
@@ -0,0 +1,18 @@
+#ifndef PEWPEW_TEXTURE_H_
+#define PEWPEW_TEXTURE_H_
+
+#include "color.h"
+#include "float.h"
+#include "vec3.h"
+
+class Texture {
+ public:
+  virtual ~Texture() = default;
+
+  // `footprint` is the width of the area to filter over, in texture
+  // coordinates.
+  virtual Color Value(Float u, Float v, const Point3& p,
+                      Float footprint) const = 0;
+};
+
+#endif  // PEWPEW_TEXTURE_H_
\ No newline at end of file
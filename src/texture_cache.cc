@@ -0,0 +1,105 @@
+#include "texture_cache.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+uint64_t Key(int file_id, uint64_t tile) {
+  return static_cast<uint64_t>(file_id) << 40 | tile;
+}
+
+// The last tiles looked up by a thread, which saves most lookups from locking
+// a shard, since neighboring texels and nearby rays share tiles.
+struct MemoEntry {
+  uint64_t cache_id = 0;
+  uint64_t key = 0;
+  std::shared_ptr<const TextureTile> tile;
+};
+
+constexpr int kMemoSize = 16;
+
+}  // namespace
+
+TextureCache::TextureCache(size_t capacity_bytes)
+    : shard_capacity_(std::max<size_t>(
+          1, capacity_bytes / sizeof(TextureTile) / kNumShards)) {
+  static std::atomic<uint64_t> next_id = 1;
+  id_ = next_id++;
+}
+
+TextureCache::~TextureCache() {
+  for (int fd : files_) {
+    close(fd);
+  }
+}
+
+int TextureCache::AddFile(int fd) {
+  const std::lock_guard<std::mutex> guard(files_mutex_);
+  files_.push_back(fd);
+  return files_.size() - 1;
+}
+
+std::shared_ptr<const TextureTile> TextureCache::GetTile(int file_id,
+                                                         uint64_t tile) {
+  const uint64_t key = Key(file_id, tile);
+  static thread_local std::array<MemoEntry, kMemoSize> memo;
+  MemoEntry& memo_entry = memo[(key ^ (key >> 40)) % kMemoSize];
+  if (memo_entry.cache_id == id_ && memo_entry.key == key) {
+    return memo_entry.tile;
+  }
+
+  Shard& shard = shards_[(key * 0x9e3779b97f4a7c15) >> 58];
+  {
+    const std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+      shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+      memo_entry = MemoEntry{id_, key, it->second->second};
+      return memo_entry.tile;
+    }
+  }
+
+  // Read without holding the shard lock. Two threads missing the same tile
+  // both read it, and the second one's copy is dropped.
+  num_misses_++;
+  int fd;
+  {
+    const std::lock_guard<std::mutex> guard(files_mutex_);
+    fd = files_[file_id];
+  }
+  auto data = std::make_shared<TextureTile>();
+  const off_t offset = tile * sizeof(TextureTile);
+  if (pread(fd, data->data(), sizeof(TextureTile), offset) !=
+      sizeof(TextureTile)) {
+    std::cerr << "Error reading texture tile " << tile << std::endl;
+    data->fill(0);
+  }
+
+  std::shared_ptr<const TextureTile> result = std::move(data);
+  {
+    const std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+      result = it->second->second;
+    } else {
+      shard.entries.emplace_front(key, result);
+      shard.index[key] = shard.entries.begin();
+      while (shard.entries.size() > shard_capacity_) {
+        shard.index.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+      }
+    }
+  }
+
+  memo_entry = MemoEntry{id_, key, result};
+  return result;
+}
\ No newline at end of file
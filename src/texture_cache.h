@@ -0,0 +1,63 @@
+#ifndef PEWPEW_TEXTURE_CACHE_H_
+#define PEWPEW_TEXTURE_CACHE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Texture tiles are 32x32 texels of 4 bytes, i.e. a page.
+inline constexpr int kTextureTileSizeLog2 = 5;
+inline constexpr int kTextureTileSize = 1 << kTextureTileSizeLog2;
+inline constexpr int kTexelsPerTile = kTextureTileSize * kTextureTileSize;
+
+using TextureTile = std::array<uint32_t, kTexelsPerTile>;
+
+// Keeps the most recently used texture tiles in memory, up to a capacity
+// shared by all textures, and reads the others from their tiled files on
+// demand. Tiles are handed out as shared pointers, so that evicting a tile
+// doesn't pull it from under a thread still filtering it.
+class TextureCache {
+ public:
+  explicit TextureCache(size_t capacity_bytes);
+  ~TextureCache();
+
+  TextureCache(const TextureCache&) = delete;
+  TextureCache& operator=(const TextureCache&) = delete;
+
+  // Takes ownership of a file made of consecutive tiles, and returns its id.
+  int AddFile(int fd);
+
+  std::shared_ptr<const TextureTile> GetTile(int file_id, uint64_t tile);
+
+  uint64_t num_misses() const { return num_misses_; }
+
+ private:
+  // Shards keep threads from contending on a single lock.
+  static constexpr int kNumShards = 64;
+
+  struct Shard {
+    using Entry = std::pair<uint64_t, std::shared_ptr<const TextureTile>>;
+
+    std::mutex mutex;
+    // Most recently used first.
+    std::list<Entry> entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+  };
+
+  // Tells the per-thread lookup memos of different caches apart.
+  uint64_t id_;
+  size_t shard_capacity_;
+  std::array<Shard, kNumShards> shards_;
+  std::mutex files_mutex_;
+  std::vector<int> files_;
+  std::atomic<uint64_t> num_misses_ = 0;
+};
+
+#endif  // PEWPEW_TEXTURE_CACHE_H_
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "tiled_framebuffer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+#include "float.h"
+#include "tonemap.h"
+
+namespace {
+
+uint32_t FloatBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float BitsToFloat(uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Rounds to the nearest half float, ties to even.
+uint16_t FloatToHalf(float value) {
+  uint32_t bits = FloatBits(value);
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  bits &= 0x7fffffff;
+
+  // At least 65536, which rounds to infinity, or infinity or NaN.
+  if (bits >= 0x47800000) {
+    return sign | (bits > 0x7f800000 ? 0x7e00 : 0x7c00);
+  }
+
+  // Below the smallest normal half float: adding 0.5 aligns the mantissa so
+  // that the float addition does the rounding.
+  if (bits < 0x38800000) {
+    const uint32_t magic = 0x3f000000;
+    return sign | (FloatBits(BitsToFloat(bits) + BitsToFloat(magic)) - magic);
+  }
+
+  const uint32_t odd_mantissa = (bits >> 13) & 1;
+  bits += ((15 - 127) << 23) + 0xfff + odd_mantissa;
+  return sign | (bits >> 13);
+}
+
+float HalfToFloat(uint16_t half) {
+  const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+  const uint32_t exponent = (half >> 10) & 0x1f;
+  const uint32_t mantissa = half & 0x3ff;
+  if (exponent == 0) {
+    return std::copysign(std::ldexp(static_cast<float>(mantissa), -24),
+                         sign != 0 ? -1.0f : 1.0f);
+  }
+  if (exponent == 31) {
+    return BitsToFloat(sign | 0x7f800000 | (mantissa << 13));
+  }
+  return BitsToFloat(sign | ((exponent + 127 - 15) << 23) | (mantissa << 13));
+}
+
+}  // namespace
+
+TiledFramebuffer::TiledFramebuffer(int width, int height, int tile_size,
+                                   bool half_float)
+    : width_(width),
+      height_(height),
+      tile_size_(tile_size),
+      half_float_(half_float),
+      num_tiles_x_((width + tile_size - 1) / tile_size),
+      num_tiles_y_((height + tile_size - 1) / tile_size),
+      tile_bytes_(static_cast<size_t>(tile_size) * tile_size * 3 *
+                  (half_float ? sizeof(uint16_t) : sizeof(float))) {}
+
+TiledFramebuffer::~TiledFramebuffer() {
+  if (data_ != nullptr) {
+    munmap(data_, file_size_);
+  }
+}
+
+bool TiledFramebuffer::Open(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    std::cerr << "Error opening " << path << ": " << std::strerror(errno)
+              << std::endl;
+    return false;
+  }
+
+  file_size_ = tile_bytes_ * num_tiles();
+  void* data = MAP_FAILED;
+  if (ftruncate(fd, file_size_) == 0) {
+    data = mmap(nullptr, file_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                0);
+  }
+  const int error = errno;
+  // The mapping keeps the file open.
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    std::cerr << "Error mapping " << path << ": " << std::strerror(error)
+              << std::endl;
+    return false;
+  }
+
+  data_ = static_cast<char*>(data);
+  return true;
+}
+
+Tile TiledFramebuffer::tile(int index) const {
+  const int x = (index % num_tiles_x_) * tile_size_;
+  const int y = (index / num_tiles_x_) * tile_size_;
+  return Tile{x, y, std::min(tile_size_, width_ - x),
+              std::min(tile_size_, height_ - y)};
+}
+
+void TiledFramebuffer::StoreTile(int index, const std::vector<Float>& colors) {
+  char* tile_data = data_ + index * tile_bytes_;
+  if (half_float_) {
+    uint16_t* values = reinterpret_cast<uint16_t*>(tile_data);
+    for (size_t k = 0; k < colors.size(); k++) {
+      values[k] = FloatToHalf(colors[k]);
+    }
+  } else {
+    float* values = reinterpret_cast<float*>(tile_data);
+    std::copy(colors.begin(), colors.end(), values);
+  }
+  Release(index);
+}
+
+void TiledFramebuffer::LoadTile(int index, std::vector<Float>* colors) const {
+  const Tile tile = this->tile(index);
+  colors->resize(tile.width * tile.height * 3);
+
+  const char* tile_data = data_ + index * tile_bytes_;
+  if (half_float_) {
+    const uint16_t* values = reinterpret_cast<const uint16_t*>(tile_data);
+    for (size_t k = 0; k < colors->size(); k++) {
+      (*colors)[k] = HalfToFloat(values[k]);
+    }
+  } else {
+    const float* values = reinterpret_cast<const float*>(tile_data);
+    std::copy(values, values + colors->size(), colors->begin());
+  }
+  Release(index);
+}
+
+void TiledFramebuffer::Release(int index) const {
+  // Dirty pages of a shared mapping stay in the page cache and are written
+  // back, so dropping them from the mapping doesn't lose data.
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t begin = index * tile_bytes_ / page_size * page_size;
+  const size_t end = std::min(file_size_, (index + 1) * tile_bytes_);
+  madvise(data_ + begin, end - begin, MADV_DONTNEED);
+}
+
+bool TiledFramebuffer::WriteImage(const std::string& path,
+                                  const Tonemapper& tonemapper) const {
+  std::ofstream file{path, std::ios::binary};
+  if (!file) {
+    std::cerr << "Error opening " << path << " for writing" << std::endl;
+    return false;
+  }
+
+  file << "P6\n" << width_ << ' ' << height_ << "\n255\n";
+
+  std::vector<uint8_t> band(static_cast<size_t>(width_) * tile_size_ * 3);
+  std::vector<Float> colors;
+  for (int tile_y = 0; tile_y < num_tiles_y_; tile_y++) {
+    int band_height = 0;
+    for (int tile_x = 0; tile_x < num_tiles_x_; tile_x++) {
+      const int index = tile_y * num_tiles_x_ + tile_x;
+      const Tile tile = this->tile(index);
+      LoadTile(index, &colors);
+      for (int y = 0; y < tile.height; y++) {
+        const size_t dest_index =
+            (static_cast<size_t>(y) * width_ + tile.x) * 3;
+        tonemapper.ToRgb(&colors[y * tile.width * 3], tile.width,
+                         /*scale=*/1, &band[dest_index]);
+      }
+      band_height = tile.height;
+    }
+
+    file.write(reinterpret_cast<const char*>(band.data()),
+               static_cast<size_t>(width_) * band_height * 3);
+  }
+
+  if (!file) {
+    std::cerr << "Error writing " << path << std::endl;
+    return false;
+  }
+
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef PEWPEW_TILED_FRAMEBUFFER_H_
+#define PEWPEW_TILED_FRAMEBUFFER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+#include "float.h"
+#include "tonemap.h"
+
+// An image stored tile by tile in a memory-mapped file, for images too large
+// to keep in memory. Tiles hold averaged linear colors, as floats or half
+// floats, and are dropped from memory as soon as they are stored or loaded,
+// so only the tiles being worked on count towards the resident memory.
+class TiledFramebuffer {
+ public:
+  TiledFramebuffer(int width, int height, int tile_size, bool half_float);
+  ~TiledFramebuffer();
+
+  TiledFramebuffer(const TiledFramebuffer&) = delete;
+  TiledFramebuffer& operator=(const TiledFramebuffer&) = delete;
+
+  // Creates the backing file, which is kept afterwards.
+  bool Open(const std::string& path);
+
+  int num_tiles() const { return num_tiles_x_ * num_tiles_y_; }
+  Tile tile(int index) const;
+
+  // Colors are 3 components per pixel, in row-major order within the tile.
+  void StoreTile(int index, const std::vector<Float>& colors);
+  void LoadTile(int index, std::vector<Float>* colors) const;
+
+  // Writes a binary PPM, one row of tiles at a time.
+  bool WriteImage(const std::string& path, const Tonemapper& tonemapper) const;
+
+ private:
+  void Release(int index) const;
+
+  int width_;
+  int height_;
+  int tile_size_;
+  bool half_float_;
+  int num_tiles_x_;
+  int num_tiles_y_;
+  // Every tile takes the space of a full tile, including those on the edges.
+  size_t tile_bytes_;
+  size_t file_size_ = 0;
+  char* data_ = nullptr;
+};
+
+#endif  // PEWPEW_TILED_FRAMEBUFFER_H_
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "tonemap.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#include "float.h"
+
+namespace {
+
+double HableCurve(double x) {
+  const double a = 0.15;
+  const double b = 0.50;
+  const double c = 0.10;
+  const double d = 0.20;
+  const double e = 0.02;
+  const double f = 0.30;
+  return (x * (a * x + c * b) + d * e) / (x * (a * x + b) + d * f) - e / f;
+}
+
+double Tonemap(TonemapOperator tonemap_operator, double x) {
+  switch (tonemap_operator) {
+    case TonemapOperator::kClamp:
+      return x;
+    case TonemapOperator::kAces:
+      return (x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14);
+    case TonemapOperator::kFilmic: {
+      const double white_point = 11.2;
+      const double exposure_bias = 2.0;
+      return HableCurve(exposure_bias * x) / HableCurve(white_point);
+    }
+  }
+  return x;
+}
+
+double LinearToSrgb(double x) {
+  return x <= 0.0031308 ? 12.92 * x : 1.055 * std::pow(x, 1 / 2.4) - 0.055;
+}
+
+}  // namespace
+
+Tonemapper::Tonemapper(const TonemapSettings& settings)
+    : settings_(settings),
+      exposure_scale_(std::exp2(static_cast<float>(settings.exposure))) {
+  for (int index = 0; index < kLutSize; index++) {
+    // The middle of the range of floats that share these top 16 bits.
+    const uint32_t bits = static_cast<uint32_t>(index + kLutOffset) << 16 |
+                          0x8000;
+    const double x = std::bit_cast<float>(bits);
+    const double y =
+        std::clamp(Tonemap(settings.tonemap_operator, x), 0.0, 1.0);
+    lut_[index] = static_cast<uint8_t>(255 * LinearToSrgb(y) + 0.5);
+  }
+  // Zero and values too small for the table stay black.
+  lut_[0] = 0;
+}
\ No newline at end of file
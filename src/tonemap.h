@@ -0,0 +1,84 @@
+#ifndef PEWPEW_TONEMAP_H_
+#define PEWPEW_TONEMAP_H_
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+#include "float.h"
+
+enum class TonemapOperator {
+  // Clamps to [0, 1].
+  kClamp,
+  // Narkowicz's fit of the ACES filmic curve.
+  kAces,
+  // Hable's Uncharted 2 filmic curve.
+  kFilmic,
+};
+
+struct TonemapSettings {
+  TonemapOperator tonemap_operator;
+  // In stops.
+  Float exposure;
+};
+
+// Turns linear colors into sRGB-encoded 8-bit colors, through a lookup table
+// of the exposed, tonemapped and encoded value for every bfloat16 number
+// between 2^-16 and 2^16. Indexing by the top bits of the float keeps the
+// relative step, hence the error, below one 8-bit level everywhere.
+class Tonemapper {
+ public:
+  Tonemapper() : Tonemapper(TonemapSettings{TonemapOperator::kClamp, 0}) {}
+  explicit Tonemapper(const TonemapSettings& settings);
+
+  const TonemapSettings& settings() const { return settings_; }
+
+  // Colors are 3 components per pixel, multiplied by `scale` before
+  // tonemapping, e.g. to average accumulated samples.
+  template <typename T>
+  void ToArgb(const T* colors, int num_pixels, Float scale,
+              uint32_t* argb) const {
+    const float exposed_scale = scale * exposure_scale_;
+    for (int i = 0; i < num_pixels; i++) {
+      const uint32_t r = Lookup(colors[3 * i] * exposed_scale);
+      const uint32_t g = Lookup(colors[3 * i + 1] * exposed_scale);
+      const uint32_t b = Lookup(colors[3 * i + 2] * exposed_scale);
+      argb[i] = 0xff000000 | (r << 16) | (g << 8) | b;
+    }
+  }
+
+  template <typename T>
+  void ToRgb(const T* colors, int num_pixels, Float scale,
+             uint8_t* rgb) const {
+    const float exposed_scale = scale * exposure_scale_;
+    for (int k = 0; k < 3 * num_pixels; k++) {
+      rgb[k] = Lookup(colors[k] * exposed_scale);
+    }
+  }
+
+ private:
+  static constexpr int kLutSize = 4096;
+  // The bfloat16 bits of 2^-16.
+  static constexpr int kLutOffset = (127 - 16) << 7;
+
+  uint8_t Lookup(float value) const {
+    // Negative values would index past the end, and NaNs fail the comparison.
+    value = value > 0 ? value : 0;
+    const int index =
+        static_cast<int>(std::bit_cast<uint32_t>(value) >> 16) - kLutOffset;
+    return lut_[index < 0 ? 0 : (index >= kLutSize ? kLutSize - 1 : index)];
+  }
+
+  TonemapSettings settings_;
+  float exposure_scale_;
+  std::array<uint8_t, kLutSize> lut_;
+};
+
+// Unpacks an ARGB8888 pixel into 3 bytes.
+inline void ArgbToRgb(uint32_t argb, uint8_t* rgb) {
+  rgb[0] = (argb >> 16) & 0xff;
+  rgb[1] = (argb >> 8) & 0xff;
+  rgb[2] = argb & 0xff;
+}
+
+#endif  // PEWPEW_TONEMAP_H_
\ No newline at end of file
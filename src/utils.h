@@ -1,6 +1,7 @@
 #ifndef PEWPEW_UTILS_H_
 #define PEWPEW_UTILS_H_
 
+#include <cstdint>
 #include <numbers>
 #include <random>
 
@@ -8,17 +9,38 @@
 #include "pcg_random.hpp"
 
 inline Float DegreesToRadians(Float degrees) {
-  return degrees * std::numbers::pi / 180.0;
+  return degrees * std::numbers::pi_v<Float> / 180;
+}
+
+// Each thread owns its generator, so that OpenMP workers don't share state.
+inline pcg32& RandomGenerator() {
+  static thread_local pcg_extras::seed_seq_from<std::random_device>
+      seed_source;
+  static thread_local pcg32 rng(seed_source);
+  return rng;
+}
+
+// Makes the following `RandomFloat` calls on this thread deterministic.
+inline void SeedRandom(uint64_t seed, uint64_t stream) {
+  RandomGenerator().seed(seed, stream);
 }
 
 inline Float RandomFloat() {
-  static pcg_extras::seed_seq_from<std::random_device> seed_source;
-  static pcg32 rng(seed_source);
-  return rng() / (rng.max() + 1.0);
+  pcg32& rng = RandomGenerator();
+  // Keep the 24 bits a float can represent, so the result is always below 1.
+  return (rng() >> 8) * 0x1p-24f;
 }
 
-inline Float RandomFloat(double min, double max) {
+inline Float RandomFloat(Float min, Float max) {
   return min + (max - min) * RandomFloat();
 }
 
+// SplitMix64 finalizer, used to derive well-distributed seeds from indices.
+inline uint64_t HashSeed(uint64_t value) {
+  value += 0x9e3779b97f4a7c15;
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+  return value ^ (value >> 31);
+}
+
 #endif  // PEWPEW_UTILS_H_
\ No newline at end of file
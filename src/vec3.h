@@ -2,15 +2,18 @@
 #define PEWPEW_VEC3_H_
 
 #include <cmath>
+#include <numbers>
 
 #include "float.h"
+#include "simd.h"
 #include "utils.h"
 
 class Vec3 {
  public:
   Vec3() : e_{0, 0, 0} {}
   Vec3(Float e0, Float e1, Float e2) : e_{e0, e1, e2} {}
-  Vec3(const Float (&e)[3]) : e_{e[0], e[1], e[2]} {}
+  // From ImGui-edited settings, which are always single precision.
+  Vec3(const float (&e)[3]) : e_{e[0], e[1], e[2]} {}
 
   Vec3& operator+=(const Vec3& value) {
     e_[0] += value.x();
@@ -36,7 +39,7 @@ class Vec3 {
     return *this;
   }
 
-  Vec3& operator*=(double value) {
+  Vec3& operator*=(Float value) {
     e_[0] *= value;
     e_[1] *= value;
     e_[2] *= value;
@@ -44,19 +47,13 @@ class Vec3 {
     return *this;
   }
 
-  Vec3& operator/=(double value) {
-    e_[0] /= value;
-    e_[1] /= value;
-    e_[2] /= value;
-
-    return *this;
-  }
+  Vec3& operator/=(Float value) { return *this *= 1 / value; }
 
   static Vec3 Random() {
     return Vec3{RandomFloat(), RandomFloat(), RandomFloat()};
   }
 
-  static Vec3 Random(double min, double max) {
+  static Vec3 Random(Float min, Float max) {
     return Vec3{RandomFloat(min, max), RandomFloat(min, max),
                 RandomFloat(min, max)};
   }
@@ -64,6 +61,9 @@ class Vec3 {
   Float x() const { return e_[0]; }
   Float y() const { return e_[1]; }
   Float z() const { return e_[2]; }
+  Float operator[](int axis) const { return e_[axis]; }
+
+  bool operator==(const Vec3& other) const = default;
 
   Float length_squared() const {
     return e_[0] * e_[0] + e_[1] * e_[1] + e_[2] * e_[2];
@@ -93,11 +93,11 @@ inline Vec3 operator-(Vec3 lhs, const Vec3& rhs) { return lhs -= rhs; }
 
 inline Vec3 operator*(Vec3 lhs, const Vec3& rhs) { return lhs *= rhs; }
 
-inline Vec3 operator*(Vec3 lhs, double rhs) { return lhs *= rhs; }
+inline Vec3 operator*(Vec3 lhs, Float rhs) { return lhs *= rhs; }
 
-inline Vec3 operator*(double lhs, Vec3 rhs) { return rhs *= lhs; }
+inline Vec3 operator*(Float lhs, Vec3 rhs) { return rhs *= lhs; }
 
-inline Vec3 operator/(Vec3 lhs, double rhs) { return lhs /= rhs; }
+inline Vec3 operator/(Vec3 lhs, Float rhs) { return lhs /= rhs; }
 
 inline Float Dot(const Vec3& lhs, const Vec3& rhs) {
   return lhs.x() * rhs.x() + lhs.y() * rhs.y() + lhs.z() * rhs.z();
@@ -109,27 +109,43 @@ inline Vec3 Cross(const Vec3& lhs, const Vec3& rhs) {
               lhs.x() * rhs.y() - lhs.y() * rhs.x()};
 }
 
-inline Vec3 UnitVector(const Vec3& value) { return value / value.length(); }
+inline Vec3 UnitVector(const Vec3& value) {
+#ifdef PEWPEW_FAST_RSQRT
+  return value * static_cast<Float>(RsqrtApprox(value.length_squared()));
+#else
+  return value / value.length();
+#endif
+}
 
-inline Vec3 RandomInUnitDisk() {
-  while (true) {
-    const Vec3 p{RandomFloat(-1, 1), RandomFloat(-1, 1), 0};
-    if (p.length_squared() < 1) {
-      return p;
-    }
+// Maps the unit square to the unit disk with Shirley and Chiu's concentric
+// mapping, which keeps strata of the square compact on the disk.
+inline Vec3 SampleUnitDisk(Float u, Float v) {
+  const Float a = 2 * u - 1;
+  const Float b = 2 * v - 1;
+  if (a == 0 && b == 0) {
+    return Vec3{};
   }
-}
 
-inline Vec3 RandomInUnitSphere() {
-  while (true) {
-    const Vec3 p = Vec3::Random(-1, 1);
-    if (p.length_squared() < 1) {
-      return p;
-    }
+  Float radius;
+  Float theta;
+  if (std::fabs(a) > std::fabs(b)) {
+    radius = a;
+    theta = (std::numbers::pi_v<Float> / 4) * (b / a);
+  } else {
+    radius = b;
+    theta = (std::numbers::pi_v<Float> / 2) -
+            (std::numbers::pi_v<Float> / 4) * (a / b);
   }
+  return Vec3{radius * std::cos(theta), radius * std::sin(theta), 0};
 }
 
-inline Vec3 RandomUnitVector() { return UnitVector(RandomInUnitSphere()); }
+// Maps the unit square to uniformly distributed directions.
+inline Vec3 SampleUnitVector(Float u, Float v) {
+  const Float z = 1 - 2 * u;
+  const Float radius = std::sqrt(std::fmax(Float{0}, 1 - z * z));
+  const Float phi = 2 * std::numbers::pi_v<Float> * v;
+  return Vec3{radius * std::cos(phi), radius * std::sin(phi), z};
+}
 
 inline Vec3 Reflect(const Vec3& direction, const Vec3& normal) {
   return direction - 2 * Dot(direction, normal) * normal;
@@ -138,11 +154,11 @@ inline Vec3 Reflect(const Vec3& direction, const Vec3& normal) {
 inline Vec3 Refract(const Vec3& direction, const Vec3& normal,
                     Float etai_over_etar) {
   // Prevent errors from floating point approximation.
-  const Float cos_theta = std::fmin(Dot(-direction, normal), 1.0);
+  const Float cos_theta = std::fmin(Dot(-direction, normal), Float{1});
   const Vec3 refracted_perpendicular =
       etai_over_etar * (direction + cos_theta * normal);
   const Vec3 refracted_parallel =
-      -std::sqrt(std::fabs(1.0 - refracted_perpendicular.length_squared())) *
+      -std::sqrt(std::fabs(1 - refracted_perpendicular.length_squared())) *
       normal;
   return refracted_perpendicular + refracted_parallel;
 }
@@ -0,0 +1,106 @@
+#ifndef PEWPEW_VEC3_WIDE_H_
+#define PEWPEW_VEC3_WIDE_H_
+
+#include "float.h"
+#include "simd.h"
+#include "vec3.h"
+
+// Structure-of-arrays vectors, holding one `Vec3` per lane, e.g. to test one
+// ray against several primitives or to shade several points at once.
+template <typename Lanes>
+class Vec3Wide {
+ public:
+  static constexpr int kWidth = Lanes::kWidth;
+
+  Vec3Wide() : x_(0.0f), y_(0.0f), z_(0.0f) {}
+  Vec3Wide(Lanes x, Lanes y, Lanes z) : x_(x), y_(y), z_(z) {}
+  // Broadcasts `value` to all lanes.
+  Vec3Wide(const Vec3& value) : x_(value.x()), y_(value.y()), z_(value.z()) {}
+
+  // Gathers `kWidth` vectors, one per lane.
+  static Vec3Wide Load(const Vec3* values) {
+    float x[kWidth];
+    float y[kWidth];
+    float z[kWidth];
+    for (int i = 0; i < kWidth; i++) {
+      x[i] = values[i].x();
+      y[i] = values[i].y();
+      z[i] = values[i].z();
+    }
+    return Vec3Wide{Lanes::Load(x), Lanes::Load(y), Lanes::Load(z)};
+  }
+
+  Vec3 lane(int i) const { return Vec3{x_[i], y_[i], z_[i]}; }
+
+  Lanes x() const { return x_; }
+  Lanes y() const { return y_; }
+  Lanes z() const { return z_; }
+
+  Lanes length_squared() const { return x_ * x_ + y_ * y_ + z_ * z_; }
+  Lanes length() const { return Sqrt(length_squared()); }
+
+ private:
+  Lanes x_;
+  Lanes y_;
+  Lanes z_;
+};
+
+using Vec3x4 = Vec3Wide<FloatX4>;
+
+template <typename Lanes>
+Vec3Wide<Lanes> operator-(const Vec3Wide<Lanes>& value) {
+  const Lanes zero{0.0f};
+  return Vec3Wide<Lanes>{zero - value.x(), zero - value.y(),
+                         zero - value.z()};
+}
+
+template <typename Lanes>
+Vec3Wide<Lanes> operator+(const Vec3Wide<Lanes>& lhs,
+                          const Vec3Wide<Lanes>& rhs) {
+  return Vec3Wide<Lanes>{lhs.x() + rhs.x(), lhs.y() + rhs.y(),
+                         lhs.z() + rhs.z()};
+}
+
+template <typename Lanes>
+Vec3Wide<Lanes> operator-(const Vec3Wide<Lanes>& lhs,
+                          const Vec3Wide<Lanes>& rhs) {
+  return Vec3Wide<Lanes>{lhs.x() - rhs.x(), lhs.y() - rhs.y(),
+                         lhs.z() - rhs.z()};
+}
+
+template <typename Lanes>
+Vec3Wide<Lanes> operator*(const Vec3Wide<Lanes>& lhs,
+                          const Vec3Wide<Lanes>& rhs) {
+  return Vec3Wide<Lanes>{lhs.x() * rhs.x(), lhs.y() * rhs.y(),
+                         lhs.z() * rhs.z()};
+}
+
+template <typename Lanes>
+Vec3Wide<Lanes> operator*(const Vec3Wide<Lanes>& lhs, Lanes rhs) {
+  return Vec3Wide<Lanes>{lhs.x() * rhs, lhs.y() * rhs, lhs.z() * rhs};
+}
+
+template <typename Lanes>
+Vec3Wide<Lanes> operator*(Lanes lhs, const Vec3Wide<Lanes>& rhs) {
+  return rhs * lhs;
+}
+
+template <typename Lanes>
+Lanes Dot(const Vec3Wide<Lanes>& lhs, const Vec3Wide<Lanes>& rhs) {
+  return lhs.x() * rhs.x() + lhs.y() * rhs.y() + lhs.z() * rhs.z();
+}
+
+template <typename Lanes>
+Vec3Wide<Lanes> Cross(const Vec3Wide<Lanes>& lhs,
+                      const Vec3Wide<Lanes>& rhs) {
+  return Vec3Wide<Lanes>{lhs.y() * rhs.z() - lhs.z() * rhs.y(),
+                         lhs.z() * rhs.x() - lhs.x() * rhs.z(),
+                         lhs.x() * rhs.y() - lhs.y() * rhs.x()};
+}
+
+template <typename Lanes>
+Vec3Wide<Lanes> UnitVector(const Vec3Wide<Lanes>& value) {
+  return value * RsqrtApprox(value.length_squared());
+}
+
+#endif  // PEWPEW_VEC3_WIDE_H_
\ No newline at end of file
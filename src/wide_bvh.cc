@@ -0,0 +1,262 @@
+#include "wide_bvh.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "aabb.h"
+#include "bvh.h"
+#include "float.h"
+#include "hittable.h"
+#include "ray.h"
+#include "simd.h"
+
+namespace {
+
+// Collapsing halves the depth of the binary BVH, which is bounded.
+constexpr int kStackSize = 128;
+
+struct StackEntry {
+  // A node, or the first object of a leaf.
+  int offset;
+  // The number of objects of a leaf, 0 for nodes.
+  int count;
+  float entry;
+};
+
+// Pushes the exits out by more than the rounding errors of the distances to
+// the planes, so that rays grazing a box aren't missed.
+constexpr float kExitPadding = 1 + 4 * std::numeric_limits<float>::epsilon();
+
+float ExponentScale(int exponent) {
+  return std::bit_cast<float>(static_cast<uint32_t>(exponent + 127) << 23);
+}
+
+}  // namespace
+
+WideBvh::WideBvh(const Bvh& bvh)
+    : owned_objects_(bvh.objects()), bounding_box_(bvh.BoundingBox()) {
+  for (const std::shared_ptr<Hittable>& object : owned_objects_) {
+    objects_.push_back(object.get());
+  }
+  nodes_.reserve(bvh.nodes().size() / 2 + 1);
+  Collapse(bvh, 0);
+}
+
+int WideBvh::Collapse(const Bvh& bvh, int binary_index) {
+  const std::vector<Bvh::Node>& binary_nodes = bvh.nodes();
+  const Bvh::Node& binary_node = binary_nodes[binary_index];
+
+  // Starts from the children of the binary node, and replaces the interior
+  // child with the largest box by its own children, while there is room.
+  std::vector<int> children;
+  if (binary_node.count > 0) {
+    children.push_back(binary_index);
+  } else if (!binary_node.bounds.empty()) {
+    children = {binary_index + 1, binary_node.offset};
+  }
+  while (static_cast<int>(children.size()) < kWidth) {
+    int largest = -1;
+    for (int i = 0; i < static_cast<int>(children.size()); i++) {
+      const Bvh::Node& child = binary_nodes[children[i]];
+      if (child.count == 0 &&
+          (largest < 0 || child.bounds.SurfaceArea() >
+                              binary_nodes[children[largest]]
+                                  .bounds.SurfaceArea())) {
+        largest = i;
+      }
+    }
+    if (largest < 0) {
+      break;
+    }
+    const int expanded = children[largest];
+    children[largest] = expanded + 1;
+    children.push_back(binary_nodes[expanded].offset);
+  }
+
+  Node node = {};
+  node.num_children = children.size();
+  Aabb box;
+  for (int child : children) {
+    box = Aabb{box, binary_nodes[child].bounds};
+  }
+  for (int axis = 0; axis < 3 && !box.empty(); axis++) {
+    // The planes are rounded outwards, in the float arithmetic of the
+    // traversal, so that the quantized boxes hold the children.
+    const double min = box.min()[axis];
+    const double max = box.max()[axis];
+    float origin = static_cast<float>(min);
+    if (origin > min) {
+      origin = std::nextafter(origin, -std::numeric_limits<float>::infinity());
+    }
+    auto plane = [origin](int exponent, int quantized) {
+      return origin + ExponentScale(exponent) * quantized;
+    };
+    const double extent = max - origin;
+    int exponent = extent > 0 ? static_cast<int>(std::ceil(std::log2(
+                                    extent / 255)))
+                              : -126;
+    exponent = std::clamp(exponent, -126, 127);
+    while (exponent < 127 && plane(exponent, 255) < max) {
+      exponent++;
+    }
+    const double scale = ExponentScale(exponent);
+
+    node.origin[axis] = origin;
+    node.exponents[axis] = exponent;
+    for (size_t i = 0; i < children.size(); i++) {
+      const Aabb& bounds = binary_nodes[children[i]].bounds;
+      int lower = std::clamp<double>(
+          std::floor((bounds.min()[axis] - origin) / scale), 0, 255);
+      while (lower > 0 && plane(exponent, lower) > bounds.min()[axis]) {
+        lower--;
+      }
+      int upper = std::clamp<double>(
+          std::ceil((bounds.max()[axis] - origin) / scale), 0, 255);
+      while (upper < 255 && plane(exponent, upper) < bounds.max()[axis]) {
+        upper++;
+      }
+      node.lower[axis][i] = lower;
+      node.upper[axis][i] = upper;
+    }
+  }
+
+  const int index = nodes_.size();
+  nodes_.push_back(node);
+  for (size_t i = 0; i < children.size(); i++) {
+    const Bvh::Node& child = binary_nodes[children[i]];
+    // Children are added after their parent, which may move `nodes_`.
+    const int offset =
+        child.count > 0 ? child.offset : Collapse(bvh, children[i]);
+    nodes_[index].offsets[i] = offset;
+    nodes_[index].counts[i] = child.count;
+  }
+  return index;
+}
+
+int WideBvh::IntersectChildren(const Node& node, const FloatX4 (&origin)[3],
+                               const FloatX4 (&inverse_direction)[3],
+                               FloatX4 tmin, FloatX4 tmax, float* entries) {
+  FloatX4 entry = tmin;
+  FloatX4 exit = tmax;
+  for (int axis = 0; axis < 3; axis++) {
+    const FloatX4 node_origin{node.origin[axis]};
+    const FloatX4 scale{ExponentScale(node.exponents[axis])};
+    const FloatX4 lower_planes =
+        node_origin + scale * FloatX4::LoadBytes(node.lower[axis]);
+    const FloatX4 upper_planes =
+        node_origin + scale * FloatX4::LoadBytes(node.upper[axis]);
+    const FloatX4 t0 = (lower_planes - origin[axis]) * inverse_direction[axis];
+    const FloatX4 t1 = (upper_planes - origin[axis]) * inverse_direction[axis];
+    entry = Max(entry, Min(t0, t1));
+    exit = Min(exit, Max(t0, t1));
+  }
+  const FloatX4 padding{kExitPadding};
+  const FloatX4 lanes{0.0f, 1.0f, 2.0f, 3.0f};
+  const FloatX4 is_child = lanes < FloatX4{static_cast<float>(
+                                       node.num_children)};
+  entry.Store(entries);
+  return MoveMask((entry <= exit * padding) & is_child);
+}
+
+std::optional<HitRecord> WideBvh::Hit(const Ray& ray, Float tmin,
+                                      Float tmax) const {
+  FloatX4 origin[3];
+  FloatX4 inverse_direction[3];
+  for (int axis = 0; axis < 3; axis++) {
+    origin[axis] = FloatX4{static_cast<float>(ray.origin()[axis])};
+    inverse_direction[axis] =
+        FloatX4{static_cast<float>(1 / ray.direction()[axis])};
+  }
+  const FloatX4 ray_tmin{static_cast<float>(tmin)};
+  Float closest = tmax;
+  std::optional<HitRecord> record;
+
+  StackEntry stack[kStackSize];
+  int stack_size = 0;
+  stack[stack_size++] = StackEntry{0, 0, static_cast<float>(tmin)};
+  while (stack_size > 0) {
+    const StackEntry top = stack[--stack_size];
+    if (top.entry > closest) {
+      continue;
+    }
+
+    if (top.count > 0) {
+      for (int i = top.offset; i < top.offset + top.count; i++) {
+        std::optional<HitRecord> object_record =
+            objects_[i]->Hit(ray, tmin, closest);
+        if (object_record.has_value()) {
+          closest = object_record->t();
+          record = object_record;
+        }
+      }
+      continue;
+    }
+
+    const Node& node = nodes_[top.offset];
+    float entries[kWidth];
+    int mask = IntersectChildren(node, origin, inverse_direction, ray_tmin,
+                                 FloatX4{static_cast<float>(closest)},
+                                 entries);
+    // Pushes the children from the farthest to the nearest, so that the
+    // nearest shortens the ray first.
+    StackEntry hits[kWidth];
+    int num_hits = 0;
+    for (; mask != 0; mask &= mask - 1) {
+      const int child = std::countr_zero(static_cast<unsigned>(mask));
+      const StackEntry hit{node.offsets[child], node.counts[child],
+                           entries[child]};
+      int position = num_hits++;
+      for (; position > 0 && hits[position - 1].entry < hit.entry;
+           position--) {
+        hits[position] = hits[position - 1];
+      }
+      hits[position] = hit;
+    }
+    std::copy(hits, hits + num_hits, stack + stack_size);
+    stack_size += num_hits;
+  }
+  return record;
+}
+
+Float WideBvh::Transmittance(const Ray& ray, Float tmin, Float tmax) const {
+  FloatX4 origin[3];
+  FloatX4 inverse_direction[3];
+  for (int axis = 0; axis < 3; axis++) {
+    origin[axis] = FloatX4{static_cast<float>(ray.origin()[axis])};
+    inverse_direction[axis] =
+        FloatX4{static_cast<float>(1 / ray.direction()[axis])};
+  }
+  const FloatX4 ray_tmin{static_cast<float>(tmin)};
+  const FloatX4 ray_tmax{static_cast<float>(tmax)};
+  Float transmittance = 1;
+
+  int stack[kStackSize];
+  int stack_size = 0;
+  stack[stack_size++] = 0;
+  while (stack_size > 0) {
+    const Node& node = nodes_[stack[--stack_size]];
+    float entries[kWidth];
+    for (int mask = IntersectChildren(node, origin, inverse_direction,
+                                      ray_tmin, ray_tmax, entries);
+         mask != 0; mask &= mask - 1) {
+      const int child = std::countr_zero(static_cast<unsigned>(mask));
+      if (node.counts[child] == 0) {
+        stack[stack_size++] = node.offsets[child];
+        continue;
+      }
+      for (int i = node.offsets[child];
+           i < node.offsets[child] + node.counts[child]; i++) {
+        transmittance *= objects_[i]->Transmittance(ray, tmin, tmax);
+        if (transmittance == 0) {
+          return 0;
+        }
+      }
+    }
+  }
+  return transmittance;
+}
\ No newline at end of file
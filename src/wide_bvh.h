@@ -0,0 +1,67 @@
+#ifndef PEWPEW_WIDE_BVH_H_
+#define PEWPEW_WIDE_BVH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "aabb.h"
+#include "bvh.h"
+#include "float.h"
+#include "hittable.h"
+#include "ray.h"
+#include "simd.h"
+
+// A 4-wide BVH, collapsed from a binary one. The boxes of the children of a
+// node are quantized to 8 bits per plane within the node's box, so that a
+// node fits a cache line, and are tested against the ray at once.
+class WideBvh : public Hittable {
+ public:
+  static constexpr int kWidth = 4;
+
+  explicit WideBvh(const Bvh& bvh);
+
+  std::optional<HitRecord> Hit(const Ray& ray, Float tmin,
+                               Float tmax) const override;
+  Aabb BoundingBox() const override { return bounding_box_; }
+  Float Transmittance(const Ray& ray, Float tmin, Float tmax) const override;
+
+  size_t NodeBytes() const { return nodes_.size() * sizeof(Node); }
+
+ private:
+  struct alignas(64) Node {
+    // The box of the children is `origin` plus multiples of 2^exponent.
+    float origin[3];
+    int8_t exponents[3];
+    uint8_t num_children;
+    // Per axis, then per child.
+    uint8_t lower[3][kWidth];
+    uint8_t upper[3][kWidth];
+    // The node of interior children, or the first object of leaves.
+    int32_t offsets[kWidth];
+    // The number of objects of leaves, 0 for interior children.
+    uint8_t counts[kWidth];
+  };
+  static_assert(sizeof(Node) == 64);
+
+  // Adds the node holding the children of the binary node `binary_index`, and
+  // those below, and returns its index.
+  int Collapse(const Bvh& bvh, int binary_index);
+
+  // Tests the boxes of the children of `node` against the ray, and returns
+  // the mask of those it enters between `tmin` and `tmax`, with where it
+  // enters them in `entries`.
+  static int IntersectChildren(const Node& node, const FloatX4 (&origin)[3],
+                               const FloatX4 (&inverse_direction)[3],
+                               FloatX4 tmin, FloatX4 tmax, float* entries);
+
+  std::vector<Node> nodes_;
+  // The objects of the binary BVH, in the same order.
+  std::vector<const Hittable*> objects_;
+  std::vector<std::shared_ptr<Hittable>> owned_objects_;
+  Aabb bounding_box_;
+};
+
+#endif  // PEWPEW_WIDE_BVH_H_
\ No newline at end of file